@@ -1,4 +1,4 @@
-use crate::util::{is_token, trimmed, FlagOperations};
+use crate::util::{is_token, trim_end, trim_start, trimmed, FlagOperations};
 use nom::AsChar;
 use nom::{
     branch::alt,
@@ -67,6 +67,17 @@ impl Value {
             flags,
         }
     }
+
+    /// Make a value from bytes that were already copied, e.g. when
+    /// joining folded lines, trimming them in place instead of copying
+    /// them again.
+    pub(crate) fn from_vec(mut value: Vec<u8>, flags: u64) -> Self {
+        let len = trim_end(&value).len();
+        value.truncate(len);
+        let start = value.len() - trim_start(&value).len();
+        value.drain(..start);
+        Self { value, flags }
+    }
 }
 
 #[derive(Clone, Debug, PartialEq, Eq)]
@@ -294,8 +305,10 @@ impl Parser {
         move |input| {
             let (mut rest, (val_bytes, ((_eol, mut flags), fold))) =
                 self.value_bytes().parse(input)?;
-            let mut value = val_bytes.to_vec();
             if let Some(fold) = fold {
+                // only a folded value has to be assembled in a new buffer,
+                // a single line value is copied once from the input
+                let mut value = val_bytes.to_vec();
                 let mut i = rest;
                 let mut ofold = fold;
                 loop {
@@ -308,7 +321,7 @@ impl Parser {
                                     flags.set(HeaderFlags::VALUE_EMPTY);
                                 }
                                 // i is now the latest rest
-                                return Ok((i, Value::new(&value, flags)));
+                                return Ok((i, Value::from_vec(value, flags)));
                             }
                             Err(Incomplete(_)) => {
                                 return Err(Incomplete(Needed::new(1)));
@@ -343,14 +356,14 @@ impl Parser {
                     if let Some(fold) = fold {
                         ofold = fold;
                     } else {
-                        return Ok((rest, Value::new(&value, flags)));
+                        return Ok((rest, Value::from_vec(value, flags)));
                     }
                 }
             } else {
-                if value.is_empty() {
+                if val_bytes.is_empty() {
                     flags.set(HeaderFlags::VALUE_EMPTY);
                 }
-                Ok((rest, Value::new(&value, flags)))
+                Ok((rest, Value::new(val_bytes, flags)))
             }
         }
     }
@@ -413,7 +426,7 @@ impl Parser {
             let flags = value.flags | HeaderFlags::MISSING_COLON;
             Ok((
                 remaining,
-                Header::new_with_flags(b"", flags, &value.value, flags),
+                Header::new(Name::new(b"", flags), Value::from_vec(value.value, flags)),
             ))
         }
     }
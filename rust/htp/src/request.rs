@@ -692,9 +692,13 @@ impl ConnectionParser {
             Ok((_, line)) => {
                 // We have a line ending, so consume the input
                 // and grab any buffered data
+                self.request_data_consume(input, line.len());
+                if self.request_buf.is_empty() {
+                    // The whole line is in the input, no need to copy it
+                    return self.request_line_complete(line);
+                }
                 let mut data = take(&mut self.request_buf);
                 data.add(line);
-                self.request_data_consume(input, line.len());
                 self.request_line_complete(data.as_slice())
             }
             _ => {
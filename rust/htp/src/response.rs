@@ -642,9 +642,13 @@ impl ConnectionParser {
             Ok((_, (line, _))) => {
                 // We have a line ending, so consume the input
                 // and grab any buffered data.
+                self.response_data_consume(input, line.len());
+                if self.response_buf.is_empty() {
+                    // The whole line is in the input, no need to copy it
+                    return self.response_line_complete(line, input);
+                }
                 let mut data = take(&mut self.response_buf);
                 data.add(line);
-                self.response_data_consume(input, line.len());
                 self.response_line_complete(data.as_slice(), input)
             }
             _ => {
@@ -211,7 +211,7 @@ pub(crate) fn chomp(mut data: &[u8]) -> &[u8] {
 }
 
 /// Trim the leading whitespace
-fn trim_start(input: &[u8]) -> &[u8] {
+pub(crate) fn trim_start(input: &[u8]) -> &[u8] {
     let mut result = input;
     while let Some(x) = result.first() {
         if is_space(*x) {
@@ -224,7 +224,7 @@ fn trim_start(input: &[u8]) -> &[u8] {
 }
 
 /// Trim the trailing whitespace
-fn trim_end(input: &[u8]) -> &[u8] {
+pub(crate) fn trim_end(input: &[u8]) -> &[u8] {
     let mut result = input;
     while let Some(x) = result.last() {
         if is_space(*x) {
@@ -707,8 +707,31 @@ pub trait State<Tx: Transaction> {
     /// Return a transaction by its index in the container.
     fn get_transaction_by_index(&self, index: usize) -> Option<&Tx>;
 
+    /// Return the index of the first transaction with an id of at least `id`,
+    /// or the transaction count if there is none.
+    ///
+    /// Transactions are added to the container in the order of their ids, so
+    /// this is a binary search instead of a walk over all transactions.
+    fn get_transaction_index(&self, id: u64) -> usize {
+        let mut low = 0;
+        let mut high = self.get_transaction_count();
+        while low < high {
+            let mid = low + (high - low) / 2;
+            match self.get_transaction_by_index(mid) {
+                Some(tx) if tx.id() < id => low = mid + 1,
+                _ => high = mid,
+            }
+        }
+        low
+    }
+
     fn get_transaction_iterator(&self, min_tx_id: u64, state: &mut u64) -> AppLayerGetTxIterTuple {
         let mut index = *state as usize;
+        if index == 0 {
+            // first call: skip the transactions before min_tx_id, which on
+            // long lived flows can be many that are waiting to be freed.
+            index = self.get_transaction_index(min_tx_id + 1);
+        }
         let len = self.get_transaction_count();
         while index < len {
             let tx = self.get_transaction_by_index(index).unwrap();
@@ -44,7 +44,25 @@ fn hex_value(i: u8) -> Option<u8> {
 fn url_decode_transform_do(input: &[u8], output: &mut [u8]) -> u32 {
     let mut state = (0u8, 0u8);
     let mut nb = 0;
-    for &i in input.iter() {
+    let mut rest = input;
+    while !rest.is_empty() {
+        if state.0 == 0 {
+            // copy the bytes up to the next one to decode at once
+            let run = rest
+                .iter()
+                .position(|&c| c == b'%' || c == b'+')
+                .unwrap_or(rest.len());
+            let dst = &mut output[nb..nb + run];
+            // not copy_from_slice: the transform may run in place
+            unsafe { ptr::copy(rest.as_ptr(), dst.as_mut_ptr(), run) };
+            nb += run;
+            rest = &rest[run..];
+            if rest.is_empty() {
+                break;
+            }
+        }
+        let i = rest[0];
+        rest = &rest[1..];
         if state.0 > 0 {
             if let Some(v) = hex_value(i) {
                 if state.0 == 1 {
@@ -573,24 +573,15 @@ impl DNSState {
     }
 
     fn free_tx(&mut self, tx_id: u64) {
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &self.transactions[i];
-            if tx.id == tx_id + 1 {
-                found = true;
-                index = i;
-                break;
-            }
-        }
-        if found {
+        let index = self.get_transaction_index(tx_id + 1);
+        if self.transactions.get(index).is_some_and(|tx| tx.id == tx_id + 1) {
             self.transactions.remove(index);
         }
     }
 
     fn get_tx(&mut self, tx_id: u64) -> Option<&DNSTransaction> {
-        return self.transactions.iter().find(|&tx| tx.id == tx_id + 1);
+        let index = self.get_transaction_index(tx_id + 1);
+        return self.transactions.get(index).filter(|tx| tx.id == tx_id + 1);
     }
 
     /// Set an event. The event is set on the most recent transaction.
@@ -1823,4 +1814,26 @@ mod tests {
         assert_eq!(event, DNSEvent::MalformedData);
         assert_eq!(event.to_cstring(), format!("{}\0", name));
     }
+
+    #[test]
+    fn test_dns_tx_index() {
+        let mut state = DNSState::new();
+        for id in 1..=10 {
+            let mut tx = DNSTransaction::new(Direction::ToServer);
+            tx.id = id;
+            state.transactions.push_back(tx);
+        }
+        state.free_tx(0);
+        state.free_tx(4);
+        // already freed
+        state.free_tx(4);
+        assert_eq!(state.transactions.len(), 8);
+        assert!(state.get_tx(0).is_none());
+        assert!(state.get_tx(4).is_none());
+        assert_eq!(state.get_tx(5).unwrap().id, 6);
+        assert_eq!(state.get_tx(9).unwrap().id, 10);
+        assert!(state.get_tx(10).is_none());
+        assert_eq!(state.get_transaction_index(5), 3);
+        assert_eq!(state.get_transaction_index(100), 8);
+    }
 }
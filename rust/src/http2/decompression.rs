@@ -24,6 +24,11 @@ use std::io::{Cursor, Read, Write};
 
 pub const HTTP2_DECOMPRESSION_CHUNK_SIZE: usize = 0x1000; // 4096
 
+// decompressed size over which the ratio is checked, 1 MiB by default
+pub static mut HTTP2_DECOMPRESSION_BOMB_LIMIT: u64 = 0x100000;
+// maximum ratio of decompressed to compressed data past the bomb limit
+pub static mut HTTP2_DECOMPRESSION_BOMB_RATIO: u64 = 2048;
+
 #[repr(u8)]
 #[derive(Copy, Clone, PartialOrd, PartialEq, Eq, Debug)]
 pub enum HTTP2ContentEncoding {
@@ -105,6 +110,10 @@ impl std::fmt::Debug for HTTP2Decompresser {
 struct HTTP2DecoderHalf {
     encoding: HTTP2ContentEncoding,
     decoder: HTTP2Decompresser,
+    // compressed bytes given to the decoder so far
+    in_len: u64,
+    // decompressed bytes so far
+    out_len: u64,
 }
 
 pub trait GetMutCursor {
@@ -129,8 +138,21 @@ impl GetMutCursor for brotli::Decompressor<HTTP2cursor> {
     }
 }
 
+// checked after every decompressed chunk, so that a bomb is stopped
+// before it is fully decompressed
+fn http2_decompression_bomb(in_len: u64, out_len: u64) -> bool {
+    if out_len <= unsafe { HTTP2_DECOMPRESSION_BOMB_LIMIT } {
+        return false;
+    }
+    match in_len.checked_mul(unsafe { HTTP2_DECOMPRESSION_BOMB_RATIO }) {
+        Some(max) => out_len > max,
+        None => false,
+    }
+}
+
 fn http2_decompress<'a>(
     decoder: &mut (impl Read + GetMutCursor), input: &'a [u8], output: &'a mut Vec<u8>,
+    in_len: u64, out_len: u64,
 ) -> io::Result<&'a [u8]> {
     match decoder.get_mut().cursor.write_all(input) {
         Ok(()) => {}
@@ -148,6 +170,10 @@ fn http2_decompress<'a>(
             }
             Ok(n) => {
                 offset += n;
+                if http2_decompression_bomb(in_len, out_len + offset as u64) {
+                    decoder.get_mut().clear();
+                    return Err(io::Error::other("decompression bomb"));
+                }
                 if offset == output.len() {
                     output.resize(output.len() + HTTP2_DECOMPRESSION_CHUNK_SIZE, 0);
                 }
@@ -170,6 +196,8 @@ impl HTTP2DecoderHalf {
         HTTP2DecoderHalf {
             encoding: HTTP2ContentEncoding::Unknown,
             decoder: HTTP2Decompresser::Unassigned,
+            in_len: 0,
+            out_len: 0,
         }
     }
 
@@ -199,31 +227,43 @@ impl HTTP2DecoderHalf {
     pub fn decompress<'a>(
         &mut self, input: &'a [u8], output: &'a mut Vec<u8>,
     ) -> io::Result<&'a [u8]> {
-        match self.decoder {
-            HTTP2Decompresser::Gzip(ref mut gzip_decoder) => {
-                let r = http2_decompress(&mut *gzip_decoder.as_mut(), input, output);
-                if r.is_err() {
-                    self.decoder = HTTP2Decompresser::Unassigned;
-                }
-                return r;
+        let in_len = self.in_len.saturating_add(input.len() as u64);
+        let r = match self.decoder {
+            HTTP2Decompresser::Gzip(ref mut gzip_decoder) => http2_decompress(
+                &mut *gzip_decoder.as_mut(),
+                input,
+                output,
+                in_len,
+                self.out_len,
+            ),
+            HTTP2Decompresser::Brotli(ref mut br_decoder) => http2_decompress(
+                &mut *br_decoder.as_mut(),
+                input,
+                output,
+                in_len,
+                self.out_len,
+            ),
+            HTTP2Decompresser::Deflate(ref mut df_decoder) => http2_decompress(
+                &mut *df_decoder.as_mut(),
+                input,
+                output,
+                in_len,
+                self.out_len,
+            ),
+            _ => {
+                return Ok(input);
             }
-            HTTP2Decompresser::Brotli(ref mut br_decoder) => {
-                let r = http2_decompress(&mut *br_decoder.as_mut(), input, output);
-                if r.is_err() {
-                    self.decoder = HTTP2Decompresser::Unassigned;
-                }
-                return r;
+        };
+        match r {
+            Ok(ref d) => {
+                self.in_len = in_len;
+                self.out_len = self.out_len.saturating_add(d.len() as u64);
             }
-            HTTP2Decompresser::Deflate(ref mut df_decoder) => {
-                let r = http2_decompress(&mut *df_decoder.as_mut(), input, output);
-                if r.is_err() {
-                    self.decoder = HTTP2Decompresser::Unassigned;
-                }
-                return r;
+            Err(_) => {
+                self.decoder = HTTP2Decompresser::Unassigned;
             }
-            _ => {}
         }
-        return Ok(input);
+        return r;
     }
 }
 
@@ -259,3 +299,23 @@ impl HTTP2Decoder {
         }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_http2_decompression_bomb() {
+        let mut input = Vec::new();
+        {
+            let mut w = brotli::CompressorWriter::new(&mut input, 4096, 5, 22);
+            w.write_all(&vec![0u8; 4 * 1024 * 1024]).unwrap();
+        }
+        let mut dec = HTTP2DecoderHalf::new();
+        dec.http2_encoding_fromvec(b"br");
+        let mut output = Vec::with_capacity(HTTP2_DECOMPRESSION_CHUNK_SIZE);
+        assert!(dec.decompress(&input, &mut output).is_err());
+        // stopped right after the limit, not after decompressing everything
+        assert!(output.len() < 2 * 1024 * 1024);
+    }
+}
@@ -22,7 +22,7 @@ use super::range;
 
 use super::range::{SCHTPFileCloseHandleRange, SCHttpRangeFreeBlock};
 use crate::applayer::{self, *};
-use crate::conf::conf_get;
+use crate::conf::{conf_get, get_memval};
 use crate::core::*;
 use crate::direction::Direction;
 use crate::dns::dns::DnsVariant;
@@ -647,49 +647,42 @@ impl HTTP2State {
 
     // Free a transaction by ID.
     fn free_tx(&mut self, tx_id: u64) {
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &mut self.transactions[i];
-            if tx.tx_id == tx_id + 1 {
-                found = true;
-                index = i;
-                // this should be in HTTP2Transaction::free
-                // but we need state's file container cf https://redmine.openinfosecfoundation.org/issues/4444
-                if !tx.file_range.is_null() {
-                    if let Some(sfcm) = unsafe { SURICATA_HTTP2_FILE_CONFIG } {
-                        unsafe {
-                            SCHTPFileCloseHandleRange(
-                                sfcm.files_sbcfg,
-                                &mut tx.ft_tc.file,
-                                0,
-                                tx.file_range,
-                                std::ptr::null_mut(),
-                                0,
-                            );
-                            SCHttpRangeFreeBlock(tx.file_range);
-                        }
-                        tx.file_range = std::ptr::null_mut();
+        let index = self.get_transaction_index(tx_id + 1);
+        if let Some(tx) = self.transactions.get_mut(index) {
+            if tx.tx_id != tx_id + 1 {
+                return;
+            }
+            // this should be in HTTP2Transaction::free
+            // but we need state's file container cf https://redmine.openinfosecfoundation.org/issues/4444
+            if !tx.file_range.is_null() {
+                if let Some(sfcm) = unsafe { SURICATA_HTTP2_FILE_CONFIG } {
+                    unsafe {
+                        SCHTPFileCloseHandleRange(
+                            sfcm.files_sbcfg,
+                            &mut tx.ft_tc.file,
+                            0,
+                            tx.file_range,
+                            std::ptr::null_mut(),
+                            0,
+                        );
+                        SCHttpRangeFreeBlock(tx.file_range);
                     }
+                    tx.file_range = std::ptr::null_mut();
                 }
-                break;
             }
-        }
-        if found {
             self.transactions.remove(index);
         }
     }
 
     pub fn get_tx(&mut self, tx_id: u64) -> Option<&HTTP2Transaction> {
-        for tx in &mut self.transactions {
-            if tx.tx_id == tx_id + 1 {
-                tx.tx_data.update_file_flags(self.state_data.file_flags);
-                tx.update_file_flags(tx.tx_data.file_flags);
-                return Some(tx);
-            }
+        let index = self.get_transaction_index(tx_id + 1);
+        let tx = self.transactions.get_mut(index)?;
+        if tx.tx_id != tx_id + 1 {
+            return None;
         }
-        return None;
+        tx.tx_data.update_file_flags(self.state_data.file_flags);
+        tx.update_file_flags(tx.tx_data.file_flags);
+        return Some(tx);
     }
 
     fn find_tx_index(&mut self, sid: u32) -> usize {
@@ -1596,6 +1589,20 @@ pub unsafe extern "C" fn SCRegisterHttp2Parser() {
                 SCLogError!("Invalid value for http2.max-reassembly-size");
             }
         }
+        if let Some(val) = conf_get("app-layer.protocols.http2.compression-bomb-limit") {
+            if let Ok(v) = get_memval(val) {
+                decompression::HTTP2_DECOMPRESSION_BOMB_LIMIT = v;
+            } else {
+                SCLogError!("Invalid value for http2.compression-bomb-limit");
+            }
+        }
+        if let Some(val) = conf_get("app-layer.protocols.http2.compression-bomb-ratio") {
+            if let Ok(v) = val.parse::<u64>() {
+                decompression::HTTP2_DECOMPRESSION_BOMB_RATIO = v;
+            } else {
+                SCLogError!("Invalid value for http2.compression-bomb-ratio");
+            }
+        }
         SCAppLayerParserRegisterLogger(IPPROTO_TCP, ALPROTO_HTTP2);
         SCLogDebug!("Rust http2 parser registered.");
     } else {
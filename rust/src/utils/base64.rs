@@ -19,76 +19,56 @@
 
 use std::io::{Error, ErrorKind, Result};
 
+// base64 value of every byte, 0xff for bytes outside of the alphabet,
+// including the '=' padding
+static BASE64_TABLE: [u8; 256] = {
+    let mut table = [0xffu8; 256];
+    let mut i = 0;
+    while i < 26 {
+        table[b'A' as usize + i] = i as u8;
+        table[b'a' as usize + i] = 26 + i as u8;
+        i += 1;
+    }
+    i = 0;
+    while i < 10 {
+        table[b'0' as usize + i] = 52 + i as u8;
+        i += 1;
+    }
+    table[b'+' as usize] = 62;
+    table[b'/' as usize] = 63;
+    table
+};
+
 fn base64_map(input: u8) -> Result<u8> {
-    match input {
-        43 => Ok(62),  // +
-        47 => Ok(63),  // /
-        48 => Ok(52),  // 0
-        49 => Ok(53),  // 1
-        50 => Ok(54),  // 2
-        51 => Ok(55),  // 3
-        52 => Ok(56),  // 4
-        53 => Ok(57),  // 5
-        54 => Ok(58),  // 6
-        55 => Ok(59),  // 7
-        56 => Ok(60),  // 8
-        57 => Ok(61),  // 9
-        65 => Ok(0),   // A
-        66 => Ok(1),   // B
-        67 => Ok(2),   // C
-        68 => Ok(3),   // D
-        69 => Ok(4),   // E
-        70 => Ok(5),   // F
-        71 => Ok(6),   // G
-        72 => Ok(7),   // H
-        73 => Ok(8),   // I
-        74 => Ok(9),   // J
-        75 => Ok(10),  // K
-        76 => Ok(11),  // L
-        77 => Ok(12),  // M
-        78 => Ok(13),  // N
-        79 => Ok(14),  // O
-        80 => Ok(15),  // P
-        81 => Ok(16),  // Q
-        82 => Ok(17),  // R
-        83 => Ok(18),  // S
-        84 => Ok(19),  // T
-        85 => Ok(20),  // U
-        86 => Ok(21),  // V
-        87 => Ok(22),  // W
-        88 => Ok(23),  // X
-        89 => Ok(24),  // Y
-        90 => Ok(25),  // Z
-        97 => Ok(26),  // a
-        98 => Ok(27),  // b
-        99 => Ok(28),  // c
-        100 => Ok(29), // d
-        101 => Ok(30), // e
-        102 => Ok(31), // f
-        103 => Ok(32), // g
-        104 => Ok(33), // h
-        105 => Ok(34), // i
-        106 => Ok(35), // j
-        107 => Ok(36), // k
-        108 => Ok(37), // l
-        109 => Ok(38), // m
-        110 => Ok(39), // n
-        111 => Ok(40), // o
-        112 => Ok(41), // p
-        113 => Ok(42), // q
-        114 => Ok(43), // r
-        115 => Ok(44), // s
-        116 => Ok(45), // t
-        117 => Ok(46), // u
-        118 => Ok(47), // v
-        119 => Ok(48), // w
-        120 => Ok(49), // x
-        121 => Ok(50), // y
-        122 => Ok(51), // z
-        _ => Err(Error::new(ErrorKind::InvalidData, "invalid base64")),
+    match BASE64_TABLE[input as usize] {
+        0xff => Err(Error::new(ErrorKind::InvalidData, "invalid base64")),
+        v => Ok(v),
     }
 }
 
+// Decode the leading blocks of 4 alphabet characters of input, stopping at
+// the first block containing padding or any other character. This is the
+// common case of a long base64 run, and is done without the per character
+// state of the decoders below. Returns the number of blocks decoded.
+fn decode_blocks(input: &[u8], output: &mut [u8]) -> usize {
+    let mut n = 0;
+    for (i, o) in input.chunks_exact(4).zip(output.chunks_exact_mut(3)) {
+        let a = BASE64_TABLE[i[0] as usize];
+        let b = BASE64_TABLE[i[1] as usize];
+        let c = BASE64_TABLE[i[2] as usize];
+        let d = BASE64_TABLE[i[3] as usize];
+        if (a | b | c | d) & 0x80 != 0 {
+            break;
+        }
+        let v = (a as u32) << 18 | (b as u32) << 12 | (c as u32) << 6 | d as u32;
+        o[0] = (v >> 16) as u8;
+        o[1] = (v >> 8) as u8;
+        o[2] = v as u8;
+        n += 1;
+    }
+    return n;
+}
+
 #[derive(Debug)]
 pub struct Decoder {
     tmp: [u8; 4],
@@ -117,6 +97,14 @@ pub fn decode_rfc4648(decoder: &mut Decoder, input: &[u8], output: &mut [u8], de
     let mut offset = 0;
     let mut stop = false;
     while !i.is_empty() {
+        if decoder.nb == 0 {
+            let n = decode_blocks(i, &mut output[offset..]);
+            i = &i[n * 4..];
+            offset += n * 3;
+            if i.is_empty() {
+                break;
+            }
+        }
         while decoder.nb < 4 {
             if !i.is_empty() && (base64_map(i[0]).is_ok() || i[0] == b'=') {
                 decoder.tmp[decoder.nb as usize] = i[0];
@@ -171,6 +159,11 @@ pub fn decode_rfc2045(decoder: &mut Decoder, input: &[u8], output: &mut [u8], de
     let mut offset = 0;
 
     while !i.is_empty() {
+        if decoder.nb == 0 {
+            let n = decode_blocks(i, &mut output[offset..]);
+            i = &i[n * 4..];
+            offset += n * 3;
+        }
         while decoder.nb < 4 && !i.is_empty() {
             if base64_map(i[0]).is_ok() || i[0] == b'=' {
                 decoder.tmp[decoder.nb as usize] = i[0];
@@ -205,3 +198,119 @@ pub fn decode_rfc2045(decoder: &mut Decoder, input: &[u8], output: &mut [u8], de
 
     return Ok(());
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // decode a block of 4 characters the way the decoders do
+    fn reference_block(b: &[u8], out: &mut Vec<u8>) -> Result<()> {
+        let v0 = base64_map(b[0])?;
+        let v1 = base64_map(b[1])?;
+        out.push((v0 << 2) | (v1 >> 4));
+        if b[2] == b'=' {
+            return Ok(());
+        }
+        let v2 = base64_map(b[2])?;
+        out.push((v1 << 4) | (v2 >> 2));
+        if b[3] == b'=' {
+            return Ok(());
+        }
+        let v3 = base64_map(b[3])?;
+        out.push((v2 << 6) | v3);
+        Ok(())
+    }
+
+    fn is_base64(c: u8) -> bool {
+        base64_map(c).is_ok() || c == b'='
+    }
+
+    fn reference_rfc4648(input: &[u8]) -> Result<Vec<u8>> {
+        let mut chars: Vec<u8> = input
+            .iter()
+            .copied()
+            .take_while(|&c| is_base64(c))
+            .collect();
+        while chars.len() % 4 != 0 {
+            chars.push(b'=');
+        }
+        let mut out = Vec::new();
+        for b in chars.chunks(4) {
+            reference_block(b, &mut out)?;
+        }
+        Ok(out)
+    }
+
+    fn reference_rfc2045(input: &[u8]) -> Result<Vec<u8>> {
+        let chars: Vec<u8> = input.iter().copied().filter(|&c| is_base64(c)).collect();
+        let mut out = Vec::new();
+        for b in chars.chunks_exact(4) {
+            reference_block(b, &mut out)?;
+        }
+        Ok(out)
+    }
+
+    // input mostly made of base64 characters, with some padding, line
+    // breaks and invalid characters
+    fn fuzz_input(seed: &mut u32, len: usize) -> Vec<u8> {
+        const ALPHABET: &[u8] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        let mut v = Vec::with_capacity(len);
+        for _ in 0..len {
+            *seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
+            let r = *seed >> 16;
+            let c = match r % 100 {
+                0 => b'=',
+                1 => b'\n',
+                2 => b'!',
+                _ => ALPHABET[(r >> 8) as usize % ALPHABET.len()],
+            };
+            v.push(c);
+        }
+        v
+    }
+
+    #[test]
+    fn test_base64_decode_fuzz() {
+        let mut seed = 1;
+        for n in 0..2000 {
+            let input = fuzz_input(&mut seed, n % 200);
+            let size = get_decoded_buffer_size(input.len() as u32) as usize;
+
+            let mut output = vec![0; size];
+            let mut decoded = 0;
+            let mut decoder = Decoder::new();
+            let r = decode_rfc4648(&mut decoder, &input, &mut output, &mut decoded);
+            match reference_rfc4648(&input) {
+                Ok(expected) => {
+                    assert!(r.is_ok());
+                    assert_eq!(&output[..decoded as usize], &expected[..]);
+                }
+                Err(_) => assert!(r.is_err()),
+            }
+
+            let mut output = vec![0; size];
+            let mut decoded = 0;
+            let mut decoder = Decoder::new();
+            let r = decode_rfc2045(&mut decoder, &input, &mut output, &mut decoded);
+            match reference_rfc2045(&input) {
+                Ok(expected) => {
+                    assert!(r.is_ok());
+                    assert_eq!(&output[..decoded as usize], &expected[..]);
+                }
+                Err(_) => assert!(r.is_err()),
+            }
+        }
+    }
+
+    #[test]
+    fn test_base64_decode_blocks() {
+        let mut output = [0u8; 9];
+        assert_eq!(decode_blocks(b"SGVsbG8gV29y", &mut output), 3);
+        assert_eq!(&output, b"Hello Wor");
+        // stops at padding and invalid characters
+        assert_eq!(decode_blocks(b"SGVsbG8=", &mut output), 1);
+        assert_eq!(decode_blocks(b"SGVs\nG8g", &mut output), 1);
+        // and when the output is full
+        assert_eq!(decode_blocks(b"SGVsbG8gV29ybGQh", &mut output), 3);
+    }
+}
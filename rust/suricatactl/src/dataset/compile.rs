@@ -0,0 +1,235 @@
+// SPDX-FileCopyrightText: Copyright 2025 Open Information Security Foundation
+// SPDX-License-Identifier: GPL-2.0-only
+
+//! Compile a dataset file into the read-only format Suricata maps into
+//! memory. See src/datasets-compiled.h for the layout.
+
+use base64::Engine;
+use std::collections::BTreeMap;
+use std::io::{BufRead, Write};
+use std::net::{Ipv4Addr, Ipv6Addr};
+use std::str::FromStr;
+use tracing::info;
+
+use crate::DatasetCompileArgs;
+
+const MAGIC: &[u8; 8] = b"SCDSCMP1";
+const VERSION: u32 = 1;
+const BYTE_ORDER: u32 = 0x01020304;
+
+// Values of enum DatasetTypes.
+const TYPE_STRING: u32 = 1;
+const TYPE_MD5: u32 = 2;
+const TYPE_SHA256: u32 = 3;
+const TYPE_IPV4: u32 = 4;
+const TYPE_IPV6: u32 = 5;
+
+pub(crate) fn compile(args: DatasetCompileArgs) -> Result<(), Box<dyn std::error::Error>> {
+    let set_type = parse_type(&args.set_type)?;
+    let input = std::io::BufReader::new(std::fs::File::open(&args.input)?);
+    let (count, out) = compile_lines(set_type, input.lines().map_while(Result::ok))?;
+
+    let mut output = std::fs::File::create(&args.output)?;
+    output.write_all(&out)?;
+    info!(
+        "Compiled {} entries from {} into {} ({} bytes)",
+        count,
+        args.input,
+        args.output,
+        out.len()
+    );
+    Ok(())
+}
+
+fn parse_type(set_type: &str) -> Result<u32, String> {
+    match set_type {
+        "string" => Ok(TYPE_STRING),
+        "md5" => Ok(TYPE_MD5),
+        "sha256" => Ok(TYPE_SHA256),
+        "ipv4" => Ok(TYPE_IPV4),
+        "ip" => Ok(TYPE_IPV6),
+        _ => Err(format!(
+            "Invalid type: {}. Must be one of string, md5, sha256, ipv4, ip",
+            set_type
+        )),
+    }
+}
+
+/// Parse a value the way the dataset loader does.
+fn parse_key(set_type: u32, value: &str) -> Result<Vec<u8>, String> {
+    let key = match set_type {
+        TYPE_STRING => base64::engine::general_purpose::STANDARD
+            .decode(value)
+            .map_err(|_| format!("bad base64 encoding {}", value))?,
+        TYPE_MD5 | TYPE_SHA256 => {
+            let key = hex::decode(value).map_err(|_| format!("bad hex value {}", value))?;
+            let len = if set_type == TYPE_MD5 { 16 } else { 32 };
+            if key.len() != len {
+                return Err(format!("bad hash length {}", value));
+            }
+            key
+        }
+        TYPE_IPV4 => Ipv4Addr::from_str(value)
+            .map_err(|_| format!("invalid Ipv4 value {}", value))?
+            .octets()
+            .to_vec(),
+        _ if !value.contains(':') => {
+            // IPv4 addresses are stored in the first 4 bytes
+            let ipv4 =
+                Ipv4Addr::from_str(value).map_err(|_| format!("invalid Ipv4 value {}", value))?;
+            let mut key = vec![0; 16];
+            key[..4].copy_from_slice(&ipv4.octets());
+            key
+        }
+        _ => {
+            let ipv6 =
+                Ipv6Addr::from_str(value).map_err(|_| format!("invalid Ipv6 value {}", value))?;
+            // so are IPv4 mapped addresses
+            if let Some(ipv4) = ipv6.to_ipv4_mapped() {
+                let mut key = vec![0; 16];
+                key[..4].copy_from_slice(&ipv4.octets());
+                key
+            } else {
+                ipv6.octets().to_vec()
+            }
+        }
+    };
+    Ok(key)
+}
+
+/// Build the compiled set from the lines of a dataset file. Returns the
+/// number of unique entries and the file content.
+fn compile_lines<I>(set_type: u32, lines: I) -> Result<(usize, Vec<u8>), String>
+where
+    I: Iterator<Item = String>,
+{
+    let mut no_rep = false;
+    let mut with_rep = false;
+    let mut entries: BTreeMap<Vec<u8>, u16> = BTreeMap::new();
+
+    for (n, line) in lines.enumerate() {
+        let v: Vec<&str> = line.split(',').collect();
+        if line.is_empty() || v.len() > 2 {
+            continue;
+        }
+        let rep = if v.len() == 1 {
+            no_rep = true;
+            0
+        } else {
+            with_rep = true;
+            v[1].parse::<u16>()
+                .map_err(|_| format!("line {}: invalid datarep value {}", n + 1, v[1]))?
+        };
+        if no_rep && with_rep {
+            return Err(format!(
+                "line {}: cannot mix dataset and datarep values",
+                n + 1
+            ));
+        }
+        let key = parse_key(set_type, v[0]).map_err(|e| format!("line {}: {}", n + 1, e))?;
+        // like the loader, the first occurrence of a key wins
+        entries.entry(key).or_insert(rep);
+    }
+
+    let key_len: u32 = match set_type {
+        TYPE_STRING => 0,
+        TYPE_MD5 | TYPE_IPV6 => 16,
+        TYPE_SHA256 => 32,
+        _ => 4,
+    };
+
+    // the map is sorted by key, which is the order lookups expect
+    let mut records = Vec::new();
+    let mut blob = Vec::new();
+    for (key, rep) in &entries {
+        if key_len == 0 {
+            records.extend_from_slice(&(blob.len() as u64).to_ne_bytes());
+            blob.extend_from_slice(&(key.len() as u32).to_ne_bytes());
+            blob.extend_from_slice(&rep.to_ne_bytes());
+            blob.extend_from_slice(key);
+        } else {
+            records.extend_from_slice(key);
+            records.extend_from_slice(&rep.to_ne_bytes());
+        }
+    }
+
+    let mut out = Vec::with_capacity(40 + records.len() + blob.len());
+    out.extend_from_slice(MAGIC);
+    out.extend_from_slice(&VERSION.to_ne_bytes());
+    out.extend_from_slice(&BYTE_ORDER.to_ne_bytes());
+    out.extend_from_slice(&set_type.to_ne_bytes());
+    out.extend_from_slice(&key_len.to_ne_bytes());
+    out.extend_from_slice(&(entries.len() as u64).to_ne_bytes());
+    out.extend_from_slice(&(blob.len() as u64).to_ne_bytes());
+    out.extend_from_slice(&records);
+    out.extend_from_slice(&blob);
+    Ok((entries.len(), out))
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn lines(input: &[&str]) -> impl Iterator<Item = String> {
+        input
+            .iter()
+            .map(|s| s.to_string())
+            .collect::<Vec<_>>()
+            .into_iter()
+    }
+
+    #[test]
+    fn test_parse_type() {
+        assert_eq!(parse_type("sha256").unwrap(), TYPE_SHA256);
+        assert_eq!(parse_type("ip").unwrap(), TYPE_IPV6);
+        assert!(parse_type("ipv6").is_err());
+    }
+
+    #[test]
+    fn test_compile_ipv4_sorted() {
+        let (count, out) = compile_lines(
+            TYPE_IPV4,
+            lines(&["10.0.0.2,5", "10.0.0.1,3", "10.0.0.2,7"]),
+        )
+        .unwrap();
+        assert_eq!(count, 2);
+        assert_eq!(&out[..8], MAGIC);
+        assert_eq!(out.len(), 40 + 2 * 6);
+        assert_eq!(&out[40..44], &[10, 0, 0, 1]);
+        assert_eq!(&out[44..46], &3u16.to_ne_bytes());
+        assert_eq!(&out[46..50], &[10, 0, 0, 2]);
+        assert_eq!(&out[50..52], &5u16.to_ne_bytes());
+    }
+
+    #[test]
+    fn test_parse_key_ip() {
+        let mut v4 = vec![0; 16];
+        v4[..4].copy_from_slice(&[1, 2, 3, 4]);
+        assert_eq!(parse_key(TYPE_IPV6, "1.2.3.4").unwrap(), v4);
+        assert_eq!(parse_key(TYPE_IPV6, "::ffff:1.2.3.4").unwrap(), v4);
+        let mut v6 = vec![0; 16];
+        v6[0] = 0x20;
+        v6[1] = 0x01;
+        v6[15] = 1;
+        assert_eq!(parse_key(TYPE_IPV6, "2001::1").unwrap(), v6);
+        assert!(parse_key(TYPE_IPV6, "1.2.3").is_err());
+    }
+
+    #[test]
+    fn test_compile_string() {
+        // "b" and "a"
+        let (count, out) = compile_lines(TYPE_STRING, lines(&["Yg==", "YQ=="])).unwrap();
+        assert_eq!(count, 2);
+        assert_eq!(&out[40..48], &0u64.to_ne_bytes());
+        assert_eq!(&out[48..56], &7u64.to_ne_bytes());
+        assert_eq!(out[56 + 6], b'a');
+        assert_eq!(out[56 + 7 + 6], b'b');
+    }
+
+    #[test]
+    fn test_compile_errors() {
+        assert!(compile_lines(TYPE_MD5, lines(&["00"])).is_err());
+        assert!(compile_lines(TYPE_IPV4, lines(&["10.0.0.1", "10.0.0.2,1"])).is_err());
+        assert!(compile_lines(TYPE_IPV4, lines(&["10.0.0.1,x"])).is_err());
+    }
+}
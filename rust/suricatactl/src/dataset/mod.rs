@@ -0,0 +1,4 @@
+// SPDX-FileCopyrightText: Copyright 2025 Open Information Security Foundation
+// SPDX-License-Identifier: GPL-2.0-only
+
+pub(crate) mod compile;
@@ -10,6 +10,7 @@ use clap::Parser;
 use clap::Subcommand;
 use tracing::Level;
 
+mod dataset;
 mod filestore;
 
 #[derive(Parser, Debug)]
@@ -31,10 +32,38 @@ struct Cli {
 
 #[derive(Subcommand, Debug)]
 enum Commands {
+    /// Dataset management commands
+    Dataset(DatasetCommand),
     /// Filestore management commands
     Filestore(FilestoreCommand),
 }
 
+#[derive(Parser, Debug)]
+struct DatasetCommand {
+    #[command(subcommand)]
+    command: DatasetCommands,
+}
+
+#[derive(Subcommand, Debug)]
+enum DatasetCommands {
+    /// Compile a dataset file into a read-only memory mappable set
+    Compile(DatasetCompileArgs),
+}
+
+#[derive(Parser, Debug)]
+struct DatasetCompileArgs {
+    #[arg(
+        long = "type",
+        short,
+        help = "dataset type: string, md5, sha256, ipv4 or ip"
+    )]
+    set_type: String,
+    #[arg(long, short, help = "compiled dataset output file")]
+    output: String,
+    #[arg(help = "dataset file to compile")]
+    input: String,
+}
+
 #[derive(Parser, Debug)]
 struct FilestoreCommand {
     #[command(subcommand)]
@@ -70,6 +99,9 @@ fn main() -> Result<(), Box<dyn std::error::Error>> {
     tracing_subscriber::fmt().with_max_level(log_level).init();
 
     match cli.command {
+        Commands::Dataset(dataset) => match dataset.command {
+            DatasetCommands::Compile(args) => crate::dataset::compile::compile(args),
+        },
         Commands::Filestore(filestore) => match filestore.command {
             FilestoreCommands::Prune(args) => crate::filestore::prune::prune(args),
         },
@@ -339,6 +339,35 @@ fn command_defs() -> Result<HashMap<String, Vec<Argument>>, serde_json::Error> {
 		"type": "string",
             },
 	],
+	"iprep-add": [
+            {
+		"name": "ip",
+		"required": true,
+		"type": "string",
+            },
+            {
+		"name": "category",
+		"required": true,
+		"type": "string",
+            },
+            {
+		"name": "value",
+		"required": true,
+		"type": "number",
+            },
+	],
+	"iprep-remove": [
+            {
+		"name": "ip",
+		"required": true,
+		"type": "string",
+            },
+            {
+		"name": "category",
+		"required": true,
+		"type": "string",
+            },
+	],
 	"memcap-set": [
             {
 		"name": "config",
@@ -450,6 +479,28 @@ fn command_defs() -> Result<HashMap<String, Vec<Argument>>, serde_json::Error> {
 		"type": "string",
             },
 	],
+	"dataset-bulk": [
+            {
+		"name": "setname",
+		"required": true,
+		"type": "string",
+            },
+            {
+		"name": "settype",
+		"required": true,
+		"type": "string",
+            },
+            {
+		"name": "mode",
+		"required": true,
+		"type": "string",
+            },
+            {
+		"name": "datafile",
+		"required": true,
+		"type": "string",
+            },
+	],
     });
     serde_json::from_value(defs)
 }
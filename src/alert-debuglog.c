@@ -80,11 +80,11 @@ static void AlertDebugLogFlowVars(AlertDebugLogThread *aft, const Packet *p)
     uint16_t i;
     while (gv != NULL) {
         if (gv->type == DETECT_FLOWBITS) {
-            FlowBit *fb = (FlowBit *)gv;
-            const char *fbname = VarNameStoreLookupById(fb->idx, VAR_TYPE_FLOW_BIT);
-            if (fbname) {
-                MemBufferWriteString(aft->buffer, "FLOWBIT:           %s\n",
-                        fbname);
+            for (uint32_t idx = 0; FlowBitGetNext(p->flow, &idx); idx++) {
+                const char *fbname = VarNameStoreLookupById(idx, VAR_TYPE_FLOW_BIT);
+                if (fbname) {
+                    MemBufferWriteString(aft->buffer, "FLOWBIT:           %s\n", fbname);
+                }
             }
         } else if (gv->type == DETECT_FLOWVAR || gv->type == DETECT_FLOWINT) {
             FlowVar *fv = (FlowVar *) gv;
@@ -0,0 +1,283 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Cache of the protocol detected for a server ip, port and ipproto.
+ *
+ * Flows to the same server endpoint almost always carry the same protocol.
+ * Each full protocol detection of the toserver side of a flow is recorded
+ * here. Once the same protocol was detected min-hits times in a row for an
+ * endpoint, new flows to it only run the probing parser of that protocol
+ * on their first data. Full detection is used if the probing parser doesn't
+ * confirm the protocol. Entries expire after the timeout, so the protocol
+ * of an endpoint is detected again from time to time.
+ */
+
+#include "suricata-common.h"
+#include "app-layer-detect-proto-cache.h"
+#include "conf.h"
+#include "util-debug.h"
+#include "util-hash-lookup3.h"
+#include "util-thash.h"
+#include "util-unittest.h"
+
+#define ALPD_CACHE_DEFAULT_MEMCAP   (16 * 1024 * 1024)
+#define ALPD_CACHE_DEFAULT_HASHSIZE 32768
+#define ALPD_CACHE_DEFAULT_TIMEOUT  3600
+#define ALPD_CACHE_DEFAULT_MIN_HITS 2
+
+typedef struct AppLayerProtoCacheEntry_ {
+    /* key: server ip, port and ipproto */
+    uint32_t addr[4];
+    uint16_t port;
+    uint8_t ipproto;
+    uint8_t family;
+
+    AppProto alproto;
+    /** times in a row alproto was detected for the server */
+    uint16_t hits;
+    SCTime_t expire;
+} AppLayerProtoCacheEntry;
+
+static struct {
+    THashTableContext *hash;
+    uint32_t timeout;
+    uint16_t min_hits;
+} alpd_cache = { NULL, ALPD_CACHE_DEFAULT_TIMEOUT, ALPD_CACHE_DEFAULT_MIN_HITS };
+
+static int AppLayerProtoCacheEntrySet(void *dst, void *src)
+{
+    AppLayerProtoCacheEntry *edst = dst;
+    const AppLayerProtoCacheEntry *esrc = src;
+    *edst = *esrc;
+    return 0;
+}
+
+static void AppLayerProtoCacheEntryFree(void *ptr)
+{
+    // nothing to free, base data is part of hash
+}
+
+static uint32_t AppLayerProtoCacheEntryHash(uint32_t seed, void *ptr)
+{
+    const AppLayerProtoCacheEntry *e = ptr;
+    return hashword(e->addr, 4, seed) + ((uint32_t)e->ipproto << 16 | e->port);
+}
+
+static bool AppLayerProtoCacheEntryCompare(void *a, void *b)
+{
+    const AppLayerProtoCacheEntry *e1 = a;
+    const AppLayerProtoCacheEntry *e2 = b;
+    return e1->port == e2->port && e1->ipproto == e2->ipproto && e1->family == e2->family &&
+           memcmp(e1->addr, e2->addr, sizeof(e1->addr)) == 0;
+}
+
+static bool AppLayerProtoCacheEntryExpired(void *data, SCTime_t ts)
+{
+    const AppLayerProtoCacheEntry *e = data;
+    return SCTIME_CMP_LTE(e->expire, ts);
+}
+
+static uint32_t AppLayerProtoCacheEntrySize(void *data)
+{
+    return 0;
+}
+
+/** \internal
+ *  \brief set up the key for the server of the flow: the destination of
+ *         the toserver direction */
+static void AppLayerProtoCacheKey(const Flow *f, AppLayerProtoCacheEntry *e)
+{
+    memset(e, 0, sizeof(*e));
+    if (FLOW_IS_IPV4(f)) {
+        e->family = AF_INET;
+        e->addr[0] = f->dst.addr_data32[0];
+    } else {
+        e->family = AF_INET6;
+        memcpy(e->addr, f->dst.addr_data32, sizeof(e->addr));
+    }
+    e->port = f->dp;
+    e->ipproto = f->proto;
+}
+
+void AppLayerProtoCacheSetup(void)
+{
+    int enabled = 0;
+    if (SCConfGetBool("app-layer.detection-cache.enabled", &enabled) != 1 || !enabled)
+        return;
+
+    intmax_t value = 0;
+    if (SCConfGetInt("app-layer.detection-cache.timeout", &value) == 1) {
+        if (value <= 0 || value > UINT32_MAX) {
+            FatalError("invalid value for app-layer.detection-cache.timeout: %" PRIdMAX, value);
+        }
+        alpd_cache.timeout = (uint32_t)value;
+    }
+    if (SCConfGetInt("app-layer.detection-cache.min-hits", &value) == 1) {
+        if (value <= 0 || value > UINT16_MAX) {
+            FatalError("invalid value for app-layer.detection-cache.min-hits: %" PRIdMAX, value);
+        }
+        alpd_cache.min_hits = (uint16_t)value;
+    }
+
+    alpd_cache.hash = THashInit("app-layer.detection-cache", sizeof(AppLayerProtoCacheEntry),
+            AppLayerProtoCacheEntrySet, AppLayerProtoCacheEntryFree, AppLayerProtoCacheEntryHash,
+            AppLayerProtoCacheEntryCompare, AppLayerProtoCacheEntryExpired,
+            AppLayerProtoCacheEntrySize, false, ALPD_CACHE_DEFAULT_MEMCAP,
+            ALPD_CACHE_DEFAULT_HASHSIZE);
+    if (alpd_cache.hash == NULL) {
+        FatalError("failed to set up the protocol detection cache");
+    }
+    SCLogConfig("protocol detection cache enabled: timeout %us, min-hits %u",
+            alpd_cache.timeout, alpd_cache.min_hits);
+}
+
+void AppLayerProtoCacheDeSetup(void)
+{
+    if (alpd_cache.hash != NULL) {
+        THashShutdown(alpd_cache.hash);
+        alpd_cache.hash = NULL;
+    }
+    alpd_cache.timeout = ALPD_CACHE_DEFAULT_TIMEOUT;
+    alpd_cache.min_hits = ALPD_CACHE_DEFAULT_MIN_HITS;
+}
+
+bool AppLayerProtoCacheEnabled(void)
+{
+    return alpd_cache.hash != NULL;
+}
+
+/**
+ *  \brief get the protocol the server of the flow was detected as
+ *
+ *  \retval alproto protocol detected at least min-hits times in a row
+ *  \retval ALPROTO_UNKNOWN no such protocol, or the entry expired
+ */
+AppProto AppLayerProtoCacheLookup(const Flow *f)
+{
+    AppLayerProtoCacheEntry lookup;
+    AppLayerProtoCacheKey(f, &lookup);
+
+    AppProto alproto = ALPROTO_UNKNOWN;
+    THashData *d = THashLookupFromHash(alpd_cache.hash, &lookup);
+    if (d != NULL) {
+        const AppLayerProtoCacheEntry *e = d->data;
+        if (e->hits >= alpd_cache.min_hits && SCTIME_CMP_GT(e->expire, f->lastts)) {
+            alproto = e->alproto;
+        }
+        (void)THashDecrUsecnt(d);
+        THashDataUnlock(d);
+    }
+    return alproto;
+}
+
+/**
+ *  \brief record the protocol full detection found for the flow's server
+ */
+void AppLayerProtoCacheUpdate(const Flow *f, const AppProto alproto)
+{
+    AppLayerProtoCacheEntry lookup;
+    AppLayerProtoCacheKey(f, &lookup);
+    lookup.alproto = alproto;
+    lookup.hits = 1;
+    lookup.expire = SCTIME_ADD_SECS(f->lastts, alpd_cache.timeout);
+
+    struct THashDataGetResult res = THashGetFromHash(alpd_cache.hash, &lookup);
+    if (res.data == NULL)
+        return;
+
+    if (!res.is_new) {
+        AppLayerProtoCacheEntry *e = res.data->data;
+        if (e->alproto == alproto && SCTIME_CMP_GT(e->expire, f->lastts)) {
+            if (e->hits < UINT16_MAX)
+                e->hits++;
+        } else {
+            e->alproto = alproto;
+            e->hits = 1;
+            e->expire = lookup.expire;
+        }
+        SCLogDebug("%s for port %u, hits %u", AppProtoToString(alproto), e->port, e->hits);
+    }
+    (void)THashDecrUsecnt(res.data);
+    THashDataUnlock(res.data);
+}
+
+#ifdef UNITTESTS
+static void AppLayerProtoCacheTestFlow(Flow *f, const uint32_t addr, const uint16_t port)
+{
+    memset(f, 0, sizeof(*f));
+    f->flags = FLOW_IPV4;
+    f->proto = IPPROTO_TCP;
+    f->dst.addr_data32[0] = addr;
+    f->dp = port;
+    f->lastts = SCTIME_FROM_SECS(1000);
+}
+
+static int AppLayerProtoCacheTest01(void)
+{
+    SCConfCreateContextBackup();
+    SCConfInit();
+    FAIL_IF(SCConfSetFinal("app-layer.detection-cache.enabled", "yes") != 1);
+    FAIL_IF(SCConfSetFinal("app-layer.detection-cache.timeout", "60") != 1);
+    AppLayerProtoCacheSetup();
+    FAIL_IF_NOT(AppLayerProtoCacheEnabled());
+
+    Flow f;
+    AppLayerProtoCacheTestFlow(&f, 0x0100000a, 8443);
+    FAIL_IF(AppLayerProtoCacheLookup(&f) != ALPROTO_UNKNOWN);
+
+    /* only used once detected min-hits times */
+    AppLayerProtoCacheUpdate(&f, ALPROTO_TLS);
+    FAIL_IF(AppLayerProtoCacheLookup(&f) != ALPROTO_UNKNOWN);
+    AppLayerProtoCacheUpdate(&f, ALPROTO_TLS);
+    FAIL_IF(AppLayerProtoCacheLookup(&f) != ALPROTO_TLS);
+
+    /* other port, other server */
+    Flow f2;
+    AppLayerProtoCacheTestFlow(&f2, 0x0100000a, 8444);
+    FAIL_IF(AppLayerProtoCacheLookup(&f2) != ALPROTO_UNKNOWN);
+    AppLayerProtoCacheTestFlow(&f2, 0x0200000a, 8443);
+    FAIL_IF(AppLayerProtoCacheLookup(&f2) != ALPROTO_UNKNOWN);
+
+    /* a different protocol resets the count */
+    AppLayerProtoCacheUpdate(&f, ALPROTO_SSH);
+    FAIL_IF(AppLayerProtoCacheLookup(&f) != ALPROTO_UNKNOWN);
+    AppLayerProtoCacheUpdate(&f, ALPROTO_SSH);
+    FAIL_IF(AppLayerProtoCacheLookup(&f) != ALPROTO_SSH);
+
+    /* expired */
+    f.lastts = SCTIME_FROM_SECS(1060);
+    FAIL_IF(AppLayerProtoCacheLookup(&f) != ALPROTO_UNKNOWN);
+    AppLayerProtoCacheUpdate(&f, ALPROTO_SSH);
+    FAIL_IF(AppLayerProtoCacheLookup(&f) != ALPROTO_UNKNOWN);
+
+    AppLayerProtoCacheDeSetup();
+    FAIL_IF(AppLayerProtoCacheEnabled());
+    SCConfDeInit();
+    SCConfRestoreContextBackup();
+    PASS;
+}
+#endif /* UNITTESTS */
+
+void AppLayerProtoCacheRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("AppLayerProtoCacheTest01", AppLayerProtoCacheTest01);
+#endif
+}
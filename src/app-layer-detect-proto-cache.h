@@ -0,0 +1,38 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Cache of the protocol detected for a server ip, port and ipproto.
+ */
+
+#ifndef SURICATA_APP_LAYER_DETECT_PROTO_CACHE_H
+#define SURICATA_APP_LAYER_DETECT_PROTO_CACHE_H
+
+#include "flow.h"
+
+void AppLayerProtoCacheSetup(void);
+void AppLayerProtoCacheDeSetup(void);
+bool AppLayerProtoCacheEnabled(void);
+
+AppProto AppLayerProtoCacheLookup(const Flow *f);
+void AppLayerProtoCacheUpdate(const Flow *f, const AppProto alproto);
+
+void AppLayerProtoCacheRegisterTests(void);
+
+#endif /* SURICATA_APP_LAYER_DETECT_PROTO_CACHE_H */
@@ -98,9 +98,25 @@ typedef struct AppLayerProtoDetectProbingParserPort_ {
     struct AppLayerProtoDetectProbingParserPort_ *next;
 } AppLayerProtoDetectProbingParserPort;
 
+/** \brief flattened port lookup for the probing parsers of an ipproto
+ *
+ *  Built from the port list when protocol detection is prepared, so that
+ *  finding the parsers for a port is a direct index instead of a walk over
+ *  the list, which has an entry for each port of a registered port range. */
+typedef struct AppLayerProtoDetectProbingParserPortMap_ {
+    /** port -> index in `ports`. 0 means no probing parsers for the port. */
+    uint16_t map[UINT16_MAX + 1];
+    AppLayerProtoDetectProbingParserPort **ports; /**< ports[0] is always NULL */
+} AppLayerProtoDetectProbingParserPortMap;
+
 typedef struct AppLayerProtoDetectProbingParser_ {
     uint8_t ipproto;
     AppLayerProtoDetectProbingParserPort *port;
+    /** lookup table for `port`, NULL if not built */
+    AppLayerProtoDetectProbingParserPortMap *port_map;
+    /** probing parser of each protocol, g_alproto_max entries. Built
+     *  with `port_map`. */
+    const AppLayerProtoDetectProbingParserElement **alproto_pe;
 
     struct AppLayerProtoDetectProbingParser_ *next;
 } AppLayerProtoDetectProbingParser;
@@ -447,6 +463,11 @@ static AppLayerProtoDetectProbingParserPort *AppLayerProtoDetectGetProbingParser
     if (pp == NULL)
         goto end;
 
+    if (pp->port_map != NULL) {
+        pp_port = pp->port_map->ports[pp->port_map->map[port]];
+        goto end;
+    }
+
     pp_port = pp->port;
     while (pp_port != NULL) {
         // always check use_ports
@@ -779,10 +800,102 @@ static AppLayerProtoDetectProbingParser *AppLayerProtoDetectProbingParserAlloc(v
     SCReturnPtr(p, "AppLayerProtoDetectProbingParser");
 }
 
+static void AppLayerProtoDetectProbingParserPortMapFree(AppLayerProtoDetectProbingParserPortMap *m)
+{
+    if (m == NULL)
+        return;
+    SCFree(m->ports);
+    SCFree(m);
+}
+
+/** \internal
+ *  \brief flatten the port list of \a pp into a lookup table
+ *
+ *  A port maps to the first entry in the list that is for that port or for
+ *  any port (port 0), like the list walk in
+ *  AppLayerProtoDetectGetProbingParsers. Entries that are not used by port
+ *  are skipped.
+ *
+ *  \retval map or NULL if the list can't be indexed with u16 or on
+ *          allocation failure, in which case the list walk is used */
+static AppLayerProtoDetectProbingParserPortMap *AppLayerProtoDetectProbingParserPortMapBuild(
+        const AppLayerProtoDetectProbingParser *pp)
+{
+    uint32_t cnt = 1;
+    for (const AppLayerProtoDetectProbingParserPort *p = pp->port; p != NULL; p = p->next) {
+        if (p->use_ports)
+            cnt++;
+    }
+    if (cnt == 1 || cnt - 1 > UINT16_MAX)
+        return NULL;
+
+    AppLayerProtoDetectProbingParserPortMap *m = SCCalloc(1, sizeof(*m));
+    if (m == NULL)
+        return NULL;
+    m->ports = SCCalloc(cnt, sizeof(AppLayerProtoDetectProbingParserPort *));
+    if (m->ports == NULL) {
+        SCFree(m);
+        return NULL;
+    }
+
+    uint32_t idx = 1;
+    bool any = false;
+    for (AppLayerProtoDetectProbingParserPort *p = pp->port; p != NULL; p = p->next) {
+        if (!p->use_ports)
+            continue;
+        m->ports[idx] = p;
+        if (p->port == 0) {
+            /* runs on any port not matched by an earlier entry */
+            if (!any) {
+                for (uint32_t port = 0; port <= UINT16_MAX; port++) {
+                    if (m->map[port] == 0)
+                        m->map[port] = (uint16_t)idx;
+                }
+                any = true;
+            }
+        } else if (m->map[p->port] == 0) {
+            m->map[p->port] = (uint16_t)idx;
+        }
+        idx++;
+    }
+    SCLogDebug("ipproto %u: %u port entries", pp->ipproto, cnt - 1);
+    return m;
+}
+
+/** \internal
+ *  \brief get the first probing parser of each protocol that is used by port
+ *
+ *  Parsers registered for the destination port are preferred, so that their
+ *  ProbingParserTs is the toserver parser. */
+static const AppLayerProtoDetectProbingParserElement **AppLayerProtoDetectProbingParserMapAlprotos(
+        const AppLayerProtoDetectProbingParser *pp)
+{
+    const AppLayerProtoDetectProbingParserElement **pes =
+            SCCalloc(g_alproto_max, sizeof(AppLayerProtoDetectProbingParserElement *));
+    if (pes == NULL)
+        return NULL;
+
+    for (int sp = 0; sp < 2; sp++) {
+        for (const AppLayerProtoDetectProbingParserPort *p = pp->port; p != NULL; p = p->next) {
+            if (!p->use_ports)
+                continue;
+            const AppLayerProtoDetectProbingParserElement *pe = sp ? p->sp : p->dp;
+            for (; pe != NULL; pe = pe->next) {
+                if (pes[pe->alproto] == NULL)
+                    pes[pe->alproto] = pe;
+            }
+        }
+    }
+    return pes;
+}
+
 static void AppLayerProtoDetectProbingParserFree(AppLayerProtoDetectProbingParser *p)
 {
     SCEnter();
 
+    AppLayerProtoDetectProbingParserPortMapFree(p->port_map);
+    SCFree(p->alproto_pe);
+
     AppLayerProtoDetectProbingParserPort *pt = p->port;
     while (pt != NULL) {
         AppLayerProtoDetectProbingParserPort *pt_next = pt->next;
@@ -983,6 +1096,12 @@ static void AppLayerProtoDetectInsertNewProbingParser(AppLayerProtoDetectProbing
         AppLayerProtoDetectProbingParserAppend(pp, new_pp);
         curr_pp = new_pp;
     }
+    /* the lookup table no longer matches the list, it is rebuilt when
+     * protocol detection is prepared again */
+    AppLayerProtoDetectProbingParserPortMapFree(curr_pp->port_map);
+    curr_pp->port_map = NULL;
+    SCFree(curr_pp->alproto_pe);
+    curr_pp->alproto_pe = NULL;
 
     /* get the top level port pp */
     AppLayerProtoDetectProbingParserPort *curr_port = curr_pp->port;
@@ -1437,6 +1556,62 @@ AppProto AppLayerProtoDetectGetProto(AppLayerProtoDetectThreadCtx *tctx, Flow *f
     SCReturnUInt(alproto);
 }
 
+/** \internal
+ *  \brief get the probing parser of \a alproto for \a ipproto
+ *  \retval pe parser or NULL if there is none or the lookup table is not
+ *          built */
+static const AppLayerProtoDetectProbingParserElement *AppLayerProtoDetectGetAlprotoProbingParser(
+        const uint8_t ipproto, const AppProto alproto)
+{
+    for (const AppLayerProtoDetectProbingParser *pp = alpd_ctx.ctx_pp; pp != NULL; pp = pp->next) {
+        if (pp->ipproto == ipproto) {
+            if (pp->alproto_pe == NULL || alproto >= g_alproto_max)
+                return NULL;
+            return pp->alproto_pe[alproto];
+        }
+    }
+    return NULL;
+}
+
+/**
+ *  \brief check if \a alproto has a probing parser that
+ *         AppLayerProtoDetectCheckProto can use
+ */
+bool AppLayerProtoDetectHasProbingParser(const uint8_t ipproto, const AppProto alproto)
+{
+    return AppLayerProtoDetectGetAlprotoProbingParser(ipproto, alproto) != NULL;
+}
+
+/**
+ *  \brief check the data against the probing parser of a single protocol
+ *
+ *  Confirms a protocol that is expected for the flow without running full
+ *  protocol detection.
+ *
+ *  \retval alproto if the probing parser recognized the data in the
+ *          direction it was seen in
+ *  \retval ALPROTO_UNKNOWN otherwise
+ */
+AppProto AppLayerProtoDetectCheckProto(Flow *f, const uint8_t *buf, uint32_t buflen,
+        const uint8_t ipproto, const uint8_t flags, const AppProto alproto)
+{
+    const AppLayerProtoDetectProbingParserElement *pe =
+            AppLayerProtoDetectGetAlprotoProbingParser(ipproto, alproto);
+    if (pe == NULL || buflen < pe->min_depth)
+        return ALPROTO_UNKNOWN;
+
+    ProbingParserFPtr ProbingParser =
+            (flags & STREAM_TOSERVER) ? pe->ProbingParserTs : pe->ProbingParserTc;
+    if (ProbingParser == NULL)
+        return ALPROTO_UNKNOWN;
+
+    uint8_t rdir = 0;
+    const AppProto r = ProbingParser(f, flags, buf, buflen, &rdir);
+    if (r != alproto || (rdir != 0 && rdir != (flags & (STREAM_TOSERVER | STREAM_TOCLIENT))))
+        return ALPROTO_UNKNOWN;
+    return alproto;
+}
+
 static void AppLayerProtoDetectFreeProbingParsers(AppLayerProtoDetectProbingParser *pp)
 {
     SCEnter();
@@ -1504,6 +1679,13 @@ int AppLayerProtoDetectPrepareState(void)
         }
     }
 
+    for (AppLayerProtoDetectProbingParser *pp = alpd_ctx.ctx_pp; pp != NULL; pp = pp->next) {
+        AppLayerProtoDetectProbingParserPortMapFree(pp->port_map);
+        pp->port_map = AppLayerProtoDetectProbingParserPortMapBuild(pp);
+        SCFree(pp->alproto_pe);
+        pp->alproto_pe = AppLayerProtoDetectProbingParserMapAlprotos(pp);
+    }
+
 #ifdef DEBUG
     if (SCLogDebugEnabled()) {
         AppLayerProtoDetectPrintProbingParsers(alpd_ctx.ctx_pp);
@@ -3520,6 +3702,58 @@ static int AppLayerProtoDetectTest19(void)
      return result;
 }
 
+/** \test port lookup table gives the same parsers as the port list */
+static int AppLayerProtoDetectTest20(void)
+{
+    AppLayerProtoDetectUnittestCtxBackup();
+    AppLayerProtoDetectSetup();
+
+    SCAppLayerProtoDetectPPRegister(IPPROTO_TCP, "80", ALPROTO_HTTP1, 5, 8, STREAM_TOSERVER,
+            ProbingParserDummyForTesting, NULL);
+    SCAppLayerProtoDetectPPRegister(IPPROTO_TCP, "[1024:2048,8080]", ALPROTO_SMB, 5, 6,
+            STREAM_TOSERVER, ProbingParserDummyForTesting, NULL);
+    SCAppLayerProtoDetectPPRegister(IPPROTO_TCP, "0", ALPROTO_TLS, 12, 18, STREAM_TOSERVER,
+            ProbingParserDummyForTesting, NULL);
+    SCAppLayerProtoDetectPPRegister(IPPROTO_TCP, NULL, ALPROTO_WEBSOCKET, 2, 0, STREAM_TOSERVER,
+            ProbingParserDummyForTesting, NULL);
+    SCAppLayerProtoDetectPPRegister(IPPROTO_UDP, "53", ALPROTO_DNS, 12, 0, STREAM_TOSERVER,
+            ProbingParserDummyForTesting, NULL);
+
+    const uint8_t ipprotos[2] = { IPPROTO_TCP, IPPROTO_UDP };
+    AppLayerProtoDetectProbingParserPort **expect =
+            SCCalloc(UINT16_MAX + 1, sizeof(AppLayerProtoDetectProbingParserPort *));
+    FAIL_IF_NULL(expect);
+
+    for (int i = 0; i < 2; i++) {
+        for (uint32_t port = 0; port <= UINT16_MAX; port++) {
+            expect[port] = AppLayerProtoDetectGetProbingParsers(
+                    alpd_ctx.ctx_pp, ipprotos[i], (uint16_t)port);
+        }
+        FAIL_IF(AppLayerProtoDetectPrepareState() != 0);
+        for (AppLayerProtoDetectProbingParser *pp = alpd_ctx.ctx_pp; pp != NULL; pp = pp->next) {
+            FAIL_IF_NULL(pp->port_map);
+        }
+        for (uint32_t port = 0; port <= UINT16_MAX; port++) {
+            FAIL_IF(AppLayerProtoDetectGetProbingParsers(
+                            alpd_ctx.ctx_pp, ipprotos[i], (uint16_t)port) != expect[port]);
+        }
+        /* registering drops the table until the next prepare */
+        SCAppLayerProtoDetectPPRegister(IPPROTO_UDP, "5353", ALPROTO_DNS, 12, 0,
+                STREAM_TOSERVER, ProbingParserDummyForTesting, NULL);
+        for (AppLayerProtoDetectProbingParser *pp = alpd_ctx.ctx_pp; pp != NULL; pp = pp->next) {
+            if (pp->ipproto == IPPROTO_UDP)
+                FAIL_IF_NOT_NULL(pp->port_map);
+        }
+    }
+    FAIL_IF(AppLayerProtoDetectGetProbingParsers(alpd_ctx.ctx_pp, IPPROTO_TCP, 1500) == NULL);
+    FAIL_IF(AppLayerProtoDetectGetProbingParsers(alpd_ctx.ctx_pp, IPPROTO_UDP, 54) != NULL);
+
+    SCFree(expect);
+    AppLayerProtoDetectDeSetup();
+    AppLayerProtoDetectUnittestCtxRestore();
+    PASS;
+}
+
 void AppLayerProtoDetectUnittestsRegister(void)
 {
     SCEnter();
@@ -3543,6 +3777,7 @@ void AppLayerProtoDetectUnittestsRegister(void)
     UtRegisterTest("AppLayerProtoDetectTest17", AppLayerProtoDetectTest17);
     UtRegisterTest("AppLayerProtoDetectTest18", AppLayerProtoDetectTest18);
     UtRegisterTest("AppLayerProtoDetectTest19", AppLayerProtoDetectTest19);
+    UtRegisterTest("AppLayerProtoDetectTest20", AppLayerProtoDetectTest20);
 
     SCReturn;
 }
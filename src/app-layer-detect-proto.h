@@ -52,6 +52,10 @@ typedef AppProto (*ProbingParserFPtr)(
 AppProto AppLayerProtoDetectGetProto(AppLayerProtoDetectThreadCtx *tctx, Flow *f,
         const uint8_t *buf, uint32_t buflen, uint8_t ipproto, uint8_t flags, bool *reverse_flow);
 
+bool AppLayerProtoDetectHasProbingParser(const uint8_t ipproto, const AppProto alproto);
+AppProto AppLayerProtoDetectCheckProto(Flow *f, const uint8_t *buf, uint32_t buflen,
+        const uint8_t ipproto, const uint8_t flags, const AppProto alproto);
+
 /***** State Preparation *****/
 
 /**
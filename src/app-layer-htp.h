@@ -139,6 +139,10 @@ typedef struct HtpBody_ {
     uint64_t body_parsed;
     /* inspection tracker */
     uint64_t body_inspected;
+    /* mpm tracker: body scanned by the prefilter up to here, by the
+     * detect engine with this version */
+    uint64_t body_prefiltered;
+    uint32_t body_prefiltered_version;
 } HtpBody;
 
 #define HTP_BOUNDARY_SET        BIT_U8(1)    /**< We have a boundary string */
@@ -33,6 +33,7 @@
 #include "app-layer-ftp.h"
 #include "app-layer-htp-range.h"
 #include "app-layer-detect-proto.h"
+#include "app-layer-detect-proto-cache.h"
 #include "app-layer-frames.h"
 #include "app-layer-events.h"
 #include "stream-tcp-reassemble.h"
@@ -103,6 +104,13 @@ AppLayerCounters (*applayer_counters)[FLOW_PROTO_APPLAYER_MAX];
 /* Exception policy global counters ids */
 ExceptionPolicyCounters eps_error_summary;
 
+/* protocol detection cache counters ids */
+static struct {
+    StatsCounterId hit;      /**< protocol confirmed from the cache */
+    StatsCounterId miss;     /**< no usable entry for the server */
+    StatsCounterId mismatch; /**< entry not confirmed by the data */
+} alpd_cache_counters;
+
 /* Settings order as in the enum */
 // clang-format off
 ExceptionPolicyStatsSetts app_layer_error_eps_stats = {
@@ -142,6 +150,13 @@ static inline int ProtoDetectDone(const Flow *f, const TcpSession *ssn, uint8_t
             (FLOW_IS_PM_DONE(f, direction) && FLOW_IS_PP_DONE(f, direction)));
 }
 
+static inline void AppLayerIncCounter(ThreadVars *tv, const StatsCounterId id)
+{
+    if (likely(tv && id.id > 0)) {
+        StatsCounterIncr(&tv->stats, id);
+    }
+}
+
 /**
  * \note id can be 0 if protocol parser is disabled but detection
  *       is enabled.
@@ -383,6 +398,44 @@ static int TCPProtoDetectTriggerOpposingSide(ThreadVars *tv, TcpReassemblyThread
 
 extern enum ExceptionPolicy g_applayerparser_error_policy;
 
+/** \internal
+ *  \brief run protocol detection on the data
+ *
+ *  If the protocol detection cache is enabled, toserver data is first
+ *  checked against the protocol earlier flows to the same server were
+ *  detected as. Full detection is only run if that protocol's probing
+ *  parser doesn't confirm it, and its result is recorded in the cache.
+ */
+static AppProto AppLayerDetectProto(ThreadVars *tv, AppLayerThreadCtx *app_tctx, Flow *f,
+        const uint8_t *data, uint32_t data_len, uint8_t ipproto, uint8_t flags, bool *reverse_flow)
+{
+    const bool use_cache = AppLayerProtoCacheEnabled() && (flags & STREAM_TOSERVER) &&
+                           data_len > 0 && f->alproto_expect == ALPROTO_UNKNOWN &&
+                           !FlowChangeProto(f);
+    if (use_cache) {
+        const AppProto cached = AppLayerProtoCacheLookup(f);
+        if (cached != ALPROTO_UNKNOWN) {
+            if (AppLayerProtoDetectCheckProto(f, data, data_len, ipproto, flags, cached) ==
+                    cached) {
+                SCLogDebug("%s confirmed from cache", AppProtoToString(cached));
+                AppLayerIncCounter(tv, alpd_cache_counters.hit);
+                return cached;
+            }
+            AppLayerIncCounter(tv, alpd_cache_counters.mismatch);
+        } else {
+            AppLayerIncCounter(tv, alpd_cache_counters.miss);
+        }
+    }
+
+    const AppProto alproto = AppLayerProtoDetectGetProto(
+            app_tctx->alpd_tctx, f, data, data_len, ipproto, flags, reverse_flow);
+    if (use_cache && AppProtoIsValid(alproto) && !*reverse_flow &&
+            AppLayerProtoDetectHasProbingParser(ipproto, alproto)) {
+        AppLayerProtoCacheUpdate(f, alproto);
+    }
+    return alproto;
+}
+
 /** \todo data const
  *  \retval int -1 error
  *  \retval int 0 ok
@@ -417,9 +470,8 @@ static int TCPProtoDetect(ThreadVars *tv, TcpReassemblyThreadCtx *ra_ctx,
     bool reverse_flow = false;
     DEBUG_VALIDATE_BUG_ON(data == NULL && data_len > 0);
     PACKET_PROFILING_APP_PD_START(app_tctx);
-    *alproto = AppLayerProtoDetectGetProto(app_tctx->alpd_tctx,
-            f, data, data_len,
-            IPPROTO_TCP, flags, &reverse_flow);
+    *alproto = AppLayerDetectProto(
+            tv, app_tctx, f, data, data_len, IPPROTO_TCP, flags, &reverse_flow);
     PACKET_PROFILING_APP_PD_END(app_tctx);
     SCLogDebug("alproto %u rev %s", *alproto, reverse_flow ? "true" : "false");
 
@@ -902,8 +954,8 @@ int AppLayerHandleUdp(ThreadVars *tv, AppLayerThreadCtx *tctx, Packet *p, Flow *
 
         bool reverse_flow = false;
         PACKET_PROFILING_APP_PD_START(tctx);
-        *alproto = AppLayerProtoDetectGetProto(
-                tctx->alpd_tctx, f, p->payload, p->payload_len, IPPROTO_UDP, flags, &reverse_flow);
+        *alproto = AppLayerDetectProto(
+                tv, tctx, f, p->payload, p->payload_len, IPPROTO_UDP, flags, &reverse_flow);
         PACKET_PROFILING_APP_PD_END(tctx);
 
         switch (*alproto) {
@@ -1081,6 +1133,7 @@ int AppLayerSetup(void)
 
     AppLayerParserRegisterProtocolParsers();
     AppLayerProtoDetectPrepareState();
+    AppLayerProtoCacheSetup();
 
     AppLayerSetupCounters();
     FrameConfigInit();
@@ -1094,6 +1147,7 @@ int AppLayerDeSetup(void)
 
     AppLayerProtoDetectDeSetup();
     AppLayerParserDeSetup();
+    AppLayerProtoCacheDeSetup();
 
     AppLayerDeSetupCounters();
     FrameConfigDeInit();
@@ -1306,6 +1360,14 @@ void AppLayerRegisterThreadCounters(ThreadVars *tv)
     AppProto alprotos[g_alproto_max];
     AppLayerProtoDetectSupportedAppProtocols(alprotos);
 
+    if (AppLayerProtoCacheEnabled()) {
+        alpd_cache_counters.hit = StatsRegisterCounter("app_layer.detect_cache.hit", &tv->stats);
+        alpd_cache_counters.miss =
+                StatsRegisterCounter("app_layer.detect_cache.miss", &tv->stats);
+        alpd_cache_counters.mismatch =
+                StatsRegisterCounter("app_layer.detect_cache.mismatch", &tv->stats);
+    }
+
     /* We don't log stats counters if exception policy is `ignore`/`not set` */
     if (g_applayerparser_error_policy != EXCEPTION_POLICY_NOT_SET) {
         /* Register global counters for app layer error exception policy summary */
@@ -0,0 +1,297 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Read-only compiled datasets.
+ *
+ * A compiled dataset is a file with sorted keys that is mapped into memory
+ * as is. Loading it costs no parsing or hashing, the pages are shared with
+ * other processes and reloads mapping the same file, and lookups are a
+ * binary search that needs no locking as the data never changes.
+ */
+
+#include "suricata-common.h"
+#include "datasets.h"
+#include "datasets-compiled.h"
+#include "util-debug.h"
+#include "util-mem.h"
+
+/** \internal
+ *  \brief get the key length for a dataset type, 0 for strings */
+static int DatasetCompiledKeyLen(uint32_t type, uint32_t *key_len)
+{
+    switch (type) {
+        case DATASET_TYPE_STRING:
+            *key_len = 0;
+            return 0;
+        case DATASET_TYPE_MD5:
+            *key_len = 16;
+            return 0;
+        case DATASET_TYPE_SHA256:
+            *key_len = 32;
+            return 0;
+        case DATASET_TYPE_IPV4:
+            *key_len = 4;
+            return 0;
+        case DATASET_TYPE_IPV6:
+            *key_len = 16;
+            return 0;
+    }
+    return -1;
+}
+
+/** \brief check if the file at \a path is a compiled dataset */
+bool DatasetCompiledIsCompiled(const char *path)
+{
+    char magic[DATASET_COMPILED_MAGIC_LEN];
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return false;
+    const size_t r = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+
+    return (r == sizeof(magic) && memcmp(magic, DATASET_COMPILED_MAGIC, sizeof(magic)) == 0);
+}
+
+static int DatasetCompiledMap(DatasetCompiled *c, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        SCLogError("dataset: failed to open '%s': %s", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        SCLogError("dataset: failed to stat '%s': %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (st.st_size < (off_t)sizeof(DatasetCompiledHeader)) {
+        SCLogError("dataset: compiled set '%s' is truncated", path);
+        close(fd);
+        return -1;
+    }
+    c->map_size = (size_t)st.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    void *map = mmap(NULL, c->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        SCLogError("dataset: failed to map '%s': %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+#ifdef MADV_RANDOM
+    /* lookups are a binary search, read ahead only wastes page cache */
+    (void)madvise(map, c->map_size, MADV_RANDOM);
+#endif
+    c->map = map;
+    c->mmapped = true;
+#else
+    c->map = SCMalloc(c->map_size);
+    if (c->map == NULL) {
+        close(fd);
+        return -1;
+    }
+    size_t done = 0;
+    while (done < c->map_size) {
+        ssize_t r = read(fd, c->map + done, c->map_size - done);
+        if (r <= 0) {
+            SCLogError("dataset: failed to read '%s'", path);
+            SCFree(c->map);
+            c->map = NULL;
+            close(fd);
+            return -1;
+        }
+        done += (size_t)r;
+    }
+#endif
+    close(fd);
+    return 0;
+}
+
+/**
+ *  \brief open a compiled dataset
+ *
+ *  Validates the header and the file size against the header, so that
+ *  lookups never have to look outside of the mapped file.
+ *
+ *  \param path compiled dataset file
+ *  \param type expected type (enum DatasetTypes)
+ *  \retval c compiled set or NULL on error
+ */
+DatasetCompiled *DatasetCompiledOpen(const char *path, uint32_t type)
+{
+    uint32_t key_len;
+    if (DatasetCompiledKeyLen(type, &key_len) < 0)
+        return NULL;
+
+    DatasetCompiled *c = SCCalloc(1, sizeof(*c));
+    if (c == NULL)
+        return NULL;
+    if (DatasetCompiledMap(c, path) < 0) {
+        SCFree(c);
+        return NULL;
+    }
+
+    DatasetCompiledHeader hdr;
+    memcpy(&hdr, c->map, sizeof(hdr));
+    if (memcmp(hdr.magic, DATASET_COMPILED_MAGIC, sizeof(hdr.magic)) != 0 ||
+            hdr.version != DATASET_COMPILED_VERSION) {
+        SCLogError("dataset: '%s' is not a supported compiled set", path);
+        goto error;
+    }
+    if (hdr.byte_order != DATASET_COMPILED_BYTE_ORDER) {
+        SCLogError("dataset: '%s' was compiled on a host with a different byte order", path);
+        goto error;
+    }
+    if (hdr.type != type || hdr.key_len != key_len) {
+        SCLogError("dataset: '%s' was compiled for type %u, expected %u", path, hdr.type, type);
+        goto error;
+    }
+
+    const uint64_t avail = c->map_size - sizeof(hdr);
+    c->type = type;
+    c->key_len = key_len;
+    c->count = hdr.count;
+    c->records = c->map + sizeof(hdr);
+    if (key_len != 0) {
+        c->rec_size = key_len + (uint32_t)sizeof(DataRepType);
+        if (hdr.blob_size != 0 || hdr.count > avail / c->rec_size ||
+                hdr.count * c->rec_size != avail) {
+            SCLogError("dataset: compiled set '%s' size mismatch", path);
+            goto error;
+        }
+    } else {
+        c->rec_size = (uint32_t)sizeof(uint64_t);
+        if (hdr.count > avail / c->rec_size || hdr.blob_size != avail - hdr.count * c->rec_size) {
+            SCLogError("dataset: compiled set '%s' size mismatch", path);
+            goto error;
+        }
+        c->blob = c->records + hdr.count * c->rec_size;
+        c->blob_size = hdr.blob_size;
+    }
+
+    SCLogDebug("compiled set %s: %" PRIu64 " records", path, c->count);
+    return c;
+error:
+    DatasetCompiledClose(c);
+    return NULL;
+}
+
+void DatasetCompiledClose(DatasetCompiled *c)
+{
+    if (c == NULL)
+        return;
+#ifdef HAVE_SYS_MMAN_H
+    if (c->mmapped) {
+        munmap(c->map, c->map_size);
+    }
+#else
+    if (c->map != NULL) {
+        SCFree(c->map);
+    }
+#endif
+    SCFree(c);
+}
+
+/** \internal
+ *  \brief compare \a data with the string at blob offset \a offset
+ *  \retval r <0, 0, >0 like memcmp, or 1 for a corrupt entry
+ */
+static int DatasetCompiledStringCompare(const DatasetCompiled *c, const uint64_t offset,
+        const uint8_t *data, const uint32_t data_len, DataRepType *rep)
+{
+    uint32_t len;
+    const uint64_t hdr_len = sizeof(len) + sizeof(DataRepType);
+    if (offset > c->blob_size || c->blob_size - offset < hdr_len)
+        return 1;
+    memcpy(&len, c->blob + offset, sizeof(len));
+    if (c->blob_size - offset - hdr_len < len)
+        return 1;
+
+    const uint8_t *str = c->blob + offset + hdr_len;
+    const int r = memcmp(data, str, MIN(data_len, len));
+    if (r != 0)
+        return r;
+    if (data_len != len)
+        return data_len < len ? -1 : 1;
+    if (rep != NULL)
+        memcpy(rep, c->blob + offset + sizeof(len), sizeof(*rep));
+    return 0;
+}
+
+/**
+ *  \brief look up \a data in a compiled set
+ *
+ *  \param rep if not NULL, set to the reputation value of the match
+ *  \retval -1 error
+ *  \retval 0 not found
+ *  \retval 1 found
+ */
+int DatasetCompiledLookup(
+        const DatasetCompiled *c, const uint8_t *data, const uint32_t data_len, DataRepType *rep)
+{
+    uint64_t lo = 0;
+    uint64_t hi = c->count;
+
+    if (c->key_len == 0) {
+        while (lo < hi) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            uint64_t offset;
+            memcpy(&offset, c->records + mid * c->rec_size, sizeof(offset));
+            const int r = DatasetCompiledStringCompare(c, offset, data, data_len, rep);
+            if (r == 0)
+                return 1;
+            if (r < 0)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        return 0;
+    }
+
+    uint8_t key[32];
+    const uint8_t *k = data;
+    if (data_len != c->key_len) {
+        /* ip sets store IPv4 addresses in the first 4 bytes of the key */
+        if (c->type != DATASET_TYPE_IPV6 || data_len != 4)
+            return -1;
+        memset(key, 0, c->key_len);
+        memcpy(key, data, data_len);
+        k = key;
+    }
+
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        const uint8_t *rec = c->records + mid * c->rec_size;
+        const int r = memcmp(k, rec, c->key_len);
+        if (r == 0) {
+            if (rep != NULL)
+                memcpy(rep, rec + c->key_len, sizeof(*rep));
+            return 1;
+        }
+        if (r < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Read-only compiled dataset files, as produced by
+ * `suricatactl dataset compile`.
+ */
+
+#ifndef SURICATA_DATASETS_COMPILED_H
+#define SURICATA_DATASETS_COMPILED_H
+
+#include "datasets-reputation.h"
+
+/** magic at the start of a compiled dataset file */
+#define DATASET_COMPILED_MAGIC     "SCDSCMP1"
+#define DATASET_COMPILED_MAGIC_LEN 8
+#define DATASET_COMPILED_VERSION   1
+/** written in host byte order by the compiler, used to detect files
+ *  compiled on a host with a different byte order */
+#define DATASET_COMPILED_BYTE_ORDER 0x01020304U
+
+/** \brief on disk header of a compiled dataset
+ *
+ *  For the fixed size types (md5, sha256, ipv4, ip) the header is followed
+ *  by \a count records of \a key_len key bytes and a 2 byte reputation value,
+ *  sorted by key.
+ *
+ *  For strings (\a key_len is 0) the header is followed by \a count 64 bit
+ *  offsets into the string blob, sorted by the string they point to, and the
+ *  \a blob_size bytes string blob. Each blob entry is a 32 bit length, a
+ *  2 byte reputation value and the string bytes.
+ */
+typedef struct DatasetCompiledHeader {
+    char magic[DATASET_COMPILED_MAGIC_LEN];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t type; /**< enum DatasetTypes */
+    uint32_t key_len;
+    uint64_t count;
+    uint64_t blob_size;
+} DatasetCompiledHeader;
+
+typedef struct DatasetCompiled {
+    uint8_t *map; /**< file content, mmapped where supported */
+    size_t map_size;
+    bool mmapped;
+
+    uint32_t type; /**< enum DatasetTypes */
+    uint32_t key_len;
+    uint32_t rec_size;
+    uint64_t count;
+    const uint8_t *records; /**< sorted records or string offsets */
+    const uint8_t *blob;    /**< string blob, NULL for fixed size types */
+    uint64_t blob_size;
+} DatasetCompiled;
+
+bool DatasetCompiledIsCompiled(const char *path);
+DatasetCompiled *DatasetCompiledOpen(const char *path, uint32_t type);
+void DatasetCompiledClose(DatasetCompiled *c);
+int DatasetCompiledLookup(
+        const DatasetCompiled *c, const uint8_t *data, const uint32_t data_len, DataRepType *rep);
+
+#endif /* SURICATA_DATASETS_COMPILED_H */
@@ -26,6 +26,7 @@
 #include "rust.h"
 #include "conf.h"
 #include "datasets.h"
+#include "datasets-compiled.h"
 #include "datasets-string.h"
 #include "datasets-ipv4.h"
 #include "datasets-ipv6.h"
@@ -33,9 +34,11 @@
 #include "datasets-sha256.h"
 #include "datasets-reputation.h"
 #include "datasets-context-json.h"
+#include "counters.h"
 #include "util-conf.h"
 #include "util-mem.h"
 #include "util-thash.h"
+#include "util-bloom.h"
 #include "util-print.h"
 #include "util-byte.h"
 #include "util-misc.h"
@@ -61,6 +64,42 @@ static inline void DatasetUnlockData(THashData *d)
 }
 static bool DatasetIsStatic(const char *save, const char *load);
 
+/* seeds for the 2 filter hashes, independent of the hash table's seed */
+#define DATASET_FILTER_SEED1 0x9e3779b9U
+#define DATASET_FILTER_SEED2 0x85ebca6bU
+
+/** \internal
+ *  \brief add data to the set's bloom filter, if it has one
+ *
+ *  Data is added before it is added to the hash, so the filter never
+ *  rejects data that is in the hash. Removed data stays in the filter,
+ *  which only costs a false positive.
+ */
+static inline void DatasetFilterAdd(Dataset *set, void *lookup)
+{
+    if (set->filter == NULL)
+        return;
+    BloomFilterAdd(set->filter, set->hash->config.DataHash(DATASET_FILTER_SEED1, lookup),
+            set->hash->config.DataHash(DATASET_FILTER_SEED2, lookup));
+}
+
+/** \internal
+ *  \retval false data is not in the set
+ *  \retval true data may be in the set, or the set has no filter
+ */
+static inline bool DatasetFilterCheck(Dataset *set, void *lookup)
+{
+    if (set->filter == NULL)
+        return true;
+    const bool r = BloomFilterTest(set->filter,
+            set->hash->config.DataHash(DATASET_FILTER_SEED1, lookup),
+            set->hash->config.DataHash(DATASET_FILTER_SEED2, lookup));
+    (void)SC_ATOMIC_ADD(set->filter_checks, 1);
+    if (!r)
+        (void)SC_ATOMIC_ADD(set->filter_rejects, 1);
+    return r;
+}
+
 enum DatasetTypes DatasetGetTypeFromString(const char *s)
 {
     if (strcasecmp("md5", s) == 0)
@@ -78,6 +117,12 @@ enum DatasetTypes DatasetGetTypeFromString(const char *s)
 
 int DatasetAppendSet(Dataset *set)
 {
+    if (set->compiled != NULL) {
+        /* compiled sets are not hash based, so nothing to account for */
+        set->next = sets;
+        sets = set;
+        return 0;
+    }
 
     if (set->hash == NULL) {
         return -1;
@@ -118,6 +163,16 @@ Dataset *DatasetAlloc(const char *name)
     return set;
 }
 
+static void DatasetFree(Dataset *set)
+{
+    if (set->hash) {
+        THashShutdown(set->hash);
+    }
+    BloomFilterFree(set->filter);
+    DatasetCompiledClose(set->compiled);
+    SCFree(set);
+}
+
 Dataset *DatasetSearchByName(const char *name)
 {
     Dataset *set = sets;
@@ -448,8 +503,14 @@ out_err:
     return -1;
 }
 
-Dataset *DatasetGet(const char *name, enum DatasetTypes type, const char *save, const char *load,
-        uint64_t memcap, uint32_t hashsize)
+/**
+ *  \param filter_entries if not 0, size of the bloom filter to put in
+ *         front of the set's hash
+ *  \param filter_fp_rate false positive rate of the bloom filter
+ */
+static Dataset *DatasetGetWithFilter(const char *name, enum DatasetTypes type, const char *save,
+        const char *load, uint64_t memcap, uint32_t hashsize, uint32_t filter_entries,
+        double filter_fp_rate)
 {
     Dataset *set = NULL;
 
@@ -466,6 +527,35 @@ Dataset *DatasetGet(const char *name, enum DatasetTypes type, const char *save,
         return set;
     }
 
+    if (strlen(set->load) > 0 && DatasetCompiledIsCompiled(set->load)) {
+        if (strlen(set->save) > 0) {
+            SCLogError("dataset %s: compiled set '%s' is read-only and can't be used as state",
+                    name, set->load);
+            goto out_err;
+        }
+        SCLogConfig("dataset: %s mapping compiled set '%s'", set->name, set->load);
+        if (filter_entries > 0) {
+            SCLogWarning("dataset %s: bloom-filter settings are ignored for compiled set '%s'",
+                    name, set->load);
+        }
+        set->compiled = DatasetCompiledOpen(set->load, type);
+        if (set->compiled == NULL)
+            goto out_err;
+        goto append;
+    }
+
+    if (filter_entries > 0) {
+        set->filter = BloomFilterInit(filter_entries, filter_fp_rate);
+        if (set->filter == NULL) {
+            SCLogError("dataset %s: failed to set up bloom filter for %u entries", name,
+                    filter_entries);
+            goto out_err;
+        }
+        SCLogConfig("dataset: %s using bloom filter of %" PRIuMAX " bytes", set->name,
+                (uintmax_t)set->filter->nblocks * BLOOM_FILTER_BLOCK_WORDS *
+                        sizeof(BloomFilterWord));
+    }
+
     char cnf_name[128];
     snprintf(cnf_name, sizeof(cnf_name), "datasets.%s.hash", name);
     switch (type) {
@@ -474,6 +564,8 @@ Dataset *DatasetGet(const char *name, enum DatasetTypes type, const char *save,
                     Md5StrCompare, NULL, NULL, load != NULL ? 1 : 0, memcap, hashsize);
             if (set->hash == NULL)
                 goto out_err;
+            /* fixed size data without pointers, so lookups can skip locking */
+            set->hash->config.optimistic_reads = true;
             if (DatasetLoadMd5(set) < 0)
                 goto out_err;
             break;
@@ -491,6 +583,7 @@ Dataset *DatasetGet(const char *name, enum DatasetTypes type, const char *save,
                     hashsize);
             if (set->hash == NULL)
                 goto out_err;
+            set->hash->config.optimistic_reads = true;
             if (DatasetLoadSha256(set) < 0)
                 goto out_err;
             break;
@@ -499,6 +592,7 @@ Dataset *DatasetGet(const char *name, enum DatasetTypes type, const char *save,
                     IPv4Compare, NULL, NULL, load != NULL ? 1 : 0, memcap, hashsize);
             if (set->hash == NULL)
                 goto out_err;
+            set->hash->config.optimistic_reads = true;
             if (DatasetLoadIPv4(set) < 0)
                 goto out_err;
             break;
@@ -507,11 +601,13 @@ Dataset *DatasetGet(const char *name, enum DatasetTypes type, const char *save,
                     IPv6Compare, NULL, NULL, load != NULL ? 1 : 0, memcap, hashsize);
             if (set->hash == NULL)
                 goto out_err;
+            set->hash->config.optimistic_reads = true;
             if (DatasetLoadIPv6(set) < 0)
                 goto out_err;
             break;
     }
 
+append:
     if (DatasetAppendSet(set) < 0) {
         SCLogError("dataset %s append failed", name);
         goto out_err;
@@ -520,14 +616,17 @@ Dataset *DatasetGet(const char *name, enum DatasetTypes type, const char *save,
     DatasetUnlock();
     return set;
 out_err:
-    if (set->hash) {
-        THashShutdown(set->hash);
-    }
-    SCFree(set);
+    DatasetFree(set);
     DatasetUnlock();
     return NULL;
 }
 
+Dataset *DatasetGet(const char *name, enum DatasetTypes type, const char *save, const char *load,
+        uint64_t memcap, uint32_t hashsize)
+{
+    return DatasetGetWithFilter(name, type, save, load, memcap, hashsize, 0, 0.0);
+}
+
 static bool DatasetIsStatic(const char *save, const char *load)
 {
     /* A set is static if it does not have any dynamic properties like
@@ -556,7 +655,7 @@ void DatasetReload(void)
             continue;
         }
         set->hidden = true;
-        if (dataset_max_total_hashsize > 0) {
+        if (dataset_max_total_hashsize > 0 && set->hash != NULL) {
             DEBUG_VALIDATE_BUG_ON(set->hash->config.hash_size > dataset_used_hashsize);
             dataset_used_hashsize -= set->hash->config.hash_size;
         }
@@ -585,8 +684,7 @@ void DatasetPostReloadCleanup(void)
         } else {
             sets = next;
         }
-        THashShutdown(cur->hash);
-        SCFree(cur);
+        DatasetFree(cur);
         cur = next;
     }
     DatasetUnlock();
@@ -619,9 +717,73 @@ void DatasetGetDefaultMemcap(uint64_t *memcap, uint32_t *hashsize)
     }
 }
 
+#define DATASETS_FILTER_FP_RATE_DEFAULT 0.01
+
+/** \internal
+ *  \brief parse the optional bloom-filter settings of a set */
+static void DatasetParseFilterConfig(
+        const SCConfNode *set_node, const char *set_name, uint32_t *entries, double *fp_rate)
+{
+    *entries = 0;
+    *fp_rate = DATASETS_FILTER_FP_RATE_DEFAULT;
+
+    const SCConfNode *node = SCConfNodeLookupChild(set_node, "bloom-filter");
+    if (node == NULL)
+        return;
+
+    const char *str = SCConfNodeLookupChildValue(node, "entries");
+    if (str == NULL || ParseSizeStringU32(str, entries) < 0) {
+        SCLogWarning("dataset %s: bloom-filter.entries missing or invalid, "
+                     "not using a bloom filter",
+                set_name);
+        *entries = 0;
+        return;
+    }
+
+    str = SCConfNodeLookupChildValue(node, "fp-rate");
+    if (str != NULL) {
+        char *endptr;
+        errno = 0;
+        double val = strtod(str, &endptr);
+        if (str[0] == '\0' || *endptr != '\0' || errno == ERANGE || !(val > 0.0 && val < 1.0)) {
+            SCLogWarning("dataset %s: bloom-filter.fp-rate value cannot be deduced: %s,"
+                         " resetting to default: %f",
+                    set_name, str, DATASETS_FILTER_FP_RATE_DEFAULT);
+        } else {
+            *fp_rate = val;
+        }
+    }
+}
+
+/** \internal
+ *  \brief sum a bloom filter counter over all sets, including the ones
+ *         hidden by a reload until they are cleaned up */
+static uint64_t DatasetsFilterCounterSum(bool rejects)
+{
+    uint64_t sum = 0;
+    DatasetLock();
+    for (Dataset *set = sets; set != NULL; set = set->next) {
+        sum += rejects ? SC_ATOMIC_GET(set->filter_rejects) : SC_ATOMIC_GET(set->filter_checks);
+    }
+    DatasetUnlock();
+    return sum;
+}
+
+static uint64_t DatasetsFilterChecksCounter(void)
+{
+    return DatasetsFilterCounterSum(false);
+}
+
+static uint64_t DatasetsFilterRejectsCounter(void)
+{
+    return DatasetsFilterCounterSum(true);
+}
+
 int DatasetsInit(void)
 {
     SCLogDebug("datasets start");
+    StatsRegisterGlobalCounter("datasets.bloom_filter_checks", DatasetsFilterChecksCounter);
+    StatsRegisterGlobalCounter("datasets.bloom_filter_rejects", DatasetsFilterRejectsCounter);
     SCConfNode *datasets = SCConfGetNode("datasets");
     uint64_t default_memcap = 0;
     uint32_t default_hashsize = 0;
@@ -703,15 +865,20 @@ int DatasetsInit(void)
                     hashsize = 0;
                 }
             }
+            uint32_t filter_entries = 0;
+            double filter_fp_rate = 0.0;
+            DatasetParseFilterConfig(iter, set_name, &filter_entries, &filter_fp_rate);
+
             char conf_str[1024];
             snprintf(conf_str, sizeof(conf_str), "datasets.%d.%s", list_pos, set_name);
 
             SCLogDebug("set %s type %s. Conf %s", set_name, set_type->val, conf_str);
 
             if (strcmp(set_type->val, "md5") == 0) {
-                Dataset *dset = DatasetGet(set_name, DATASET_TYPE_MD5, save, load,
+                Dataset *dset = DatasetGetWithFilter(set_name, DATASET_TYPE_MD5, save, load,
                         memcap > 0 ? memcap : default_memcap,
-                        hashsize > 0 ? hashsize : default_hashsize);
+                        hashsize > 0 ? hashsize : default_hashsize, filter_entries,
+                        filter_fp_rate);
                 if (dset == NULL) {
                     FatalErrorOnInit("failed to setup dataset for %s", set_name);
                     continue;
@@ -720,9 +887,10 @@ int DatasetsInit(void)
                 dset->from_yaml = true;
 
             } else if (strcmp(set_type->val, "sha256") == 0) {
-                Dataset *dset = DatasetGet(set_name, DATASET_TYPE_SHA256, save, load,
+                Dataset *dset = DatasetGetWithFilter(set_name, DATASET_TYPE_SHA256, save, load,
                         memcap > 0 ? memcap : default_memcap,
-                        hashsize > 0 ? hashsize : default_hashsize);
+                        hashsize > 0 ? hashsize : default_hashsize, filter_entries,
+                        filter_fp_rate);
                 if (dset == NULL) {
                     FatalErrorOnInit("failed to setup dataset for %s", set_name);
                     continue;
@@ -731,9 +899,10 @@ int DatasetsInit(void)
                 dset->from_yaml = true;
 
             } else if (strcmp(set_type->val, "string") == 0) {
-                Dataset *dset = DatasetGet(set_name, DATASET_TYPE_STRING, save, load,
+                Dataset *dset = DatasetGetWithFilter(set_name, DATASET_TYPE_STRING, save, load,
                         memcap > 0 ? memcap : default_memcap,
-                        hashsize > 0 ? hashsize : default_hashsize);
+                        hashsize > 0 ? hashsize : default_hashsize, filter_entries,
+                        filter_fp_rate);
                 if (dset == NULL) {
                     FatalErrorOnInit("failed to setup dataset for %s", set_name);
                     continue;
@@ -742,9 +911,10 @@ int DatasetsInit(void)
                 dset->from_yaml = true;
 
             } else if (strcmp(set_type->val, "ipv4") == 0) {
-                Dataset *dset = DatasetGet(set_name, DATASET_TYPE_IPV4, save, load,
+                Dataset *dset = DatasetGetWithFilter(set_name, DATASET_TYPE_IPV4, save, load,
                         memcap > 0 ? memcap : default_memcap,
-                        hashsize > 0 ? hashsize : default_hashsize);
+                        hashsize > 0 ? hashsize : default_hashsize, filter_entries,
+                        filter_fp_rate);
                 if (dset == NULL) {
                     FatalErrorOnInit("failed to setup dataset for %s", set_name);
                     continue;
@@ -753,9 +923,10 @@ int DatasetsInit(void)
                 dset->from_yaml = true;
 
             } else if (strcmp(set_type->val, "ip") == 0) {
-                Dataset *dset = DatasetGet(set_name, DATASET_TYPE_IPV6, save, load,
+                Dataset *dset = DatasetGetWithFilter(set_name, DATASET_TYPE_IPV6, save, load,
                         memcap > 0 ? memcap : default_memcap,
-                        hashsize > 0 ? hashsize : default_hashsize);
+                        hashsize > 0 ? hashsize : default_hashsize, filter_entries,
+                        filter_fp_rate);
                 if (dset == NULL) {
                     FatalErrorOnInit("failed to setup dataset for %s", set_name);
                     continue;
@@ -779,8 +950,12 @@ void DatasetsDestroy(void)
     while (set) {
         SCLogDebug("destroying set %s", set->name);
         Dataset *next = set->next;
-        THashShutdown(set->hash);
-        SCFree(set);
+        if (set->filter != NULL) {
+            SCLogPerf("dataset %s: bloom filter checked %" PRIu64 " lookups, rejected %" PRIu64,
+                    set->name, SC_ATOMIC_GET(set->filter_checks),
+                    SC_ATOMIC_GET(set->filter_rejects));
+        }
+        DatasetFree(set);
         set = next;
     }
     sets = NULL;
@@ -896,12 +1071,10 @@ static int DatasetLookupString(Dataset *set, const uint8_t *data, const uint32_t
         return -1;
 
     StringType lookup = { .ptr = (uint8_t *)data, .len = data_len, .rep = 0 };
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        DatasetUnlockData(rdata);
-        return 1;
-    }
-    return 0;
+    StringType found;
+    if (!DatasetFilterCheck(set, &lookup))
+        return 0;
+    return THashLookupCopyFromHash(set->hash, &lookup, &found);
 }
 
 static DataRepResultType DatasetLookupStringwRep(Dataset *set,
@@ -913,13 +1086,11 @@ static DataRepResultType DatasetLookupStringwRep(Dataset *set,
         return rrep;
 
     StringType lookup = { .ptr = (uint8_t *)data, .len = data_len, .rep = *rep };
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        StringType *found = rdata->data;
+    StringType found;
+    if (DatasetFilterCheck(set, &lookup) &&
+            THashLookupCopyFromHash(set->hash, &lookup, &found) == 1) {
         rrep.found = true;
-        rrep.rep = found->rep;
-        DatasetUnlockData(rdata);
-        return rrep;
+        rrep.rep = found.rep;
     }
     return rrep;
 }
@@ -934,12 +1105,10 @@ static int DatasetLookupIPv4(Dataset *set, const uint8_t *data, const uint32_t d
 
     IPv4Type lookup = { .rep = 0 };
     memcpy(lookup.ipv4, data, 4);
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        DatasetUnlockData(rdata);
-        return 1;
-    }
-    return 0;
+    IPv4Type found;
+    if (!DatasetFilterCheck(set, &lookup))
+        return 0;
+    return THashLookupCopyFromHash(set->hash, &lookup, &found);
 }
 
 static DataRepResultType DatasetLookupIPv4wRep(
@@ -955,13 +1124,11 @@ static DataRepResultType DatasetLookupIPv4wRep(
 
     IPv4Type lookup = { .rep = 0 };
     memcpy(lookup.ipv4, data, data_len);
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        IPv4Type *found = rdata->data;
+    IPv4Type found;
+    if (DatasetFilterCheck(set, &lookup) &&
+            THashLookupCopyFromHash(set->hash, &lookup, &found) == 1) {
         rrep.found = true;
-        rrep.rep = found->rep;
-        DatasetUnlockData(rdata);
-        return rrep;
+        rrep.rep = found.rep;
     }
     return rrep;
 }
@@ -976,12 +1143,10 @@ static int DatasetLookupIPv6(Dataset *set, const uint8_t *data, const uint32_t d
 
     IPv6Type lookup = { .rep = 0 };
     memcpy(lookup.ipv6, data, data_len);
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        DatasetUnlockData(rdata);
-        return 1;
-    }
-    return 0;
+    IPv6Type found;
+    if (!DatasetFilterCheck(set, &lookup))
+        return 0;
+    return THashLookupCopyFromHash(set->hash, &lookup, &found);
 }
 
 static DataRepResultType DatasetLookupIPv6wRep(
@@ -997,13 +1162,11 @@ static DataRepResultType DatasetLookupIPv6wRep(
 
     IPv6Type lookup = { .rep = 0 };
     memcpy(lookup.ipv6, data, data_len);
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        IPv6Type *found = rdata->data;
+    IPv6Type found;
+    if (DatasetFilterCheck(set, &lookup) &&
+            THashLookupCopyFromHash(set->hash, &lookup, &found) == 1) {
         rrep.found = true;
-        rrep.rep = found->rep;
-        DatasetUnlockData(rdata);
-        return rrep;
+        rrep.rep = found.rep;
     }
     return rrep;
 }
@@ -1018,12 +1181,10 @@ static int DatasetLookupMd5(Dataset *set, const uint8_t *data, const uint32_t da
 
     Md5Type lookup = { .rep = 0 };
     memcpy(lookup.md5, data, data_len);
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        DatasetUnlockData(rdata);
-        return 1;
-    }
-    return 0;
+    Md5Type found;
+    if (!DatasetFilterCheck(set, &lookup))
+        return 0;
+    return THashLookupCopyFromHash(set->hash, &lookup, &found);
 }
 
 static DataRepResultType DatasetLookupMd5wRep(Dataset *set,
@@ -1039,13 +1200,11 @@ static DataRepResultType DatasetLookupMd5wRep(Dataset *set,
 
     Md5Type lookup = { .rep = 0 };
     memcpy(lookup.md5, data, data_len);
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        Md5Type *found = rdata->data;
+    Md5Type found;
+    if (DatasetFilterCheck(set, &lookup) &&
+            THashLookupCopyFromHash(set->hash, &lookup, &found) == 1) {
         rrep.found = true;
-        rrep.rep = found->rep;
-        DatasetUnlockData(rdata);
-        return rrep;
+        rrep.rep = found.rep;
     }
     return rrep;
 }
@@ -1060,12 +1219,10 @@ static int DatasetLookupSha256(Dataset *set, const uint8_t *data, const uint32_t
 
     Sha256Type lookup = { .rep = 0 };
     memcpy(lookup.sha256, data, data_len);
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        DatasetUnlockData(rdata);
-        return 1;
-    }
-    return 0;
+    Sha256Type found;
+    if (!DatasetFilterCheck(set, &lookup))
+        return 0;
+    return THashLookupCopyFromHash(set->hash, &lookup, &found);
 }
 
 static DataRepResultType DatasetLookupSha256wRep(Dataset *set,
@@ -1081,13 +1238,11 @@ static DataRepResultType DatasetLookupSha256wRep(Dataset *set,
 
     Sha256Type lookup = { .rep = 0 };
     memcpy(lookup.sha256, data, data_len);
-    THashData *rdata = THashLookupFromHash(set->hash, &lookup);
-    if (rdata) {
-        Sha256Type *found = rdata->data;
+    Sha256Type found;
+    if (DatasetFilterCheck(set, &lookup) &&
+            THashLookupCopyFromHash(set->hash, &lookup, &found) == 1) {
         rrep.found = true;
-        rrep.rep = found->rep;
-        DatasetUnlockData(rdata);
-        return rrep;
+        rrep.rep = found.rep;
     }
     return rrep;
 }
@@ -1105,6 +1260,8 @@ int DatasetLookup(Dataset *set, const uint8_t *data, const uint32_t data_len)
 {
     if (set == NULL)
         return -1;
+    if (set->compiled != NULL)
+        return DatasetCompiledLookup(set->compiled, data, data_len, NULL);
 
     switch (set->type) {
         case DATASET_TYPE_STRING:
@@ -1127,6 +1284,10 @@ DataRepResultType DatasetLookupwRep(Dataset *set, const uint8_t *data, const uin
     DataRepResultType rrep = { .found = false, .rep = 0 };
     if (set == NULL)
         return rrep;
+    if (set->compiled != NULL) {
+        rrep.found = DatasetCompiledLookup(set->compiled, data, data_len, &rrep.rep) == 1;
+        return rrep;
+    }
 
     switch (set->type) {
         case DATASET_TYPE_STRING:
@@ -1154,6 +1315,7 @@ static int DatasetAddString(Dataset *set, const uint8_t *data, const uint32_t da
         return -1;
 
     StringType lookup = { .ptr = (uint8_t *)data, .len = data_len, .rep = 0 };
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1175,6 +1337,7 @@ static int DatasetAddStringwRep(
 
     StringType lookup = { .ptr = (uint8_t *)data, .len = data_len,
         .rep = *rep };
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1195,6 +1358,7 @@ static int DatasetAddIPv4(Dataset *set, const uint8_t *data, const uint32_t data
 
     IPv4Type lookup = { .rep = 0 };
     memcpy(lookup.ipv4, data, 4);
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1215,6 +1379,7 @@ static int DatasetAddIPv6(Dataset *set, const uint8_t *data, const uint32_t data
 
     IPv6Type lookup = { .rep = 0 };
     memcpy(lookup.ipv6, data, data_len);
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1234,6 +1399,7 @@ static int DatasetAddIPv4wRep(
 
     IPv4Type lookup = { .rep = *rep };
     memcpy(lookup.ipv4, data, 4);
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1253,6 +1419,7 @@ static int DatasetAddIPv6wRep(
 
     IPv6Type lookup = { .rep = *rep };
     memcpy(lookup.ipv6, data, 16);
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1271,6 +1438,7 @@ static int DatasetAddMd5(Dataset *set, const uint8_t *data, const uint32_t data_
 
     Md5Type lookup = { .rep = 0 };
     memcpy(lookup.md5, data, 16);
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1290,6 +1458,7 @@ static int DatasetAddMd5wRep(
 
     Md5Type lookup = { .rep = *rep };
     memcpy(lookup.md5, data, 16);
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1309,6 +1478,7 @@ static int DatasetAddSha256wRep(
 
     Sha256Type lookup = { .rep = *rep };
     memcpy(lookup.sha256, data, 32);
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1327,6 +1497,7 @@ static int DatasetAddSha256(Dataset *set, const uint8_t *data, const uint32_t da
 
     Sha256Type lookup = { .rep = 0 };
     memcpy(lookup.sha256, data, 32);
+    DatasetFilterAdd(set, &lookup);
     struct THashDataGetResult res = THashGetFromHash(set->hash, &lookup);
     if (res.data) {
         DatasetUnlockData(res.data);
@@ -1337,7 +1508,7 @@ static int DatasetAddSha256(Dataset *set, const uint8_t *data, const uint32_t da
 
 int SCDatasetAdd(Dataset *set, const uint8_t *data, const uint32_t data_len)
 {
-    if (set == NULL)
+    if (set == NULL || set->compiled != NULL)
         return -1;
 
     switch (set->type) {
@@ -1358,7 +1529,7 @@ int SCDatasetAdd(Dataset *set, const uint8_t *data, const uint32_t data_len)
 int SCDatasetAddwRep(
         Dataset *set, const uint8_t *data, const uint32_t data_len, const DataRepType *rep)
 {
-    if (set == NULL)
+    if (set == NULL || set->compiled != NULL)
         return -1;
 
     switch (set->type) {
@@ -1445,6 +1616,8 @@ static int DatasetOpSerialized(Dataset *set, const char *string, DatasetOpFunc D
  */
 int DatasetAddSerialized(Dataset *set, const char *string)
 {
+    if (set != NULL && set->compiled != NULL)
+        return -1;
     return DatasetOpSerialized(set, string, DatasetAddString, DatasetAddMd5, DatasetAddSha256,
             DatasetAddIPv4, DatasetAddIPv6);
 }
@@ -1457,6 +1630,9 @@ int DatasetAddSerialized(Dataset *set, const char *string)
  */
 int DatasetLookupSerialized(Dataset *set, const char *string)
 {
+    if (set != NULL && set->compiled != NULL)
+        return DatasetOpSerialized(set, string, DatasetLookup, DatasetLookup, DatasetLookup,
+                DatasetLookup, DatasetLookup);
     return DatasetOpSerialized(set, string, DatasetLookupString, DatasetLookupMd5,
             DatasetLookupSha256, DatasetLookupIPv4, DatasetLookupIPv6);
 }
@@ -1534,13 +1710,15 @@ static int DatasetRemoveSha256(Dataset *set, const uint8_t *data, const uint32_t
  *  \retval int -2 DATA error */
 int DatasetRemoveSerialized(Dataset *set, const char *string)
 {
+    if (set != NULL && set->compiled != NULL)
+        return -1;
     return DatasetOpSerialized(set, string, DatasetRemoveString, DatasetRemoveMd5,
             DatasetRemoveSha256, DatasetRemoveIPv4, DatasetRemoveIPv6);
 }
 
 int DatasetRemove(Dataset *set, const uint8_t *data, const uint32_t data_len)
 {
-    if (set == NULL)
+    if (set == NULL || set->compiled != NULL)
         return -1;
 
     switch (set->type) {
@@ -1557,3 +1735,384 @@ int DatasetRemove(Dataset *set, const uint8_t *data, const uint32_t data_len)
     }
     return -1;
 }
+
+/** bulk update of a set, see DatasetBulkStart */
+struct DatasetBulk {
+    Dataset *set;
+    enum DatasetBulkMode mode;
+    /** replace mode: set holding the new content, used to find the data
+     *  that has to be removed from \a set at the end */
+    Dataset staging;
+    DatasetBulkStats stats;
+};
+
+/**
+ *  \brief start a bulk update of a set
+ *
+ *  Data is applied to the live set as it comes in. To replace the content
+ *  of a set, the new data is added and the stale data is only removed in
+ *  DatasetBulkFinish, so lookups of data that is in both the old and the new
+ *  content never fail during the update. This needs the memcap of the set to
+ *  fit both.
+ *
+ *  \retval bulk bulk update or NULL on error
+ */
+DatasetBulk *DatasetBulkStart(Dataset *set, enum DatasetBulkMode mode)
+{
+    if (set == NULL || set->compiled != NULL || set->hash == NULL)
+        return NULL;
+
+    DatasetBulk *bulk = SCCalloc(1, sizeof(*bulk));
+    if (bulk == NULL)
+        return NULL;
+    bulk->set = set;
+    bulk->mode = mode;
+
+    if (mode == DATASET_BULK_REPLACE) {
+        THashConfig *cnf = &set->hash->config;
+        char cnf_name[128];
+        snprintf(cnf_name, sizeof(cnf_name), "datasets.%s.staging", set->name);
+        strlcpy(bulk->staging.name, set->name, sizeof(bulk->staging.name));
+        bulk->staging.type = set->type;
+        bulk->staging.hash = THashInit(cnf_name, cnf->data_size, cnf->DataSet, cnf->DataFree,
+                cnf->DataHash, cnf->DataCompare, NULL, cnf->DataSize, false,
+                SC_ATOMIC_GET(cnf->memcap), cnf->hash_size);
+        if (bulk->staging.hash == NULL) {
+            SCFree(bulk);
+            return NULL;
+        }
+    }
+    return bulk;
+}
+
+/**
+ *  \brief apply serialized data to a bulk update
+ *
+ *  \retval 0 data applied, or counted as invalid
+ *  \retval -1 error, the update should be aborted
+ */
+int DatasetBulkApply(DatasetBulk *bulk, const char *string)
+{
+    if (strlen(string) == 0)
+        return 0;
+
+    int r;
+    if (bulk->mode == DATASET_BULK_REMOVE) {
+        r = DatasetRemoveSerialized(bulk->set, string);
+        if (r == 1) {
+            bulk->stats.removed++;
+        } else if (r == -2) {
+            bulk->stats.invalid++;
+        } else {
+            /* not in the set, or busy */
+            bulk->stats.unchanged++;
+        }
+        return 0;
+    }
+
+    if (bulk->mode == DATASET_BULK_REPLACE) {
+        r = DatasetAddSerialized(&bulk->staging, string);
+        if (r == -2) {
+            bulk->stats.invalid++;
+            return 0;
+        } else if (r < 0) {
+            return -1;
+        }
+    }
+
+    r = DatasetAddSerialized(bulk->set, string);
+    if (r == 1) {
+        bulk->stats.added++;
+    } else if (r == 0) {
+        bulk->stats.unchanged++;
+    } else if (r == -2) {
+        bulk->stats.invalid++;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/** \internal
+ *  \brief THashRemoveIf callback: data is stale if it's not in the staging set
+ */
+static bool DatasetBulkIsStale(void *data, void *arg)
+{
+    Dataset *staging = arg;
+    union {
+        StringType string;
+        Md5Type md5;
+        Sha256Type sha256;
+        IPv4Type ipv4;
+        IPv6Type ipv6;
+    } copy;
+    return THashLookupCopyFromHash(staging->hash, data, &copy) != 1;
+}
+
+/* base64 encoded strings are limited to UINT16_MAX, see DatasetAddSerialized */
+#define DATASET_BULK_LINE_MAX (UINT16_MAX + 3)
+
+/** \internal
+ *  \brief strip the line ending from a line of data
+ */
+static void DatasetBulkChomp(char *line)
+{
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        line[--len] = '\0';
+}
+
+/**
+ *  \brief apply a file with one serialized item per line to a bulk update
+ *  \retval line 0 on success, or the line number the update failed on
+ */
+uint32_t DatasetBulkApplyFile(DatasetBulk *bulk, const char *filename)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        SCLogError("dataset-bulk: failed to open '%s': %s", filename, strerror(errno));
+        return 1;
+    }
+    char *line = SCMalloc(DATASET_BULK_LINE_MAX);
+    if (line == NULL) {
+        fclose(fp);
+        return 1;
+    }
+
+    uint32_t lineno = 0;
+    uint32_t failed = 0;
+    while (fgets(line, DATASET_BULK_LINE_MAX, fp) != NULL) {
+        lineno++;
+        const size_t len = strlen(line);
+        if (len == DATASET_BULK_LINE_MAX - 1 && line[len - 1] != '\n' && !feof(fp)) {
+            SCLogError("dataset-bulk: '%s' line %u is too long", filename, lineno);
+            failed = lineno;
+            break;
+        }
+        DatasetBulkChomp(line);
+        if (DatasetBulkApply(bulk, line) < 0) {
+            failed = lineno;
+            break;
+        }
+    }
+    SCFree(line);
+    fclose(fp);
+    return failed;
+}
+
+/**
+ *  \brief apply newline separated serialized items to a bulk update
+ *  \retval line 0 on success, or the line number the update failed on
+ */
+uint32_t DatasetBulkApplyValues(DatasetBulk *bulk, const char *values)
+{
+    char *copy = SCStrdup(values);
+    if (copy == NULL)
+        return 1;
+
+    uint32_t lineno = 0;
+    uint32_t failed = 0;
+    char *saveptr = NULL;
+    for (char *line = strtok_r(copy, "\n", &saveptr); line != NULL;
+            line = strtok_r(NULL, "\n", &saveptr)) {
+        lineno++;
+        DatasetBulkChomp(line);
+        if (DatasetBulkApply(bulk, line) < 0) {
+            failed = lineno;
+            break;
+        }
+    }
+    SCFree(copy);
+    return failed;
+}
+
+/**
+ *  \brief finish a bulk update and free it
+ *
+ *  \param commit in replace mode, remove the data that was not part of the
+ *                update. If the update failed, the set is left with both
+ *                the old content and the data applied so far.
+ *  \param stats optional, set to the counters of the update
+ */
+void DatasetBulkFinish(DatasetBulk *bulk, bool commit, DatasetBulkStats *stats)
+{
+    if (bulk->staging.hash != NULL) {
+        if (commit) {
+            bulk->stats.removed =
+                    THashRemoveIf(bulk->set->hash, DatasetBulkIsStale, &bulk->staging);
+        }
+        THashShutdown(bulk->staging.hash);
+    }
+    SCLogDebug("dataset %s: bulk update: %u added, %u removed, %u unchanged, %u invalid",
+            bulk->set->name, bulk->stats.added, bulk->stats.removed, bulk->stats.unchanged,
+            bulk->stats.invalid);
+    if (stats != NULL)
+        *stats = bulk->stats;
+    SCFree(bulk);
+}
+
+#ifdef UNITTESTS
+#include "util-unittest.h"
+
+static Dataset *DatasetBulkTestSet(const char *name, const char *items)
+{
+    Dataset *set = DatasetGet(name, DATASET_TYPE_IPV4, NULL, NULL, 16 * 1024 * 1024, 1024);
+    if (set == NULL)
+        return NULL;
+    char *copy = SCStrdup(items);
+    if (copy == NULL)
+        return NULL;
+    char *saveptr = NULL;
+    for (char *item = strtok_r(copy, "\n", &saveptr); item != NULL;
+            item = strtok_r(NULL, "\n", &saveptr)) {
+        if (DatasetAddSerialized(set, item) != 1) {
+            SCFree(copy);
+            return NULL;
+        }
+    }
+    SCFree(copy);
+    return set;
+}
+
+static int DatasetBulkTestWriteFile(char *path, const char *data)
+{
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+    FILE *fp = fdopen(fd, "w");
+    if (fp == NULL) {
+        close(fd);
+        return -1;
+    }
+    int r = fputs(data, fp) < 0 ? -1 : 0;
+    fclose(fp);
+    return r;
+}
+
+/** \test apply single items: add, duplicates, invalid and empty data */
+static int DatasetBulkTest01(void)
+{
+    Dataset *set = DatasetBulkTestSet("bulk-test-01", "10.0.0.1");
+    FAIL_IF_NULL(set);
+
+    DatasetBulk *bulk = DatasetBulkStart(set, DATASET_BULK_ADD);
+    FAIL_IF_NULL(bulk);
+    FAIL_IF(DatasetBulkApply(bulk, "10.0.0.2") != 0);
+    FAIL_IF(DatasetBulkApply(bulk, "10.0.0.1") != 0);
+    FAIL_IF(DatasetBulkApply(bulk, "not-an-ip") != 0);
+    FAIL_IF(DatasetBulkApply(bulk, "") != 0);
+    DatasetBulkStats stats;
+    DatasetBulkFinish(bulk, true, &stats);
+    FAIL_IF_NOT(stats.added == 1);
+    FAIL_IF_NOT(stats.unchanged == 1);
+    FAIL_IF_NOT(stats.invalid == 1);
+    FAIL_IF_NOT(stats.removed == 0);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.1") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.2") == 1);
+
+    DatasetsDestroy();
+    PASS;
+}
+
+/** \test add and remove values, with different line endings */
+static int DatasetBulkTest02(void)
+{
+    Dataset *set = DatasetBulkTestSet("bulk-test-02", "10.0.0.1\n10.0.0.2");
+    FAIL_IF_NULL(set);
+
+    DatasetBulk *bulk = DatasetBulkStart(set, DATASET_BULK_ADD);
+    FAIL_IF_NULL(bulk);
+    FAIL_IF(DatasetBulkApplyValues(bulk, "10.0.0.3\r\n10.0.0.4\n\n10.0.0.1\n") != 0);
+    DatasetBulkStats stats;
+    DatasetBulkFinish(bulk, true, &stats);
+    FAIL_IF_NOT(stats.added == 2);
+    FAIL_IF_NOT(stats.unchanged == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.3") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.4") == 1);
+
+    bulk = DatasetBulkStart(set, DATASET_BULK_REMOVE);
+    FAIL_IF_NULL(bulk);
+    FAIL_IF(DatasetBulkApplyValues(bulk, "10.0.0.1\n10.0.0.9\n10.0.0.4") != 0);
+    DatasetBulkFinish(bulk, true, &stats);
+    FAIL_IF_NOT(stats.removed == 2);
+    FAIL_IF_NOT(stats.unchanged == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.1") == 0);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.2") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.3") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.4") == 0);
+
+    DatasetsDestroy();
+    PASS;
+}
+
+/** \test replace from a file: old and new data match during the update,
+ *        stale data is only removed when it's finished */
+static int DatasetBulkTest03(void)
+{
+    Dataset *set = DatasetBulkTestSet("bulk-test-03", "10.0.0.1\n10.0.0.2");
+    FAIL_IF_NULL(set);
+    char path[] = "/tmp/suricata-dataset-bulk-XXXXXX";
+    FAIL_IF(DatasetBulkTestWriteFile(path, "10.0.0.2\n10.0.0.3\n") != 0);
+
+    DatasetBulk *bulk = DatasetBulkStart(set, DATASET_BULK_REPLACE);
+    FAIL_IF_NULL(bulk);
+    FAIL_IF(DatasetBulkApplyFile(bulk, path) != 0);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.1") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.2") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.3") == 1);
+    DatasetBulkStats stats;
+    DatasetBulkFinish(bulk, true, &stats);
+    FAIL_IF_NOT(stats.added == 1);
+    FAIL_IF_NOT(stats.unchanged == 1);
+    FAIL_IF_NOT(stats.removed == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.1") == 0);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.2") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.3") == 1);
+
+    unlink(path);
+    DatasetsDestroy();
+    PASS;
+}
+
+/** \test replace from a file that fails mid-way: the data up to the bad line
+ *        is applied, nothing is removed */
+static int DatasetBulkTest04(void)
+{
+    Dataset *set = DatasetBulkTestSet("bulk-test-04", "10.0.0.1");
+    FAIL_IF_NULL(set);
+
+    /* second line is longer than any serialized item can be */
+    const size_t long_len = DATASET_BULK_LINE_MAX + 16;
+    char *data = SCCalloc(1, long_len + 32);
+    FAIL_IF_NULL(data);
+    strlcpy(data, "10.0.0.2\n", long_len + 32);
+    memset(data + 9, 'A', long_len);
+    strlcpy(data + 9 + long_len, "\n10.0.0.3\n", 32);
+    char path[] = "/tmp/suricata-dataset-bulk-XXXXXX";
+    FAIL_IF(DatasetBulkTestWriteFile(path, data) != 0);
+    SCFree(data);
+
+    DatasetBulk *bulk = DatasetBulkStart(set, DATASET_BULK_REPLACE);
+    FAIL_IF_NULL(bulk);
+    FAIL_IF_NOT(DatasetBulkApplyFile(bulk, path) == 2);
+    DatasetBulkStats stats;
+    DatasetBulkFinish(bulk, false, &stats);
+    FAIL_IF_NOT(stats.added == 1);
+    FAIL_IF_NOT(stats.removed == 0);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.1") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.2") == 1);
+    FAIL_IF_NOT(DatasetLookupSerialized(set, "10.0.0.3") == 0);
+
+    unlink(path);
+    DatasetsDestroy();
+    PASS;
+}
+
+void DatasetsRegisterTests(void)
+{
+    UtRegisterTest("DatasetBulkTest01", DatasetBulkTest01);
+    UtRegisterTest("DatasetBulkTest02", DatasetBulkTest02);
+    UtRegisterTest("DatasetBulkTest03", DatasetBulkTest03);
+    UtRegisterTest("DatasetBulkTest04", DatasetBulkTest04);
+}
+#endif /* UNITTESTS */
@@ -60,6 +60,15 @@ typedef struct Dataset {
     bool hidden;                        /* Mark the old sets hidden in case of reload */
     bool remove_key;                    /* Mark that value key should be removed from extra data */
     THashTableContext *hash;
+    /** read-only compiled set, used instead of \a hash if loaded from a
+     *  compiled dataset file */
+    struct DatasetCompiled *compiled;
+    /** optional bloom filter in front of \a hash to cheaply reject lookups
+     *  of data that is not in the set */
+    struct BloomFilter_ *filter;
+    /** lookups checked against and rejected by \a filter */
+    SC_ATOMIC_DECLARE(uint64_t, filter_checks);
+    SC_ATOMIC_DECLARE(uint64_t, filter_rejects);
 
     char load[PATH_MAX];
     char save[PATH_MAX];
@@ -90,6 +99,31 @@ int DatasetAddSerialized(Dataset *set, const char *string);
 int DatasetRemoveSerialized(Dataset *set, const char *string);
 int DatasetLookupSerialized(Dataset *set, const char *string);
 
+enum DatasetBulkMode {
+    DATASET_BULK_ADD = 0, /**< add the data to the set */
+    DATASET_BULK_REMOVE,  /**< remove the data from the set */
+    DATASET_BULK_REPLACE, /**< replace the content of the set with the data */
+};
+
+typedef struct DatasetBulkStats {
+    uint32_t added;     /**< data added to the set */
+    uint32_t removed;   /**< data removed from the set */
+    uint32_t unchanged; /**< data already in the set, or not removed */
+    uint32_t invalid;   /**< data that failed to parse */
+} DatasetBulkStats;
+
+typedef struct DatasetBulk DatasetBulk;
+
+DatasetBulk *DatasetBulkStart(Dataset *set, enum DatasetBulkMode mode);
+int DatasetBulkApply(DatasetBulk *bulk, const char *string);
+uint32_t DatasetBulkApplyFile(DatasetBulk *bulk, const char *filename);
+uint32_t DatasetBulkApplyValues(DatasetBulk *bulk, const char *values);
+void DatasetBulkFinish(DatasetBulk *bulk, bool commit, DatasetBulkStats *stats);
+
+#ifdef UNITTESTS
+void DatasetsRegisterTests(void);
+#endif
+
 #endif // SURICATA_BINDGEN_H
 
 #endif /* SURICATA_DATASETS_H */
@@ -49,8 +49,15 @@
 #define DETECT_DATASET_CMD_ISNOTSET 2
 #define DETECT_DATASET_CMD_ISSET    3
 
+#define DETECT_DATASET_MATCH_EXACT  0
+#define DETECT_DATASET_MATCH_SUFFIX 1
+#define DETECT_DATASET_MATCH_PREFIX 2
+
 static int DetectDatasetSetup (DetectEngineCtx *, Signature *, const char *);
 void DetectDatasetFree (DetectEngineCtx *, void *);
+#ifdef UNITTESTS
+static void DetectDatasetRegisterTests(void);
+#endif
 
 void DetectDatasetRegister (void)
 {
@@ -59,6 +66,9 @@ void DetectDatasetRegister (void)
     sigmatch_table[DETECT_DATASET].url = "/rules/dataset-keywords.html#dataset";
     sigmatch_table[DETECT_DATASET].Setup = DetectDatasetSetup;
     sigmatch_table[DETECT_DATASET].Free  = DetectDatasetFree;
+#ifdef UNITTESTS
+    sigmatch_table[DETECT_DATASET].RegisterTests = DetectDatasetRegisterTests;
+#endif
 }
 
 /*
@@ -113,6 +123,46 @@ static int DetectDatajsonBufferMatch(DetectEngineThreadCtx *det_ctx, const Detec
     return 0;
 }
 
+/** \internal
+ *  \brief look up the buffer and its label suffixes or prefixes
+ *
+ *  In suffix mode "www.example.com" is looked up as "www.example.com",
+ *  "example.com" and "com". In prefix mode "/a/b/c" is looked up as
+ *  "/a/b/c", "/a/b" and "/a". Each lookup is a single hash lookup, so the
+ *  cost depends on the number of labels in the buffer, not on the size of
+ *  the set.
+ *
+ *  \retval 1 buffer or one of its parts is in the set
+ *  \retval 0 not found
+ *  \retval -1 error
+ */
+static int DetectDatasetLookup(
+        const DetectDatasetData *sd, const uint8_t *data, const uint32_t data_len)
+{
+    int r = DatasetLookup(sd->set, data, data_len);
+    if (r != 0 || sd->match == DETECT_DATASET_MATCH_EXACT)
+        return r;
+
+    if (sd->match == DETECT_DATASET_MATCH_SUFFIX) {
+        for (uint32_t i = 0; i + 1 < data_len; i++) {
+            if (data[i] != '.')
+                continue;
+            r = DatasetLookup(sd->set, data + i + 1, data_len - i - 1);
+            if (r != 0)
+                return r;
+        }
+    } else {
+        for (uint32_t i = data_len - 1; i > 0; i--) {
+            if (data[i] != '/')
+                continue;
+            r = DatasetLookup(sd->set, data, i);
+            if (r != 0)
+                return r;
+        }
+    }
+    return 0;
+}
+
 /*
     1 match
     0 no match
@@ -131,7 +181,7 @@ int DetectDatasetBufferMatch(DetectEngineThreadCtx *det_ctx,
     switch (sd->cmd) {
         case DETECT_DATASET_CMD_ISSET: {
             //PrintRawDataFp(stdout, data, data_len);
-            int r = DatasetLookup(sd->set, data, data_len);
+            int r = DetectDatasetLookup(sd, data, data_len);
             SCLogDebug("r %d", r);
             if (r == 1)
                 return 1;
@@ -139,7 +189,7 @@ int DetectDatasetBufferMatch(DetectEngineThreadCtx *det_ctx,
         }
         case DETECT_DATASET_CMD_ISNOTSET: {
             //PrintRawDataFp(stdout, data, data_len);
-            int r = DatasetLookup(sd->set, data, data_len);
+            int r = DetectDatasetLookup(sd, data, data_len);
             SCLogDebug("r %d", r);
             if (r < 1)
                 return 1;
@@ -168,7 +218,7 @@ static int DetectDatasetParse(const char *str, char *cmd, int cmd_len, char *nam
         enum DatasetTypes *type, char *load, size_t load_size, char *save, size_t save_size,
         uint64_t *memcap, uint32_t *hashsize, DatasetFormats *format, char *value_key,
         size_t value_key_size, char *array_key, size_t array_key_size, char *enrichment_key,
-        size_t enrichment_key_size, bool *remove_key)
+        size_t enrichment_key_size, bool *remove_key, uint8_t *match)
 {
     bool cmd_set = false;
     bool name_set = false;
@@ -176,6 +226,7 @@ static int DetectDatasetParse(const char *str, char *cmd, int cmd_len, char *nam
     bool save_set = false;
     bool state_set = false;
     bool format_set = false;
+    bool match_set = false;
 
     char copy[strlen(str)+1];
     strlcpy(copy, str, sizeof(copy));
@@ -282,6 +333,23 @@ static int DetectDatasetParse(const char *str, char *cmd, int cmd_len, char *nam
                     return -1;
                 }
                 format_set = true;
+            } else if (strcmp(key, "match") == 0) {
+                if (match_set) {
+                    SCLogError("'match' can only appear once");
+                    return -1;
+                }
+                SCLogDebug("match %s", val);
+                if (strcmp(val, "exact") == 0) {
+                    *match = DETECT_DATASET_MATCH_EXACT;
+                } else if (strcmp(val, "suffix") == 0) {
+                    *match = DETECT_DATASET_MATCH_SUFFIX;
+                } else if (strcmp(val, "prefix") == 0) {
+                    *match = DETECT_DATASET_MATCH_PREFIX;
+                } else {
+                    SCLogError("unknown match mode %s", val);
+                    return -1;
+                }
+                match_set = true;
             } else if (strcmp(key, "value_key") == 0) {
                 if (strlen(val) > value_key_size) {
                     SCLogError("'key' value too long (limit is %zu)", value_key_size);
@@ -473,6 +541,7 @@ int DetectDatasetSetup (DetectEngineCtx *de_ctx, Signature *s, const char *rawst
     char array_key[SIG_JSON_CONTENT_KEY_LEN] = "";
     char enrichment_key[SIG_JSON_CONTENT_KEY_LEN] = "";
     bool remove_key = false;
+    uint8_t match = DETECT_DATASET_MATCH_EXACT;
 
     if (DetectBufferGetActiveList(de_ctx, s) == -1) {
         SCLogError("datasets are only supported for sticky buffers");
@@ -488,7 +557,7 @@ int DetectDatasetSetup (DetectEngineCtx *de_ctx, Signature *s, const char *rawst
     if (!DetectDatasetParse(rawstr, cmd_str, sizeof(cmd_str), name, sizeof(name), &type, load,
                 sizeof(load), save, sizeof(save), &memcap, &hashsize, &format, value_key,
                 sizeof(value_key), array_key, sizeof(array_key), enrichment_key,
-                sizeof(enrichment_key), &remove_key)) {
+                sizeof(enrichment_key), &remove_key, &match)) {
         return -1;
     }
 
@@ -513,6 +582,21 @@ int DetectDatasetSetup (DetectEngineCtx *de_ctx, Signature *s, const char *rawst
         return -1;
     }
 
+    if (match != DETECT_DATASET_MATCH_EXACT) {
+        if (cmd != DETECT_DATASET_CMD_ISSET && cmd != DETECT_DATASET_CMD_ISNOTSET) {
+            SCLogError("'match' is only supported for 'isset' and 'isnotset' commands");
+            return -1;
+        }
+        if (type != DATASET_TYPE_STRING && type != DATASET_TYPE_NOTSET) {
+            SCLogError("'match' is only supported for string datasets");
+            return -1;
+        }
+        if ((format == DATASET_FORMAT_JSON) || (format == DATASET_FORMAT_NDJSON)) {
+            SCLogError("'match' is not supported for json format");
+            return -1;
+        }
+    }
+
     if ((format == DATASET_FORMAT_JSON) || (format == DATASET_FORMAT_NDJSON)) {
         if (strlen(save) != 0) {
             SCLogError("json format is not supported with 'save' or 'state' option");
@@ -563,6 +647,10 @@ int DetectDatasetSetup (DetectEngineCtx *de_ctx, Signature *s, const char *rawst
         SCLogError("failed to set up dataset '%s'.", name);
         return -1;
     }
+    if (match != DETECT_DATASET_MATCH_EXACT && set->type != DATASET_TYPE_STRING) {
+        SCLogError("'match' is only supported for string datasets");
+        return -1;
+    }
 
     cd = SCCalloc(1, sizeof(DetectDatasetData));
     if (unlikely(cd == NULL))
@@ -571,6 +659,7 @@ int DetectDatasetSetup (DetectEngineCtx *de_ctx, Signature *s, const char *rawst
     cd->set = set;
     cd->cmd = cmd;
     cd->format = format;
+    cd->match = match;
     if ((format == DATASET_FORMAT_JSON) || (format == DATASET_FORMAT_NDJSON)) {
         strlcpy(cd->json_key, enrichment_key, sizeof(cd->json_key));
     }
@@ -601,3 +690,112 @@ void DetectDatasetFree (DetectEngineCtx *de_ctx, void *ptr)
 
     SCFree(fd);
 }
+
+#ifdef UNITTESTS
+#include "util-unittest.h"
+
+/** \retval 1 rule loaded, 0 rule rejected, -1 error */
+static int DetectDatasetTestAppendSig(const char *sig)
+{
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    if (de_ctx == NULL)
+        return -1;
+    de_ctx->flags |= DE_QUIET;
+    Signature *s = DetectEngineAppendSig(de_ctx, sig);
+    DetectEngineCtxFree(de_ctx);
+    DatasetsDestroy();
+    return s != NULL;
+}
+
+/** \test match option parsing */
+static int DetectDatasetParseTest01(void)
+{
+    const char *valid[] = {
+        "alert http any any -> any any (http.host; "
+        "dataset:isset,dstest,type string,match exact; sid:1;)",
+        "alert http any any -> any any (http.host; "
+        "dataset:isset,dstest,type string,match suffix; sid:1;)",
+        "alert http any any -> any any (http.uri; "
+        "dataset:isnotset,dstest,type string,match prefix; sid:1;)",
+    };
+    const char *invalid[] = {
+        /* unknown mode, mode set twice */
+        "alert http any any -> any any (http.host; "
+        "dataset:isset,dstest,type string,match label; sid:1;)",
+        "alert http any any -> any any (http.host; "
+        "dataset:isset,dstest,type string,match suffix,match prefix; sid:1;)",
+        /* only for isset/isnotset on string sets */
+        "alert http any any -> any any (http.host; "
+        "dataset:set,dstest,type string,match suffix; sid:1;)",
+        "alert http any any -> any any (http.host; "
+        "dataset:isset,dstest4,type ipv4,match suffix; sid:1;)",
+        "alert http any any -> any any (http.host; "
+        "dataset:isset,dstestmd5,type md5,match prefix; sid:1;)",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(valid); i++) {
+        FAIL_IF_NOT(DetectDatasetTestAppendSig(valid[i]) == 1);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(invalid); i++) {
+        FAIL_IF_NOT(DetectDatasetTestAppendSig(invalid[i]) == 0);
+    }
+    PASS;
+}
+
+static int DetectDatasetTestMatch(const DetectDatasetData *sd, const char *buf)
+{
+    return DetectDatasetBufferMatch(NULL, sd, (const uint8_t *)buf, (uint32_t)strlen(buf));
+}
+
+/** \test suffix and prefix matching */
+static int DetectDatasetMatchTest01(void)
+{
+    Dataset *set = DatasetGet("dstest-match", DATASET_TYPE_STRING, NULL, NULL, 0, 0);
+    FAIL_IF_NULL(set);
+    FAIL_IF(SCDatasetAdd(set, (const uint8_t *)"example.com", 11) != 1);
+    FAIL_IF(SCDatasetAdd(set, (const uint8_t *)"/a/b", 4) != 1);
+
+    DetectDatasetData sd;
+    memset(&sd, 0, sizeof(sd));
+    sd.set = set;
+    sd.cmd = DETECT_DATASET_CMD_ISSET;
+    sd.format = DATASET_FORMAT_CSV;
+
+    sd.match = DETECT_DATASET_MATCH_EXACT;
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "example.com") == 1);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "www.example.com") == 0);
+
+    sd.match = DETECT_DATASET_MATCH_SUFFIX;
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "example.com") == 1);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "www.example.com") == 1);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "a.b.www.example.com") == 1);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "badexample.com") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "example.com.") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "com") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "localhost") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, ".") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "") == 0);
+
+    sd.match = DETECT_DATASET_MATCH_PREFIX;
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "/a/b") == 1);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "/a/b/c") == 1);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "/a/b/c/d") == 1);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "/a/bc") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "/a") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "/") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "") == 0);
+
+    sd.cmd = DETECT_DATASET_CMD_ISNOTSET;
+    sd.match = DETECT_DATASET_MATCH_SUFFIX;
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "www.example.com") == 0);
+    FAIL_IF_NOT(DetectDatasetTestMatch(&sd, "badexample.com") == 1);
+
+    DatasetsDestroy();
+    PASS;
+}
+
+static void DetectDatasetRegisterTests(void)
+{
+    UtRegisterTest("DetectDatasetParseTest01", DetectDatasetParseTest01);
+    UtRegisterTest("DetectDatasetMatchTest01", DetectDatasetMatchTest01);
+}
+#endif /* UNITTESTS */
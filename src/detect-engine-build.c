@@ -1886,6 +1886,12 @@ int SigPrepareStage2(DetectEngineCtx *de_ctx)
     de_ctx->flow_gh[1].udp = RulesGroupByPorts(de_ctx, IPPROTO_UDP, SIG_FLAG_TOSERVER);
     de_ctx->flow_gh[0].udp = RulesGroupByPorts(de_ctx, IPPROTO_UDP, SIG_FLAG_TOCLIENT);
 
+    /* flatten the port lists into direct lookup tables for the runtime */
+    for (int f = 0; f < FLOW_STATES; f++) {
+        de_ctx->flow_gh[f].tcp_map = DetectPortGroupMapBuild(de_ctx->flow_gh[f].tcp);
+        de_ctx->flow_gh[f].udp_map = DetectPortGroupMapBuild(de_ctx->flow_gh[f].udp);
+    }
+
     /* Setup the other IP Protocols (so not TCP/UDP) */
     RulesGroupByIPProto(de_ctx);
 
@@ -1988,7 +1994,11 @@ int SigAddressCleanupStage1(DetectEngineCtx *de_ctx)
             de_ctx->flow_gh[f].sgh[p] = NULL;
         }
 
-        /* free lookup lists */
+        /* free lookup tables and lists */
+        DetectPortGroupMapFree(de_ctx->flow_gh[f].tcp_map);
+        de_ctx->flow_gh[f].tcp_map = NULL;
+        DetectPortGroupMapFree(de_ctx->flow_gh[f].udp_map);
+        de_ctx->flow_gh[f].udp_map = NULL;
         DetectPortCleanupList(de_ctx, de_ctx->flow_gh[f].tcp);
         de_ctx->flow_gh[f].tcp = NULL;
         DetectPortCleanupList(de_ctx, de_ctx->flow_gh[f].udp);
@@ -2235,6 +2245,10 @@ int SigGroupBuild(DetectEngineCtx *de_ctx)
         FatalError("initializing the detection engine failed");
     }
 
+    if (DetectEngineBufferTypeSetupTransformsPrefix(de_ctx) != 0) {
+        FatalError("initializing the detection engine failed");
+    }
+
     if (SigMatchPrepare(de_ctx) != 0) {
         FatalError("initializing the detection engine failed");
     }
@@ -193,11 +193,54 @@ void InspectionBufferSetup(DetectEngineThreadCtx *det_ctx, const int list_id,
     InspectionBufferSetupInternal(det_ctx, list_id, buffer, data, data_len);
 }
 
-/** \brief setup the buffer with our initial data */
+/** \internal
+ *  \brief get the result of the buffer with all but the last of our
+ *         transforms applied to the same data
+ *
+ *  The prefix buffer is only used if its own GetData already set it up:
+ *  GetData callbacks can set more than the data, like the DCE endianness
+ *  flags, so setting it up from here would leave those unset.
+ *
+ *  \retval prefix buffer or NULL if there is no such buffer available */
+static const InspectionBuffer *InspectionBufferGetTransformsPrefix(DetectEngineThreadCtx *det_ctx,
+        const int list_id, const uint8_t *data, const uint32_t data_len)
+{
+    const DetectBufferTransformsPrefix *prefix =
+            &det_ctx->de_ctx->buffer_transforms_prefix[list_id];
+    if (prefix->list_id == 0)
+        return NULL;
+
+    const InspectionBuffer *pbuffer = InspectionBufferGet(det_ctx, prefix->list_id);
+    if (!pbuffer->initialized || pbuffer->orig != data || pbuffer->orig_len != data_len)
+        return NULL;
+    return pbuffer;
+}
+
+/** \brief setup the buffer with our initial data
+ *
+ *  If the result of all but the last transform is available from another
+ *  buffer type, only the last transform is applied to it.
+ */
 void InspectionBufferSetupAndApplyTransforms(DetectEngineThreadCtx *det_ctx, const int list_id,
         InspectionBuffer *buffer, const uint8_t *data, const uint32_t data_len,
         const DetectEngineTransforms *transforms)
 {
+    if (transforms != NULL && transforms->cnt > 1 && det_ctx != NULL && list_id >= 0 &&
+            det_ctx->de_ctx->buffer_transforms_prefix != NULL) {
+        const InspectionBuffer *pbuffer =
+                InspectionBufferGetTransformsPrefix(det_ctx, list_id, data, data_len);
+        if (pbuffer != NULL) {
+            InspectionBufferSetupInternal(
+                    det_ctx, list_id, buffer, pbuffer->inspect, pbuffer->inspect_len);
+            buffer->orig = data;
+            buffer->orig_len = data_len;
+
+            const TransformData *t = &transforms->transforms[transforms->cnt - 1];
+            DEBUG_VALIDATE_BUG_ON(sigmatch_table[t->transform].Transform == NULL);
+            sigmatch_table[t->transform].Transform(det_ctx, buffer, t->options);
+            return;
+        }
+    }
     InspectionBufferSetupInternal(det_ctx, list_id, buffer, data, data_len);
     InspectionBufferApplyTransformsInternal(det_ctx, buffer, transforms);
 }
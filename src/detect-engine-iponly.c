@@ -550,10 +550,18 @@ static void IPOnlyCIDRListPrint(IPOnlyCIDRItem *tmphead)
 /** \brief user data for storing signature id's in the radix tree
  *
  *  Bit array representing signature internal id's (Signature::num).
+ *
+ *  Only the range of bytes between the lowest and the highest sig num
+ *  set in the node is stored: array[0] holds the bits of byte `offset` of
+ *  the full bit array. With large IP-only lists most nodes only hold one
+ *  or a few rules, so this keeps both the per node memory and the per
+ *  packet AND of the src and dst arrays proportional to the rules in the
+ *  node instead of to the total number of IP-only rules.
  */
 typedef struct SigNumArray_ {
-    uint8_t *array; /* bit array of sig nums */
-    uint32_t size;  /* size in bytes of the array */
+    uint8_t *array;  /* bit array of sig nums */
+    uint32_t offset; /* offset in bytes of array[0] in the full bit array */
+    uint32_t size;   /* size in bytes of the array */
 } SigNumArray;
 
 /**
@@ -568,38 +576,24 @@ static void SigNumArrayPrint(void *tmp)
         uint8_t bitarray = sna->array[u];
         for (uint8_t i = 0; i < 8; i++) {
             if (bitarray & 0x01)
-                printf("%" PRIu32 " ", u * 8 + i);
+                printf("%" PRIu32 " ", (sna->offset + u) * 8 + i);
             bitarray = bitarray >> 1;
         }
     }
 }
 
 /**
- * \brief This function creates a new SigNumArray with the
- *        size fixed to the io_ctx->max_idx
- * \param de_ctx Pointer to the current detection context
- * \param io_ctx Pointer to the current ip only context
+ * \brief This function creates a new, empty SigNumArray
  *
  * \retval SigNumArray address of the new instance
  */
-static SigNumArray *SigNumArrayNew(DetectEngineCtx *de_ctx,
-                            DetectEngineIPOnlyCtx *io_ctx)
+static SigNumArray *SigNumArrayNew(void)
 {
     SigNumArray *new = SCCalloc(1, sizeof(SigNumArray));
 
     if (unlikely(new == NULL)) {
         FatalError("Fatal error encountered in SigNumArrayNew. Exiting...");
     }
-
-    new->array = SCCalloc(1, io_ctx->max_idx / 8 + 1);
-    if (new->array == NULL) {
-       exit(EXIT_FAILURE);
-    }
-
-    new->size = io_ctx->max_idx / 8 + 1;
-
-    SCLogDebug("max idx= %u", io_ctx->max_idx);
-
     return new;
 }
 
@@ -619,6 +613,10 @@ static SigNumArray *SigNumArrayCopy(SigNumArray *orig)
         FatalError("Fatal error encountered in SigNumArrayCopy. Exiting...");
     }
 
+    if (orig->size == 0)
+        return new;
+
+    new->offset = orig->offset;
     new->size = orig->size;
 
     new->array = SCMalloc(orig->size);
@@ -630,6 +628,64 @@ static SigNumArray *SigNumArrayCopy(SigNumArray *orig)
     return new;
 }
 
+/**
+ * \brief Set a sig num in a SigNumArray, growing the stored range
+ *        if needed
+ *
+ * \param sna the SigNumArray to update
+ * \param signum the (mapped) sig num to set
+ */
+static void SigNumArraySet(SigNumArray *sna, const uint32_t signum)
+{
+    const uint32_t idx = signum / 8;
+
+    if (sna->size == 0) {
+        sna->array = SCCalloc(1, 1);
+        if (sna->array == NULL) {
+            FatalError("Fatal error encountered in SigNumArraySet. Exiting...");
+        }
+        sna->offset = idx;
+        sna->size = 1;
+    } else if (idx < sna->offset) {
+        const uint32_t grow = sna->offset - idx;
+        uint8_t *array = SCCalloc(1, sna->size + grow);
+        if (array == NULL) {
+            FatalError("Fatal error encountered in SigNumArraySet. Exiting...");
+        }
+        memcpy(array + grow, sna->array, sna->size);
+        SCFree(sna->array);
+        sna->array = array;
+        sna->offset = idx;
+        sna->size += grow;
+    } else if (idx >= sna->offset + sna->size) {
+        const uint32_t size = idx - sna->offset + 1;
+        uint8_t *array = SCRealloc(sna->array, size);
+        if (array == NULL) {
+            FatalError("Fatal error encountered in SigNumArraySet. Exiting...");
+        }
+        memset(array + sna->size, 0, size - sna->size);
+        sna->array = array;
+        sna->size = size;
+    }
+
+    sna->array[idx - sna->offset] |= (uint8_t)(1 << (signum % 8));
+}
+
+/**
+ * \brief Unset a sig num in a SigNumArray
+ *
+ * \param sna the SigNumArray to update
+ * \param signum the (mapped) sig num to unset
+ */
+static void SigNumArrayUnset(SigNumArray *sna, const uint32_t signum)
+{
+    const uint32_t idx = signum / 8;
+    if (idx < sna->offset || idx >= sna->offset + sna->size)
+        return;
+
+    sna->array[idx - sna->offset] &= (uint8_t)~(1 << (signum % 8));
+}
+
 /**
  * \brief This function free() a SigNumArray
  * \param orig Pointer to the original SigNumArray to copy
@@ -1028,10 +1084,16 @@ void IPOnlyMatchPacket(ThreadVars *tv, const DetectEngineCtx *de_ctx,
     if (src == NULL || dst == NULL)
         SCReturn;
 
-    for (uint32_t u = 0; u < src->size; u++) {
-        SCLogDebug("And %"PRIu8" & %"PRIu8, src->array[u], dst->array[u]);
+    /* only the overlapping part of the stored ranges can have matches */
+    const uint32_t start = MAX(src->offset, dst->offset);
+    const uint32_t end = MIN(src->offset + src->size, dst->offset + dst->size);
 
-        uint8_t bitarray = dst->array[u] & src->array[u];
+    for (uint32_t u = start; u < end; u++) {
+        const uint8_t src_bits = src->array[u - src->offset];
+        const uint8_t dst_bits = dst->array[u - dst->offset];
+        SCLogDebug("And %" PRIu8 " & %" PRIu8, src_bits, dst_bits);
+
+        uint8_t bitarray = dst_bits & src_bits;
 
         /* We have to move the logic of the signature checking
          * to the main detect loop, in order to apply the
@@ -1065,8 +1127,8 @@ void IPOnlyMatchPacket(ThreadVars *tv, const DetectEngineCtx *de_ctx,
                         if (p->flags & PKT_IS_FRAGMENT)
                             continue;
 
-                        const DetectPort *dport = DetectPortLookupGroup(s->dp, p->dp);
-                        if (dport == NULL) {
+                        if (DetectPortMatchArray(
+                                    s->port_dst_match, s->port_dst_match_cnt, p->dp) == 0) {
                             SCLogDebug("dport didn't match.");
                             continue;
                         }
@@ -1075,8 +1137,8 @@ void IPOnlyMatchPacket(ThreadVars *tv, const DetectEngineCtx *de_ctx,
                         if (p->flags & PKT_IS_FRAGMENT)
                             continue;
 
-                        const DetectPort *sport = DetectPortLookupGroup(s->sp, p->sp);
-                        if (sport == NULL) {
+                        if (DetectPortMatchArray(
+                                    s->port_src_match, s->port_src_match_cnt, p->sp) == 0) {
                             SCLogDebug("sport didn't match.");
                             continue;
                         }
@@ -1120,13 +1182,10 @@ void IPOnlyMatchPacket(ThreadVars *tv, const DetectEngineCtx *de_ctx,
 
 static void IPOnlyPrepareUpdateBitarray(const IPOnlyCIDRItem *src, SigNumArray *sna)
 {
-    uint8_t tmp = (uint8_t)(1 << (src->signum % 8));
     if (src->negated > 0)
-        /* Unset it */
-        sna->array[src->signum / 8] &= ~tmp;
+        SigNumArrayUnset(sna, src->signum);
     else
-        /* Set it */
-        sna->array[src->signum / 8] |= tmp;
+        SigNumArraySet(sna, src->signum);
 }
 
 /**
@@ -1182,7 +1241,7 @@ void IPOnlyPrepare(DetectEngineCtx *de_ctx)
                     SCLogDebug("best match not found");
 
                     /* Not found, insert a new one */
-                    SigNumArray *sna = SigNumArrayNew(de_ctx, &de_ctx->io_ctx);
+                    SigNumArray *sna = SigNumArrayNew();
                     IPOnlyPrepareUpdateBitarray(src, sna);
 
                     if (src->netmask == 32)
@@ -1239,7 +1298,7 @@ void IPOnlyPrepare(DetectEngineCtx *de_ctx)
                         &de_ctx->io_ctx.tree_ipv6src, (uint8_t *)&src->ip[0], &user_data);
                 if (user_data == NULL) {
                     /* Not found, insert a new one */
-                    SigNumArray *sna = SigNumArrayNew(de_ctx, &de_ctx->io_ctx);
+                    SigNumArray *sna = SigNumArrayNew();
                     IPOnlyPrepareUpdateBitarray(src, sna);
 
                     if (src->netmask == 128)
@@ -1307,7 +1366,7 @@ void IPOnlyPrepare(DetectEngineCtx *de_ctx)
                     SCLogDebug("Best match not found");
 
                     /** Not found, insert a new one */
-                    SigNumArray *sna = SigNumArrayNew(de_ctx, &de_ctx->io_ctx);
+                    SigNumArray *sna = SigNumArrayNew();
                     IPOnlyPrepareUpdateBitarray(dst, sna);
 
                     if (dst->netmask == 32)
@@ -1362,7 +1421,7 @@ void IPOnlyPrepare(DetectEngineCtx *de_ctx)
                         &de_ctx->io_ctx.tree_ipv6dst, (uint8_t *)&dst->ip[0], &user_data);
                 if (user_data == NULL) {
                     /* Not found, insert a new one */
-                    SigNumArray *sna = SigNumArrayNew(de_ctx, &de_ctx->io_ctx);
+                    SigNumArray *sna = SigNumArrayNew();
                     IPOnlyPrepareUpdateBitarray(dst, sna);
 
                     if (dst->netmask == 128)
@@ -2347,6 +2406,39 @@ static int IPOnlyTestBug5168v2(void)
     PASS;
 }
 
+static int IPOnlyTestSigNumArray01(void)
+{
+    SigNumArray *sna = SigNumArrayNew();
+    FAIL_IF_NOT(sna->size == 0);
+
+    SigNumArraySet(sna, 100);
+    FAIL_IF_NOT(sna->offset == 12);
+    FAIL_IF_NOT(sna->size == 1);
+
+    /* grow up and down */
+    SigNumArraySet(sna, 300);
+    SigNumArraySet(sna, 20);
+    FAIL_IF_NOT(sna->offset == 2);
+    FAIL_IF_NOT(sna->size == 36);
+    FAIL_IF_NOT(sna->array[(100 / 8) - sna->offset] & (1 << (100 % 8)));
+    FAIL_IF_NOT(sna->array[(300 / 8) - sna->offset] & (1 << (300 % 8)));
+    FAIL_IF_NOT(sna->array[(20 / 8) - sna->offset] & (1 << (20 % 8)));
+
+    /* unset outside of the range is a noop */
+    SigNumArrayUnset(sna, 1000);
+    SigNumArrayUnset(sna, 100);
+    FAIL_IF(sna->array[(100 / 8) - sna->offset] & (1 << (100 % 8)));
+
+    SigNumArray *copy = SigNumArrayCopy(sna);
+    FAIL_IF_NOT(copy->offset == sna->offset);
+    FAIL_IF_NOT(copy->size == sna->size);
+    FAIL_IF_NOT(memcmp(copy->array, sna->array, sna->size) == 0);
+
+    SigNumArrayFree(copy);
+    SigNumArrayFree(sna);
+    PASS;
+}
+
 #endif /* UNITTESTS */
 
 void IPOnlyRegisterTests(void)
@@ -2392,5 +2484,7 @@ void IPOnlyRegisterTests(void)
 
     UtRegisterTest("IPOnlyTestBug5168v1", IPOnlyTestBug5168v1);
     UtRegisterTest("IPOnlyTestBug5168v2", IPOnlyTestBug5168v2);
+
+    UtRegisterTest("IPOnlyTestSigNumArray01", IPOnlyTestSigNumArray01);
 #endif
 }
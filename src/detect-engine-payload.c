@@ -53,12 +53,23 @@
 struct StreamMpmData {
     DetectEngineThreadCtx *det_ctx;
     const MpmCtx *mpm_ctx;
+    /** if re is set, only scan the data between these absolute offsets */
+    uint64_t le;
+    uint64_t re;
 };
 
 static int StreamMpmFunc(
-        void *cb_data, const uint8_t *data, const uint32_t data_len, const uint64_t _offset)
+        void *cb_data, const uint8_t *data, uint32_t data_len, const uint64_t offset)
 {
     struct StreamMpmData *smd = cb_data;
+    if (smd->re != 0) {
+        const uint64_t le = MAX(offset, smd->le);
+        const uint64_t re = MIN(offset + data_len, smd->re);
+        if (le >= re)
+            return 0;
+        data += le - offset;
+        data_len = (uint32_t)(re - le);
+    }
     if (data_len >= smd->mpm_ctx->minlen) {
 #ifdef DEBUG
         smd->det_ctx->stream_mpm_cnt++;
@@ -82,7 +93,16 @@ static void PrefilterPktStream(DetectEngineThreadCtx *det_ctx,
     if (p->flags & PKT_DETECT_HAS_STREAMDATA) {
         SCLogDebug("PRE det_ctx->raw_stream_progress %"PRIu64,
                 det_ctx->raw_stream_progress);
-        struct StreamMpmData stream_mpm_data = { det_ctx, mpm_ctx };
+        struct StreamMpmData stream_mpm_data = { det_ctx, mpm_ctx, 0, 0 };
+        /* inline the data is a chunk around the packet. Patterns that don't
+         * overlap with the packet's data were found for earlier packets. */
+        if (stream_config.raw_mpm_incremental &&
+                StreamReassembleRawPacketRange(
+                        p->flow->protoctx, p, &stream_mpm_data.le, &stream_mpm_data.re)) {
+            const uint16_t overlap = mpm_ctx->maxlen > 0 ? mpm_ctx->maxlen - 1 : 0;
+            stream_mpm_data.le = stream_mpm_data.le > overlap ? stream_mpm_data.le - overlap : 0;
+            stream_mpm_data.re += overlap;
+        }
         StreamReassembleRaw(p->flow->protoctx, p,
                 StreamMpmFunc, &stream_mpm_data,
                 &det_ctx->raw_stream_progress,
@@ -351,6 +371,7 @@ uint8_t DetectEngineInspectStream(DetectEngineCtx *de_ctx, DetectEngineThreadCtx
 
 #ifdef UNITTESTS
 #include "detect-engine-alert.h"
+#include "stream-tcp-util.h"
 
 /** \test Not the first but the second occurrence of "abc" should be used
  *       for the 2nd match */
@@ -1134,6 +1155,79 @@ static int PayloadTestSig34(void)
     PASS;
 }
 
+/**
+ * \test inline stream mpm with raw-mpm-incremental: a pattern that starts
+ *       before the packet's data is found, one fully in earlier data isn't.
+ */
+static int PayloadTestStreamMpmIncremental01(void)
+{
+    TcpReassemblyThreadCtx *ra_ctx = NULL;
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(tv));
+    TcpSession ssn;
+    Flow f;
+    memset(&f, 0, sizeof(f));
+
+    StreamTcpUTInit(&ra_ctx);
+    StreamTcpUTInitInline();
+    stream_config.reassembly_toserver_chunk_size = 64;
+    StreamTcpUTSetupSession(&ssn);
+    StreamTcpUTSetupStream(&ssn.server, 1);
+    StreamTcpUTSetupStream(&ssn.client, 1);
+    ssn.client.last_ack = 2;
+    f.protoctx = &ssn;
+    f.proto = IPPROTO_TCP;
+
+    uint8_t seg1[] = "QQQQaaaXY";
+    uint8_t seg2[] = "ZWbbbbb";
+    FAIL_IF(StreamTcpUTAddPayload(&tv, ra_ctx, &ssn, &ssn.client, 2, seg1, 9) != 0);
+    FAIL_IF(StreamTcpUTAddPayload(&tv, ra_ctx, &ssn, &ssn.client, 11, seg2, 7) != 0);
+
+    MpmCtx mpm_ctx;
+    memset(&mpm_ctx, 0, sizeof(mpm_ctx));
+    MpmInitCtx(&mpm_ctx, MPM_AC);
+    FAIL_IF(MpmAddPatternCS(&mpm_ctx, (uint8_t *)"XYZW", 4, 0, 0, 0, 1, 0) != 0);
+    FAIL_IF(MpmAddPatternCS(&mpm_ctx, (uint8_t *)"QQQQ", 4, 0, 0, 1, 2, 0) != 0);
+    FAIL_IF(mpm_table[MPM_AC].Prepare(NULL, &mpm_ctx) != 0);
+
+    DetectEngineThreadCtx det_ctx;
+    memset(&det_ctx, 0, sizeof(det_ctx));
+    FAIL_IF(PmqSetup(&det_ctx.pmq) != 0);
+    MpmInitThreadCtx(&det_ctx.mtc, MPM_AC);
+
+    Packet *p = PacketGetFromAlloc();
+    FAIL_IF_NULL(p);
+    TCPHdr tcphdr;
+    memset(&tcphdr, 0, sizeof(tcphdr));
+    UTHSetTCPHdr(p, &tcphdr);
+    tcphdr.th_seq = htonl(11);
+    tcphdr.th_ack = htonl(10);
+    p->flow = &f;
+    p->flowflags = FLOW_PKT_TOSERVER;
+    p->payload = seg2;
+    p->payload_len = 7;
+    p->flags |= PKT_STREAM_ADD | PKT_DETECT_HAS_STREAMDATA;
+
+    stream_config.raw_mpm_incremental = true;
+    PrefilterPktStream(&det_ctx, p, &mpm_ctx);
+    FAIL_IF_NOT(det_ctx.pmq.rule_id_array_cnt == 1);
+    FAIL_IF_NOT(det_ctx.pmq.rule_id_array[0] == 1);
+
+    /* without the option the whole chunk is scanned */
+    PmqReset(&det_ctx.pmq);
+    stream_config.raw_mpm_incremental = false;
+    PrefilterPktStream(&det_ctx, p, &mpm_ctx);
+    FAIL_IF_NOT(det_ctx.pmq.rule_id_array_cnt == 2);
+
+    PacketFree(p);
+    MpmDestroyThreadCtx(&det_ctx.mtc, MPM_AC);
+    PmqFree(&det_ctx.pmq);
+    mpm_table[MPM_AC].DestroyCtx(&mpm_ctx);
+    StreamTcpUTClearSession(&ssn);
+    StreamTcpUTDeinit(ra_ctx);
+    PASS;
+}
+
 #endif /* UNITTESTS */
 
 void PayloadRegisterTests(void)
@@ -1175,5 +1269,6 @@ void PayloadRegisterTests(void)
     UtRegisterTest("PayloadTestSig32", PayloadTestSig32);
     UtRegisterTest("PayloadTestSig33", PayloadTestSig33);
     UtRegisterTest("PayloadTestSig34", PayloadTestSig34);
+    UtRegisterTest("PayloadTestStreamMpmIncremental01", PayloadTestStreamMpmIncremental01);
 #endif /* UNITTESTS */
 }
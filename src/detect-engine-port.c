@@ -52,6 +52,7 @@
 #include "util-profiling.h"
 #include "util-var.h"
 #include "util-byte.h"
+#include "util-validate.h"
 
 static int DetectPortCutNot(DetectPort *, DetectPort **);
 static int DetectPortCut(DetectEngineCtx *, DetectPort *, DetectPort *,
@@ -626,6 +627,118 @@ DetectPort *DetectPortLookupGroup(DetectPort *dp, uint16_t port)
     return NULL;
 }
 
+/**
+ * \brief Build a flat array of the ranges in a port list for cache
+ *        efficient matching at runtime.
+ *
+ * \param head port list, sorted and non-overlapping as created by the parser
+ * \param cnt set to the number of ranges in the returned array
+ *
+ * \retval array of DetectMatchPort's or NULL if the list is empty
+ */
+DetectMatchPort *DetectPortBuildMatchArray(const DetectPort *head, uint16_t *cnt)
+{
+    uint32_t len = 0;
+    for (const DetectPort *dp = head; dp != NULL; dp = dp->next) {
+        len++;
+    }
+    /* the ranges don't overlap, so there can't be more than 65536 */
+    DEBUG_VALIDATE_BUG_ON(len > UINT16_MAX);
+    if (len == 0) {
+        *cnt = 0;
+        return NULL;
+    }
+
+    DetectMatchPort *ports = SCCalloc(len, sizeof(DetectMatchPort));
+    if (ports == NULL) {
+        FatalError("failed to allocate port match array");
+    }
+
+    uint32_t idx = 0;
+    for (const DetectPort *dp = head; dp != NULL; dp = dp->next) {
+        /* DetectPortMatchArray relies on the ranges being sorted */
+        DEBUG_VALIDATE_BUG_ON(dp->next != NULL && dp->next->port <= dp->port2);
+        ports[idx].port = dp->port;
+        ports[idx].port2 = dp->port2;
+        idx++;
+    }
+    *cnt = (uint16_t)len;
+    return ports;
+}
+
+/**
+ * \brief Match a packet's port against a signature's port array
+ *
+ * \param ports array of DetectMatchPort's
+ * \param ports_cnt array size in members
+ * \param port packet's port
+ *
+ * \retval 0 no match
+ * \retval 1 match
+ */
+int DetectPortMatchArray(const DetectMatchPort *ports, uint16_t ports_cnt, uint16_t port)
+{
+    for (uint16_t idx = 0; idx < ports_cnt; idx++) {
+        /* array is sorted, so we can stop early */
+        if (port < ports[idx].port)
+            return 0;
+        if (port <= ports[idx].port2)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief Build a direct port to rule group lookup table from a port
+ *        group list
+ *
+ * \param list final port group list with the rule groups set
+ *
+ * \retval map the lookup table or NULL if the list is empty, too
+ *             large or on memory allocation failure. The caller
+ *             falls back to the list lookup in that case.
+ */
+DetectPortGroupMap *DetectPortGroupMapBuild(const DetectPort *list)
+{
+    uint32_t cnt = 0;
+    for (const DetectPort *dp = list; dp != NULL; dp = dp->next) {
+        cnt++;
+    }
+    /* index 0 is reserved for 'no group' */
+    if (cnt == 0 || cnt >= UINT16_MAX)
+        return NULL;
+
+    DetectPortGroupMap *map = SCCalloc(1, sizeof(*map));
+    if (map == NULL)
+        return NULL;
+    map->sghs = SCCalloc(cnt + 1, sizeof(map->sghs[0]));
+    if (map->sghs == NULL) {
+        SCFree(map);
+        return NULL;
+    }
+    map->sghs_cnt = cnt + 1;
+
+    uint16_t idx = 1;
+    for (const DetectPort *dp = list; dp != NULL; dp = dp->next) {
+        map->sghs[idx] = dp->sh;
+        for (uint32_t port = dp->port; port <= dp->port2; port++) {
+            /* first match wins, as with DetectPortLookupGroup */
+            if (map->map[port] == 0)
+                map->map[port] = idx;
+        }
+        idx++;
+    }
+    return map;
+}
+
+void DetectPortGroupMapFree(DetectPortGroupMap *map)
+{
+    if (map == NULL)
+        return;
+    SCFree(map->sghs);
+    SCFree(map);
+}
+
 /**
  * \brief Checks if two port group lists are equal.
  *
@@ -1846,6 +1959,66 @@ static int PortTestFunctions07(void)
     PASS;
 }
 
+/**
+ * \test Test the port match array against the list lookup
+ */
+static int PortTestFunctions08(void)
+{
+    DetectPort *dd = NULL;
+    FAIL_IF_NOT(DetectPortParse(NULL, &dd, "[1:80,![2,4],443,8000:8080]") == 0);
+
+    uint16_t cnt = 0;
+    DetectMatchPort *ports = DetectPortBuildMatchArray(dd, &cnt);
+    FAIL_IF_NULL(ports);
+    FAIL_IF_NOT(cnt == 5);
+
+    for (uint32_t port = 0; port <= UINT16_MAX; port++) {
+        const bool list = DetectPortLookupGroup(dd, (uint16_t)port) != NULL;
+        const bool array = DetectPortMatchArray(ports, cnt, (uint16_t)port) == 1;
+        FAIL_IF_NOT(list == array);
+    }
+    FAIL_IF_NOT(DetectPortMatchArray(ports, cnt, 3) == 1);
+    FAIL_IF_NOT(DetectPortMatchArray(ports, cnt, 4) == 0);
+    FAIL_IF_NOT(DetectPortMatchArray(ports, cnt, 8080) == 1);
+    FAIL_IF_NOT(DetectPortMatchArray(ports, cnt, 8081) == 0);
+
+    SCFree(ports);
+    DetectPortCleanupList(NULL, dd);
+    PASS;
+}
+
+/**
+ * \test Test the port group map against the list lookup
+ */
+static int PortTestFunctions09(void)
+{
+    DetectPort *dd = NULL;
+    FAIL_IF_NOT(DetectPortParse(NULL, &dd, "[21,80:90,443,1024:65535]") == 0);
+
+    /* fake rule groups, only used as pointer values */
+    uintptr_t cnt = 1;
+    for (DetectPort *dp = dd; dp != NULL; dp = dp->next) {
+        dp->sh = (SigGroupHead *)cnt++;
+        dp->flags |= PORT_SIGGROUPHEAD_COPY;
+    }
+
+    DetectPortGroupMap *map = DetectPortGroupMapBuild(dd);
+    FAIL_IF_NULL(map);
+    FAIL_IF_NOT(map->sghs_cnt == 5);
+
+    for (uint32_t port = 0; port <= UINT16_MAX; port++) {
+        const DetectPort *dp = DetectPortLookupGroup(dd, (uint16_t)port);
+        const SigGroupHead *sgh = DetectPortGroupMapLookup(map, (uint16_t)port);
+        FAIL_IF_NOT(sgh == (dp ? dp->sh : NULL));
+    }
+    FAIL_IF_NOT(DetectPortGroupMapLookup(map, 22) == NULL);
+    FAIL_IF_NOT(DetectPortGroupMapLookup(map, 85) == (SigGroupHead *)2);
+
+    DetectPortGroupMapFree(map);
+    DetectPortCleanupList(NULL, dd);
+    PASS;
+}
+
 /**
  * \test Test packet Matches
  * \param raw_eth_pkt pointer to the ethernet packet
@@ -2235,6 +2408,8 @@ void DetectPortTests(void)
     UtRegisterTest("PortTestFunctions03", PortTestFunctions03);
     UtRegisterTest("PortTestFunctions04", PortTestFunctions04);
     UtRegisterTest("PortTestFunctions07", PortTestFunctions07);
+    UtRegisterTest("PortTestFunctions08", PortTestFunctions08);
+    UtRegisterTest("PortTestFunctions09", PortTestFunctions09);
     UtRegisterTest("PortTestMatchReal01", PortTestMatchReal01);
     UtRegisterTest("PortTestMatchReal02", PortTestMatchReal02);
     UtRegisterTest("PortTestMatchReal03", PortTestMatchReal03);
@@ -49,6 +49,18 @@ int DetectPortInsert(DetectEngineCtx *,DetectPort **, DetectPort *);
 void DetectPortCleanupList (const DetectEngineCtx *de_ctx, DetectPort *head);
 
 DetectPort *DetectPortLookupGroup(DetectPort *dp, uint16_t port);
+DetectMatchPort *DetectPortBuildMatchArray(const DetectPort *head, uint16_t *cnt);
+int DetectPortMatchArray(const DetectMatchPort *ports, uint16_t ports_cnt, uint16_t port);
+
+DetectPortGroupMap *DetectPortGroupMapBuild(const DetectPort *list);
+void DetectPortGroupMapFree(DetectPortGroupMap *map);
+
+/** \brief get the rule group for a port from a DetectPortGroupMap */
+static inline struct SigGroupHead_ *DetectPortGroupMapLookup(
+        const DetectPortGroupMap *map, const uint16_t port)
+{
+    return map->sghs[map->map[port]];
+}
 
 bool DetectPortListsAreEqual(DetectPort *list1, DetectPort *list2);
 
@@ -59,6 +59,7 @@
 #include "util-profiling.h"
 #include "util-validate.h"
 #include "util-hash-string.h"
+#include "util-hash-lookup3.h"
 
 static int PrefilterStoreGetId(DetectEngineCtx *de_ctx,
         const char *name, void (*FreeFunc)(void *));
@@ -560,13 +561,6 @@ struct PrefilterNonPFDataTx {
     uint32_t array[];
 };
 
-/** \internal
- *  \brief wrapper for use in APIs */
-static void PrefilterNonPFDataFree(void *data)
-{
-    SCFree(data);
-}
-
 static void PrefilterTxNonPF(DetectEngineThreadCtx *det_ctx, const void *pectx, Packet *p, Flow *f,
         void *tx, const uint64_t tx_id, const AppLayerTxData *tx_data, const uint8_t flags)
 {
@@ -695,6 +689,89 @@ static void NonPFNamesFree(void *data)
     SCFree(data);
 }
 
+/* store for the non-prefilter sid lists
+ *
+ * Many rule groups end up with the exact same list of non-prefilter rules,
+ * e.g. the groups for the various port ranges of a protocol. The lists are
+ * kept in a per detect engine hash so that each unique list is only stored
+ * once. The store owns the data, so the engines are registered without a
+ * free function. */
+
+typedef struct PrefilterNonPFStoreEntry_ {
+    int type;     /**< engine type the data is for: pkt, frame, tx */
+    uint32_t len; /**< size of `data` in bytes */
+    void *data;
+} PrefilterNonPFStoreEntry;
+
+enum PrefilterNonPFStoreType {
+    NONPF_STORE_PKT = 0,
+    NONPF_STORE_PKT_FLOW_START,
+    NONPF_STORE_FRAME,
+    NONPF_STORE_TX,
+};
+
+static uint32_t NonPFStoreHash(HashListTable *h, void *data, uint16_t _len)
+{
+    const PrefilterNonPFStoreEntry *e = data;
+    return hashlittle_safe(e->data, e->len, (uint32_t)e->type) % h->array_size;
+}
+
+static char NonPFStoreCompare(void *data1, uint16_t _len1, void *data2, uint16_t _len2)
+{
+    const PrefilterNonPFStoreEntry *e1 = data1;
+    const PrefilterNonPFStoreEntry *e2 = data2;
+    return e1->type == e2->type && e1->len == e2->len && memcmp(e1->data, e2->data, e1->len) == 0;
+}
+
+static void NonPFStoreFree(void *data)
+{
+    PrefilterNonPFStoreEntry *e = data;
+    SCFree(e->data);
+    SCFree(e);
+}
+
+/** \internal
+ *  \brief get the shared copy of a non-prefilter sid list
+ *
+ *  Takes ownership of `data`: if an identical list is already in the store
+ *  `data` is freed and the stored copy is returned.
+ *
+ *  \retval ptr shared data owned by the store
+ *  \retval NULL on error, `data` is freed
+ */
+static void *NonPFStoreGet(
+        DetectEngineCtx *de_ctx, const enum PrefilterNonPFStoreType type, void *data, uint32_t len)
+{
+    if (de_ctx->non_pf_store == NULL) {
+        de_ctx->non_pf_store =
+                HashListTableInit(4096, NonPFStoreHash, NonPFStoreCompare, NonPFStoreFree);
+        if (de_ctx->non_pf_store == NULL) {
+            SCFree(data);
+            return NULL;
+        }
+    }
+
+    PrefilterNonPFStoreEntry lookup = { .type = type, .len = len, .data = data };
+    PrefilterNonPFStoreEntry *e = HashListTableLookup(de_ctx->non_pf_store, &lookup, 0);
+    if (e != NULL) {
+        SCLogDebug("reusing non-pf data %p (%u bytes)", e->data, len);
+        SCFree(data);
+        return e->data;
+    }
+
+    e = SCCalloc(1, sizeof(*e));
+    if (e == NULL) {
+        SCFree(data);
+        return NULL;
+    }
+    *e = lookup;
+    if (HashListTableAdd(de_ctx->non_pf_store, e, 0) != 0) {
+        NonPFStoreFree(e);
+        return NULL;
+    }
+    return data;
+}
+
 /* helper funcs for assembling non-prefilter engines */
 
 struct TxNonPFData {
@@ -811,6 +888,23 @@ static int TxNonPFAddSig(DetectEngineCtx *de_ctx, HashListTable *tx_engines_hash
     return 0;
 }
 
+/** \internal
+ *  \brief build the (shared) engine data for a pkt or frame non-prefilter engine
+ *  \retval data store owned data or NULL on error */
+static struct PrefilterNonPFData *NonPFDataBuild(DetectEngineCtx *de_ctx,
+        const enum PrefilterNonPFStoreType type, const struct PrefilterNonPFDataSig *array,
+        const uint32_t array_size)
+{
+    const uint32_t data_len = (uint32_t)(sizeof(struct PrefilterNonPFData) +
+                                         array_size * sizeof(struct PrefilterNonPFDataSig));
+    struct PrefilterNonPFData *data = SCCalloc(1, data_len);
+    if (data == NULL)
+        return NULL;
+    data->size = array_size;
+    memcpy((uint8_t *)&data->array, array, array_size * sizeof(data->array[0]));
+    return NonPFStoreGet(de_ctx, type, data, data_len);
+}
+
 /** \internal
  *  \brief setup non-prefilter rules in special "non-prefilter" engines that are registered in the
  * prefilter logic.
@@ -1088,17 +1182,20 @@ static int SetupNonPrefilter(DetectEngineCtx *de_ctx, SigGroupHead *sgh)
             engine_progress = -1;
         }
 
-        struct PrefilterNonPFDataTx *data =
-                SCCalloc(1, sizeof(*data) + t->sigs_cnt * sizeof(data->array[0]));
+        const uint32_t data_len = (uint32_t)(sizeof(struct PrefilterNonPFDataTx) +
+                                             t->sigs_cnt * sizeof(uint32_t));
+        struct PrefilterNonPFDataTx *data = SCCalloc(1, data_len);
         if (data == NULL)
             goto error;
         data->size = t->sigs_cnt;
         for (uint32_t i = 0; i < t->sigs_cnt; i++) {
             data->array[i] = t->sigs[i].sid;
         }
+        data = NonPFStoreGet(de_ctx, NONPF_STORE_TX, data, data_len);
+        if (data == NULL)
+            goto error;
         if (PrefilterAppendTxEngine(de_ctx, sgh, PrefilterTxNonPF, t->alproto, engine_progress,
-                    (void *)data, PrefilterNonPFDataFree, t->engine_name) < 0) {
-            SCFree(data);
+                    (void *)data, NULL, t->engine_name) < 0) {
             goto error;
         }
     }
@@ -1107,50 +1204,39 @@ static int SetupNonPrefilter(DetectEngineCtx *de_ctx, SigGroupHead *sgh)
 
     if (pkt_non_pf_array_size) {
         struct PrefilterNonPFData *data =
-                SCCalloc(1, sizeof(*data) + pkt_non_pf_array_size * sizeof(data->array[0]));
+                NonPFDataBuild(de_ctx, NONPF_STORE_PKT, pkt_non_pf_array, pkt_non_pf_array_size);
         if (data == NULL)
             goto error;
-        data->size = pkt_non_pf_array_size;
-        memcpy((uint8_t *)&data->array, pkt_non_pf_array,
-                pkt_non_pf_array_size * sizeof(data->array[0]));
         enum SignatureHookPkt hook = SIGNATURE_HOOK_PKT_NOT_SET; // TODO review
         if (PrefilterAppendEngine(de_ctx, sgh, PrefilterPktNonPF, pkt_mask, hook, (void *)data,
-                    PrefilterNonPFDataFree, "packet:non_pf") < 0) {
-            SCFree(data);
+                    NULL, "packet:non_pf") < 0) {
             goto error;
         }
     }
     if (pkt_hook_flow_start_non_pf_array_size) {
-        struct PrefilterNonPFData *data = SCCalloc(
-                1, sizeof(*data) + pkt_hook_flow_start_non_pf_array_size * sizeof(data->array[0]));
+        struct PrefilterNonPFData *data =
+                NonPFDataBuild(de_ctx, NONPF_STORE_PKT_FLOW_START,
+                        pkt_hook_flow_start_non_pf_array, pkt_hook_flow_start_non_pf_array_size);
         if (data == NULL)
             goto error;
-        data->size = pkt_hook_flow_start_non_pf_array_size;
-        memcpy((uint8_t *)&data->array, pkt_hook_flow_start_non_pf_array,
-                pkt_hook_flow_start_non_pf_array_size * sizeof(data->array[0]));
         SCLogDebug("packet:flow_start:non_pf added with %u rules", data->size);
         enum SignatureHookPkt hook = SIGNATURE_HOOK_PKT_FLOW_START;
         if (PrefilterAppendEngine(de_ctx, sgh,
                     PrefilterPktNonPFHookFlowStart, // TODO no longer needed to have a dedicated
                                                     // callback
-                    pkt_hook_flow_start_mask, hook, (void *)data, PrefilterNonPFDataFree,
+                    pkt_hook_flow_start_mask, hook, (void *)data, NULL,
                     "packet:flow_start:non_pf") < 0) {
-            SCFree(data);
             goto error;
         }
     }
     if (frame_non_pf_array_size) {
         SCLogDebug("%u frame non-pf sigs", frame_non_pf_array_size);
-        struct PrefilterNonPFData *data =
-                SCCalloc(1, sizeof(*data) + frame_non_pf_array_size * sizeof(data->array[0]));
+        struct PrefilterNonPFData *data = NonPFDataBuild(
+                de_ctx, NONPF_STORE_FRAME, frame_non_pf_array, frame_non_pf_array_size);
         if (data == NULL)
             goto error;
-        data->size = frame_non_pf_array_size;
-        memcpy((uint8_t *)&data->array, frame_non_pf_array,
-                frame_non_pf_array_size * sizeof(data->array[0]));
         if (PrefilterAppendFrameEngine(de_ctx, sgh, PrefilterFrameNonPF, ALPROTO_UNKNOWN,
-                    FRAME_ANY_TYPE, (void *)data, PrefilterNonPFDataFree, "frame:non_pf") < 0) {
-            SCFree(data);
+                    FRAME_ANY_TYPE, (void *)data, NULL, "frame:non_pf") < 0) {
             goto error;
         }
     }
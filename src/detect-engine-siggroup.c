@@ -45,6 +45,7 @@
 
 #include "util-hash.h"
 #include "util-hashlist.h"
+#include "util-hash-lookup3.h"
 
 #include "util-error.h"
 #include "util-debug.h"
@@ -189,13 +190,13 @@ void SigGroupHeadFree(const DetectEngineCtx *de_ctx, SigGroupHead *sgh)
 static uint32_t SigGroupHeadHashFunc(HashListTable *ht, void *data, uint16_t datalen)
 {
     SigGroupHead *sgh = (SigGroupHead *)data;
-    uint32_t hash = 0;
-    uint32_t b = 0;
 
     SCLogDebug("hashing sgh %p", sgh);
 
-    for (b = 0; b < sgh->init->sig_size; b++)
-        hash += sgh->init->sig_array[b];
+    /* sig_array is 16 byte aligned and its size a multiple of 16, so
+     * we can hash it as u32's. A plain sum of the bytes would put all
+     * groups with the same number of rules in the same bucket. */
+    uint32_t hash = hashword((const uint32_t *)sgh->init->sig_array, sgh->init->sig_size / 4, 0);
 
     hash %= ht->array_size;
     SCLogDebug("hash %"PRIu32" (sig_size %"PRIu32")", hash, sgh->init->sig_size);
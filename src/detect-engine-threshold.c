@@ -55,9 +55,39 @@
 #include "util-hash.h"
 #include "util-thash.h"
 #include "util-hash-lookup3.h"
+#include "util-countmin.h"
+#include "util-timewheel.h"
+
+/** earliest expiry time of the entries in a hash row, 0 if the row is not
+ *  in the timing wheel */
+typedef struct ThresholdRow_ {
+    SC_ATOMIC_DECLARE(uint32_t, expire);
+} ThresholdRow;
+
+/** part of the threshold entries, selected by the hash of the entry. Each
+ *  shard has its own hash table and timing wheel, so inserts and expiry in
+ *  one shard don't contend with the others. */
+struct ThresholdShard {
+    THashTableContext *thash;
+    ThresholdRow *rows; /**< one for each hash row */
+    TimeWheel wheel;
+};
+
+/** approximate counters for a time epoch */
+struct ThresholdSketchGen {
+    CountMinSketch *cms;
+    SC_ATOMIC_DECLARE(uint32_t, epoch);
+};
 
 struct Thresholds {
-    THashTableContext *thash;
+    struct ThresholdShard *shards;
+    uint32_t nshards;
+
+    /** approximate counting of by_src thresholds */
+    bool approx;
+    uint32_t approx_epoch; /**< in seconds */
+    SCMutex approx_lock;
+    struct ThresholdSketchGen gen[2];
 } ctx;
 
 static int ThresholdsInit(struct Thresholds *t);
@@ -189,10 +219,73 @@ static bool ThresholdEntryExpire(void *data, const SCTime_t ts)
     return false;
 }
 
+/** \internal
+ *  \brief get the first second at which ThresholdEntryExpire is true */
+static uint32_t ThresholdEntryExpireTime(const ThresholdEntry *e)
+{
+    const uint64_t expire = (uint64_t)SCTIME_SECS(e->tv1) + e->seconds + 1;
+    return (uint32_t)MIN(expire, UINT32_MAX);
+}
+
+#define THRESHOLD_SHARDS_DEFAULT   16
+#define THRESHOLD_SHARDS_MAX       1024
+#define THRESHOLD_SHARD_ROWS_MIN   64
+#define THRESHOLD_APPROX_WIDTH     65536
+#define THRESHOLD_APPROX_DEPTH     4
+#define THRESHOLD_APPROX_EPOCH     60
+
+static int ThresholdsApproxInit(struct Thresholds *t)
+{
+    int enabled = 0;
+    if (SCConfGetBool("detect.thresholds.approximate.enabled", &enabled) != 1 || !enabled)
+        return 0;
+
+    intmax_t width = THRESHOLD_APPROX_WIDTH;
+    intmax_t depth = THRESHOLD_APPROX_DEPTH;
+    intmax_t epoch = THRESHOLD_APPROX_EPOCH;
+    (void)SCConfGetInt("detect.thresholds.approximate.width", &width);
+    (void)SCConfGetInt("detect.thresholds.approximate.depth", &depth);
+    (void)SCConfGetInt("detect.thresholds.approximate.epoch", &epoch);
+    if (width < 1024 || width > (1 << 24)) {
+        SCLogError("'detect.thresholds.approximate.width' value %" PRIiMAX
+                   " out of range. Valid range 1024-16777216.",
+                width);
+        return -1;
+    }
+    if (depth < 1 || depth > COUNTMIN_MAX_DEPTH) {
+        SCLogError("'detect.thresholds.approximate.depth' value %" PRIiMAX
+                   " out of range. Valid range 1-%d.",
+                depth, COUNTMIN_MAX_DEPTH);
+        return -1;
+    }
+    if (epoch < 1 || epoch > 86400) {
+        SCLogError("'detect.thresholds.approximate.epoch' value %" PRIiMAX
+                   " out of range. Valid range 1-86400.",
+                epoch);
+        return -1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        t->gen[i].cms = CountMinSketchInit((uint32_t)width, (uint32_t)depth);
+        if (t->gen[i].cms == NULL) {
+            SCLogError("failed to initialize approximate threshold counters");
+            return -1;
+        }
+        SC_ATOMIC_INIT(t->gen[i].epoch);
+    }
+    SCMutexInit(&t->approx_lock, NULL);
+    t->approx_epoch = (uint32_t)epoch;
+    t->approx = true;
+    SCLogConfig("thresholds: approximate by_src counting with %u x %u counters, epoch %us",
+            t->gen[0].cms->depth, t->gen[0].cms->width, t->approx_epoch);
+    return 0;
+}
+
 static int ThresholdsInit(struct Thresholds *t)
 {
     uint32_t hashsize = 16384;
     uint64_t memcap = 16 * 1024 * 1024;
+    uint32_t nshards = THRESHOLD_SHARDS_DEFAULT;
 
     const char *str;
     if (SCConfGet("detect.thresholds.memcap", &str) == 1) {
@@ -213,26 +306,139 @@ static int ThresholdsInit(struct Thresholds *t)
         hashsize = (uint32_t)value;
     }
 
-    t->thash = THashInit("thresholds", sizeof(ThresholdEntry), ThresholdEntrySet,
-            ThresholdEntryFree, ThresholdEntryHash, ThresholdEntryCompare, ThresholdEntryExpire,
-            NULL, 0, memcap, hashsize);
-    if (t->thash == NULL) {
-        SCLogError("failed to initialize thresholds hash table");
+    if ((SCConfGetInt("detect.thresholds.shards", &value)) == 1) {
+        if (value < 1 || value > THRESHOLD_SHARDS_MAX) {
+            SCLogError("'detect.thresholds.shards' value %" PRIiMAX
+                       " out of range. Valid range 1-%d.",
+                    value, THRESHOLD_SHARDS_MAX);
+            return -1;
+        }
+        nshards = (uint32_t)value;
+    }
+
+    t->shards = SCCalloc(nshards, sizeof(*t->shards));
+    if (t->shards == NULL) {
+        SCLogError("failed to initialize thresholds");
         return -1;
     }
-    return 0;
+    t->nshards = nshards;
+
+    /* hash size, memcap and prealloc are for all shards together */
+    const uint32_t rows = MAX(hashsize / nshards, THRESHOLD_SHARD_ROWS_MIN);
+    const uint32_t prealloc = THASH_DEFAULT_PREALLOC / nshards;
+    for (uint32_t i = 0; i < nshards; i++) {
+        struct ThresholdShard *shard = &t->shards[i];
+        TimeWheelInit(&shard->wheel);
+        shard->thash = THashInitWithPrealloc("thresholds", sizeof(ThresholdEntry),
+                ThresholdEntrySet, ThresholdEntryFree, ThresholdEntryHash, ThresholdEntryCompare,
+                ThresholdEntryExpire, NULL, 0, memcap / nshards, rows, prealloc);
+        if (shard->thash == NULL) {
+            SCLogError("failed to initialize thresholds hash table");
+            return -1;
+        }
+        shard->rows = SCCalloc(shard->thash->config.hash_size, sizeof(ThresholdRow));
+        if (shard->rows == NULL) {
+            SCLogError("failed to initialize thresholds hash table");
+            return -1;
+        }
+    }
+
+    return ThresholdsApproxInit(t);
 }
 
 static void ThresholdsDestroy(struct Thresholds *t)
 {
-    if (t->thash) {
-        THashShutdown(t->thash);
+    for (uint32_t i = 0; i < t->nshards; i++) {
+        struct ThresholdShard *shard = &t->shards[i];
+        if (shard->thash) {
+            THashShutdown(shard->thash);
+        }
+        SCFree(shard->rows);
+        TimeWheelFree(&shard->wheel);
+    }
+    SCFree(t->shards);
+
+    if (t->approx) {
+        CountMinSketchFree(t->gen[0].cms);
+        CountMinSketchFree(t->gen[1].cms);
+        SCMutexDestroy(&t->approx_lock);
+    }
+    memset(t, 0, sizeof(*t));
+}
+
+static inline struct ThresholdShard *ThresholdGetShard(struct Thresholds *t, ThresholdEntry *e)
+{
+    if (t->nshards == 1)
+        return &t->shards[0];
+    /* mix the hash again, the address part of it is not seeded */
+    const uint32_t hash = ThresholdEntryHash(0, e);
+    return &t->shards[hashword(&hash, 1, 0) % t->nshards];
+}
+
+/** \internal
+ *  \brief make sure \a row is in the timing wheel at or before \a expire */
+static void ThresholdScheduleRow(
+        struct ThresholdShard *shard, const uint32_t row, const uint32_t expire)
+{
+    while (1) {
+        uint32_t cur = SC_ATOMIC_GET(shard->rows[row].expire);
+        if (cur != 0 && cur <= expire)
+            return;
+        if (SC_ATOMIC_CAS(&shard->rows[row].expire, cur, expire)) {
+            if (TimeWheelAdd(&shard->wheel, row, expire) != 0) {
+                /* let the next new entry in the row try again */
+                uint32_t set = expire;
+                (void)SC_ATOMIC_CAS(&shard->rows[row].expire, set, 0);
+            }
+            return;
+        }
     }
 }
 
+struct ThresholdExpireCtx {
+    struct ThresholdShard *shard;
+    SCTime_t ts;
+    uint32_t cnt;
+};
+
+static void ThresholdRowNextExpire(void *data, void *arg)
+{
+    uint32_t *next = arg;
+    const uint32_t expire = ThresholdEntryExpireTime(data);
+    if (*next == 0 || expire < *next)
+        *next = expire;
+}
+
+/** \internal
+ *  \brief timing wheel callback: expire the entries of a row and put it
+ *         back in the wheel for the first remaining entry */
+static void ThresholdRowExpire(uint32_t row, uint32_t expire, void *arg)
+{
+    struct ThresholdExpireCtx *ectx = arg;
+    struct ThresholdShard *shard = ectx->shard;
+
+    /* if the row was scheduled again since, this item is stale. Otherwise
+     * take it out of the wheel, new entries will schedule it again */
+    uint32_t cur = expire;
+    if (!SC_ATOMIC_CAS(&shard->rows[row].expire, cur, 0))
+        return;
+
+    uint32_t next = 0;
+    ectx->cnt += THashExpireRow(shard->thash, row, ectx->ts, ThresholdRowNextExpire, &next);
+    if (next != 0)
+        ThresholdScheduleRow(shard, row, next);
+}
+
 uint32_t ThresholdsExpire(const SCTime_t ts)
 {
-    return THashExpire(ctx.thash, ts);
+    uint32_t cnt = 0;
+    for (uint32_t i = 0; i < ctx.nshards; i++) {
+        struct ThresholdExpireCtx ectx = { .shard = &ctx.shards[i], .ts = ts, .cnt = 0 };
+        (void)TimeWheelAdvance(
+                &ctx.shards[i].wheel, (uint32_t)SCTIME_SECS(ts), ThresholdRowExpire, &ectx);
+        cnt += ectx.cnt;
+    }
+    return cnt;
 }
 
 #define TC_ADDRESS 0
@@ -895,7 +1101,8 @@ static int ThresholdGetFromHash(const DetectEngineCtx *de_ctx, struct Thresholds
         }
     }
 
-    struct THashDataGetResult res = THashGetFromHash(tctx->thash, &lookup);
+    struct ThresholdShard *shard = ThresholdGetShard(tctx, &lookup);
+    struct THashDataGetResult res = THashGetFromHash(shard->thash, &lookup);
     if (res.data) {
         SCLogDebug("found %p, is_new %s", res.data, BOOL2STR(res.is_new));
         int r;
@@ -907,9 +1114,14 @@ static int ThresholdGetFromHash(const DetectEngineCtx *de_ctx, struct Thresholds
             // existing, check/update
             r = ThresholdCheckUpdate(de_ctx, td, te, p, s->id, s->gid, s->rev, pa);
         }
+        const uint32_t expire = ThresholdEntryExpireTime(te);
 
         (void)THashDecrUsecnt(res.data);
         THashDataUnlock(res.data);
+
+        /* not under the entry lock: the wheel expiry locks the row and
+         * then the entries */
+        ThresholdScheduleRow(shard, THashGetRow(shard->thash, &lookup), expire);
         return r;
     }
     return 0; // TODO error?
@@ -946,6 +1158,96 @@ static int ThresholdHandlePacketFlow(const DetectEngineCtx *de_ctx, Flow *f, Pac
     return ret;
 }
 
+/** \internal
+ *  \brief check if a by_src threshold can use the approximate counters
+ *
+ *  Only rules that count in a window that fits in a sketch epoch and that
+ *  don't keep other state than the count are supported.
+ */
+static inline bool ThresholdUseApprox(const struct Thresholds *t, const DetectThresholdData *td)
+{
+    if (!t->approx || td->seconds == 0 || td->seconds > t->approx_epoch)
+        return false;
+    switch (td->type) {
+        case TYPE_LIMIT:
+        case TYPE_THRESHOLD:
+        case TYPE_BOTH:
+        case TYPE_DETECTION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** \internal
+ *  \brief get the sketch for \a epoch, resetting it if it was last used for
+ *         an older epoch */
+static CountMinSketch *ThresholdApproxGetSketch(struct Thresholds *t, const uint32_t epoch)
+{
+    struct ThresholdSketchGen *gen = &t->gen[epoch & 1];
+    if (SC_ATOMIC_GET(gen->epoch) < epoch) {
+        SCMutexLock(&t->approx_lock);
+        if (SC_ATOMIC_GET(gen->epoch) < epoch) {
+            CountMinSketchReset(gen->cms);
+            SC_ATOMIC_SET(gen->epoch, epoch);
+        }
+        SCMutexUnlock(&t->approx_lock);
+    }
+    return gen->cms;
+}
+
+/** \internal
+ *  \brief by_src threshold using the count-min sketches
+ *
+ *  The count is kept per time window of \a td->seconds. A window can span
+ *  two sketch epochs, in which case the count of the previous epoch is
+ *  added. Counts are never too low, but can be too high for sources that
+ *  share counters with busy ones.
+ *
+ *  \retval 2 silent match (no alert but apply actions)
+ *  \retval 1 normal match
+ *  \retval 0 no match
+ */
+static int ThresholdApproxCheck(
+        struct Thresholds *t, const Packet *p, const Signature *s, const DetectThresholdData *td)
+{
+    /* fast track for count 1 threshold */
+    if (td->count == 1 && td->type == TYPE_THRESHOLD) {
+        return 1;
+    }
+
+    const uint32_t now = (uint32_t)SCTIME_SECS(p->ts);
+    const uint32_t window = now / td->seconds;
+    const uint32_t key[10] = { s->id, s->gid, s->rev, p->tenant_id, window,
+        p->src.addr_data32[0], p->src.addr_data32[1], p->src.addr_data32[2],
+        p->src.addr_data32[3], (uint32_t)p->src.family };
+    const uint32_t h1 = hashword(key, ARRAY_SIZE(key), 1);
+    const uint32_t h2 = hashword(key, ARRAY_SIZE(key), 2);
+
+    const uint32_t epoch = now / t->approx_epoch;
+    uint64_t cnt = CountMinSketchAdd(ThresholdApproxGetSketch(t, epoch), h1, h2);
+    /* window started in the previous epoch */
+    if ((window * td->seconds) / t->approx_epoch != epoch && epoch > 0) {
+        const struct ThresholdSketchGen *prev = &t->gen[(epoch - 1) & 1];
+        if (SC_ATOMIC_GET(prev->epoch) == epoch - 1)
+            cnt += CountMinSketchEstimate(prev->cms, h1, h2);
+    }
+
+    switch (td->type) {
+        case TYPE_LIMIT:
+            return cnt <= td->count ? 1 : 2;
+        case TYPE_THRESHOLD:
+            return (td->count == 0 || cnt % td->count == 0) ? 1 : 0;
+        case TYPE_BOTH:
+            if (cnt == td->count)
+                return 1;
+            return cnt > td->count ? 2 : 0;
+        case TYPE_DETECTION:
+            return cnt > td->count ? 1 : 0;
+    }
+    return 0;
+}
+
 /**
  * \brief Make the threshold logic for signatures
  *
@@ -970,6 +1272,8 @@ int PacketAlertThreshold(const DetectEngineCtx *de_ctx, DetectEngineThreadCtx *d
 
     if (td->type == TYPE_SUPPRESS) {
         ret = ThresholdHandlePacketSuppress(p,td,s->id,s->gid);
+    } else if (td->track == TRACK_SRC && ThresholdUseApprox(&ctx, td)) {
+        ret = ThresholdApproxCheck(&ctx, p, s, td);
     } else if (td->track == TRACK_SRC) {
         if (PacketIsIPv4(p) && (td->type == TYPE_LIMIT || td->type == TYPE_BOTH)) {
             int cache_ret = CheckCache(p, td->track, s->id, s->gid, s->rev);
@@ -1001,6 +1305,48 @@ int PacketAlertThreshold(const DetectEngineCtx *de_ctx, DetectEngineThreadCtx *d
     SCReturnInt(ret);
 }
 
+#ifdef UNITTESTS
+#include "conf-yaml-loader.h"
+#include "util-unittest.h"
+
+/** \test many shards share the prealloc instead of each taking the default */
+static int ThresholdsInitShardsTest01(void)
+{
+    const char *input = "%YAML 1.1\n"
+                        "---\n"
+                        "detect:\n"
+                        "  thresholds:\n"
+                        "    shards: 1024\n";
+
+    SCConfCreateContextBackup();
+    SCConfInit();
+    FAIL_IF(SCConfYamlLoadString(input, strlen(input)) != 0);
+
+    struct Thresholds t;
+    memset(&t, 0, sizeof(t));
+    FAIL_IF(ThresholdsInit(&t) != 0);
+    FAIL_IF_NOT(t.nshards == 1024);
+
+    uint32_t spares = 0;
+    for (uint32_t i = 0; i < t.nshards; i++) {
+        FAIL_IF_NULL(t.shards[i].thash);
+        FAIL_IF_NULL(t.shards[i].rows);
+        spares += t.shards[i].thash->spare_q.len;
+    }
+    FAIL_IF(spares > THASH_DEFAULT_PREALLOC);
+
+    ThresholdsDestroy(&t);
+    SCConfDeInit();
+    SCConfRestoreContextBackup();
+    PASS;
+}
+
+void ThresholdRegisterTests(void)
+{
+    UtRegisterTest("ThresholdsInitShardsTest01", ThresholdsInitShardsTest01);
+}
+#endif /* UNITTESTS */
+
 /**
  * @}
  */
@@ -43,4 +43,8 @@ void ThresholdCacheThreadFree(void);
 
 void FlowThresholdVarFree(void *ptr);
 
+#ifdef UNITTESTS
+void ThresholdRegisterTests(void);
+#endif
+
 #endif /* SURICATA_DETECT_ENGINE_THRESHOLD_H */
@@ -731,6 +731,11 @@ static void AppendAppInspectEngine(DetectEngineCtx *de_ctx,
         prepend = true;
         *head_is_mpm = true;
         new_engine->mpm = true;
+        /* the prefilter only skips data if the buffer has no transforms */
+        const DetectBufferType *bt = DetectEngineBufferTypeGetById(de_ctx, t->sm_list);
+        new_engine->mpm_incremental = bt != NULL && bt->mpm_incremental != ALPROTO_UNKNOWN &&
+                                      bt->mpm_incremental == t->alproto &&
+                                      t->sm_list == t->sm_list_base;
     }
 
     new_engine->alproto = t->alproto;
@@ -1265,6 +1270,24 @@ void DetectBufferTypeSupportsMpm(const char *name)
     SCLogDebug("%p %s -- %d supports mpm", exists, name, exists->id);
 }
 
+/** \brief the prefilter of the buffer for \a alproto only scans data it
+ *         didn't scan before
+ *
+ *  A pattern in data scanned earlier won't be found again, so rules using
+ *  this buffer for mpm keep their state until the buffer is complete. The
+ *  prefilter sets SIG_GROUP_HEAD_MPM_INCREMENTAL in the sgh's it actually
+ *  skips data in.
+ */
+void DetectBufferTypeSupportsIncrementalMpm(const char *name, AppProto alproto)
+{
+    BUG_ON(g_buffer_type_reg_closed);
+    DetectBufferTypeRegister(name);
+    DetectBufferType *exists = DetectBufferTypeLookupByName(name);
+    BUG_ON(!exists);
+    exists->mpm_incremental = alproto;
+    SCLogDebug("%p %s -- %d supports incremental mpm", exists, name, exists->id);
+}
+
 void DetectBufferTypeSupportsTransformations(const char *name)
 {
     BUG_ON(g_buffer_type_reg_closed);
@@ -1603,6 +1626,8 @@ static void DetectBufferTypeFreeDetectEngine(DetectEngineCtx *de_ctx)
             HashListTableFree(de_ctx->buffer_type_hash_name);
         if (de_ctx->buffer_type_hash_id)
             HashListTableFree(de_ctx->buffer_type_hash_id);
+        if (de_ctx->buffer_transforms_prefix)
+            SCFree(de_ctx->buffer_transforms_prefix);
 
         DetectEngineAppInspectionEngine *ilist = de_ctx->app_inspect_engines;
         while (ilist) {
@@ -1651,6 +1676,50 @@ void DetectBufferTypeCloseRegistration(void)
     g_buffer_type_reg_closed = 1;
 }
 
+/** \brief link buffer types to the buffer type with the same transforms
+ *         minus the last one
+ *
+ *  E.g. for 'http.uri; url_decode; to_lowercase;' that is the buffer type
+ *  of 'http.uri; url_decode;', if a rule uses it. At runtime, if that buffer
+ *  was already set up for the same data, its url_decode result is used as
+ *  the input of to_lowercase, instead of running url_decode again.
+ */
+int DetectEngineBufferTypeSetupTransformsPrefix(DetectEngineCtx *de_ctx)
+{
+    if (de_ctx->buffer_transforms_prefix != NULL)
+        SCFree(de_ctx->buffer_transforms_prefix);
+    de_ctx->buffer_transforms_prefix =
+            SCCalloc(de_ctx->buffer_type_id, sizeof(DetectBufferTransformsPrefix));
+    if (de_ctx->buffer_transforms_prefix == NULL)
+        return -1;
+
+    HashListTableBucket *b = HashListTableGetListHead(de_ctx->buffer_type_hash_id);
+    for (; b != NULL; b = HashListTableGetListNext(b)) {
+        const DetectBufferType *map = HashListTableGetListData(b);
+        if (map->transforms.cnt < 2 || map->packet || map->frame ||
+                DetectEngineBufferTypeSupportsMultiInstanceGetById(de_ctx, map->parent_id))
+            continue;
+
+        DetectBufferType lookup_map;
+        memset(&lookup_map, 0, sizeof(lookup_map));
+        strlcpy(lookup_map.name, map->name, sizeof(lookup_map.name));
+        lookup_map.transforms = map->transforms;
+        lookup_map.transforms.cnt--;
+        memset(&lookup_map.transforms.transforms[lookup_map.transforms.cnt], 0,
+                sizeof(TransformData));
+        memcpy(lookup_map.xform_id, map->xform_id,
+                lookup_map.transforms.cnt * sizeof(TransformIdData));
+
+        const DetectBufferType *res =
+                HashListTableLookup(de_ctx->buffer_type_hash_name, &lookup_map, 0);
+        if (res != NULL) {
+            SCLogDebug("buffer %s id %d uses the result of id %d", map->name, map->id, res->id);
+            de_ctx->buffer_transforms_prefix[map->id].list_id = res->id;
+        }
+    }
+    return 0;
+}
+
 int DetectEngineBufferTypeGetByIdTransforms(
         DetectEngineCtx *de_ctx, const int id, TransformData *transforms, int transform_cnt)
 {
@@ -2440,8 +2509,6 @@ retry:
         DetectEngineThreadCtxDeinit(NULL, old_det_ctx[i]);
     }
 
-    SRepReloadComplete();
-
     return 1;
 
  error:
@@ -2720,6 +2787,9 @@ void DetectEngineCtxFree(DetectEngineCtx *de_ctx)
     if (de_ctx->non_pf_engine_names) {
         HashTableFree(de_ctx->non_pf_engine_names);
     }
+    if (de_ctx->non_pf_store) {
+        HashListTableFree(de_ctx->non_pf_store);
+    }
     SCFree(de_ctx);
     //DetectAddressGroupPrintMemory();
     //DetectSigGroupPrintMemory();
@@ -3866,6 +3936,20 @@ DetectEngineCtx *DetectEngineReference(DetectEngineCtx *de_ctx)
     return de_ctx;
 }
 
+/** \brief run a callback for each active detect engine
+ *
+ *  The master lock is held while the callbacks run, so the engines
+ *  can't be moved to the free list. */
+void DetectEngineForEach(void (*Callback)(DetectEngineCtx *de_ctx, void *data), void *data)
+{
+    DetectEngineMasterCtx *master = &g_master_de_ctx;
+    SCMutexLock(&master->lock);
+    for (DetectEngineCtx *de_ctx = master->list; de_ctx != NULL; de_ctx = de_ctx->next) {
+        Callback(de_ctx, data);
+    }
+    SCMutexUnlock(&master->lock);
+}
+
 static bool DetectEngineMultiTenantEnabledWithLock(void)
 {
     DetectEngineMasterCtx *master = &g_master_de_ctx;
@@ -5297,6 +5381,87 @@ static int DetectEngineTest09(void)
     PASS;
 }
 
+#include "stream-tcp.h"
+#include "util-unittest-helper.h"
+
+/** \test buffer with transforms using the result of the buffer with all but
+ *        the last of its transforms */
+static int DetectEngineTest10(void)
+{
+    uint8_t buf[] = "GET /A+b HTTP/1.0\r\n"
+                    "Host: www.example.org\r\n\r\n";
+    TcpSession ssn;
+    ThreadVars th_v;
+    DetectEngineThreadCtx *det_ctx = NULL;
+    Flow f;
+
+    AppLayerParserThreadCtx *alp_tctx = AppLayerParserThreadCtxAlloc();
+    FAIL_IF_NULL(alp_tctx);
+
+    memset(&th_v, 0, sizeof(th_v));
+    StatsThreadInit(&th_v.stats);
+    memset(&f, 0, sizeof(f));
+    memset(&ssn, 0, sizeof(ssn));
+
+    Packet *p = UTHBuildPacket(NULL, 0, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+
+    FLOW_INITIALIZE(&f);
+    f.protoctx = (void *)&ssn;
+    f.proto = IPPROTO_TCP;
+    f.flags |= FLOW_IPV4;
+    p->flow = &f;
+    p->flowflags |= FLOW_PKT_TOSERVER | FLOW_PKT_ESTABLISHED;
+    p->flags |= PKT_HAS_FLOW | PKT_STREAM_EST;
+    f.alproto = ALPROTO_HTTP1;
+
+    StreamTcpInitConfig(true);
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    de_ctx->flags |= DE_QUIET;
+
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx, "alert http any any -> any any "
+                                               "(http.uri; url_decode; to_lowercase; "
+                                               "content:\"/a b\"; sid:1;)"));
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx, "alert http any any -> any any "
+                                               "(http.uri; url_decode; "
+                                               "content:\"/A b\"; sid:2;)"));
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx, "alert http any any -> any any "
+                                               "(http.uri; url_decode; to_lowercase; "
+                                               "content:\"/x\"; sid:3;)"));
+    SigGroupBuild(de_ctx);
+
+    /* the buffer of sid 1 and 3 uses the one of sid 2 */
+    uint32_t linked = 0;
+    for (uint32_t i = 0; i < de_ctx->buffer_type_id; i++) {
+        if (de_ctx->buffer_transforms_prefix[i].list_id != 0)
+            linked++;
+    }
+    FAIL_IF_NOT(linked == 1);
+
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+    FAIL_IF_NULL(det_ctx);
+
+    int r = AppLayerParserParse(
+            NULL, alp_tctx, &f, ALPROTO_HTTP1, STREAM_TOSERVER, buf, sizeof(buf) - 1);
+    FAIL_IF_NOT(r == 0);
+
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    FAIL_IF_NOT(PacketAlertCheck(p, 2));
+    FAIL_IF(PacketAlertCheck(p, 3));
+
+    UTHFreePackets(&p, 1);
+    FLOW_DESTROY(&f);
+    AppLayerParserThreadCtxFree(alp_tctx);
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    StreamTcpFreeConfig(true);
+    StatsThreadCleanup(&th_v.stats);
+    PASS;
+}
+
 #endif
 
 void DetectEngineRegisterTests(void)
@@ -5308,5 +5473,6 @@ void DetectEngineRegisterTests(void)
     UtRegisterTest("DetectEngineTest04", DetectEngineTest04);
     UtRegisterTest("DetectEngineTest08", DetectEngineTest08);
     UtRegisterTest("DetectEngineTest09", DetectEngineTest09);
+    UtRegisterTest("DetectEngineTest10", DetectEngineTest10);
 #endif
 }
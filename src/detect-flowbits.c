@@ -578,6 +578,9 @@ int DetectFlowbitsAnalyze(DetectEngineCtx *de_ctx)
     if (max_fb_id == 0)
         return 0;
 
+    /* size the per flow bitsets for the flowbits of these rules */
+    FlowBitSetMaxId(max_fb_id);
+
     struct FBAnalyzer fba = { .array = NULL, .array_size = 0 };
     const uint32_t array_size = max_fb_id + 1;
     struct FBAnalyze *array = SCCalloc(array_size, sizeof(struct FBAnalyze));
@@ -983,14 +986,11 @@ static void PrefilterFlowbitMatch(DetectEngineThreadCtx *det_ctx, Packet *p, con
         SCReturn;
     }
 
-    for (GenericVar *gv = p->flow->flowvar; gv != NULL; gv = gv->next) {
-        if (gv->type != DETECT_FLOWBITS)
-            continue;
-
+    for (uint32_t idx = 0; FlowBitGetNext(p->flow, &idx); idx++) {
         PrefilterFlowbit lookup;
         memset(&lookup, 0, sizeof(lookup));
-        lookup.id = gv->idx;
-        SCLogDebug("flowbit %u", gv->idx);
+        lookup.id = idx;
+        SCLogDebug("flowbit %u", idx);
 
         PrefilterFlowbit *b = PFB_RB_FIND(&ctx->fb_tree, &lookup);
         if (b == NULL) {
@@ -1002,7 +1002,7 @@ static void PrefilterFlowbitMatch(DetectEngineThreadCtx *det_ctx, Packet *p, con
 #ifdef DEBUG
             for (uint32_t x = 0; x < b->rule_id_cnt; x++) {
                 const Signature *s = det_ctx->de_ctx->sig_array[b->rule_id[x]];
-                SCLogDebug("flowbit %u -> sig %u", gv->idx, s->id);
+                SCLogDebug("flowbit %u -> sig %u", idx, s->id);
             }
 #endif
         }
@@ -1625,11 +1625,8 @@ static int FlowBitsTestSig06(void)
 
     gv = p->flow->flowvar;
     FAIL_IF_NULL(gv);
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_FLOWBITS && gv->idx == idx) {
-                result = 1;
-        }
-    }
+
+    result = FlowBitIsset(p->flow, idx);
     FAIL_IF_NOT(result);
 
     PacketFree(p);
@@ -1702,11 +1699,7 @@ static int FlowBitsTestSig07(void)
     gv = p->flow->flowvar;
     FAIL_IF_NULL(gv);
 
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_FLOWBITS && gv->idx == idx) {
-                result = 1;
-        }
-    }
+    result = FlowBitIsset(p->flow, idx);
     FAIL_IF(result);
 
     PacketFree(p);
@@ -1779,11 +1772,7 @@ static int FlowBitsTestSig08(void)
     gv = p->flow->flowvar;
     FAIL_IF_NULL(gv);
 
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_FLOWBITS && gv->idx == idx) {
-                result = 1;
-        }
-    }
+    result = FlowBitIsset(p->flow, idx);
     FAIL_IF(result);
 
     PacketFree(p);
@@ -110,6 +110,7 @@ void DetectHttpClientBodyRegister(void)
 
     DetectAppLayerMpmRegister("http_client_body", SIG_FLAG_TOSERVER, 2,
             PrefilterMpmHttpRequestBodyRegister, NULL, ALPROTO_HTTP1, HTP_REQUEST_PROGRESS_BODY);
+    DetectBufferTypeSupportsIncrementalMpm("http_client_body", ALPROTO_HTTP1);
 
     DetectAppLayerInspectEngineRegister("http_client_body", ALPROTO_HTTP2, SIG_FLAG_TOSERVER,
             HTTP2StateDataClient, DetectEngineInspectFiledata, NULL);
@@ -375,10 +376,33 @@ static void PrefilterTxHttpRequestBody(DetectEngineThreadCtx *det_ctx, const voi
     if (buffer == NULL)
         return;
 
-    if (buffer->inspect_len >= mpm_ctx->minlen) {
+    /* The buffer starts before the new data, so that the inspection window
+     * overlaps with the previous inspection. Without transforms the buffer
+     * maps to the body, so only rescan the part of the overlap a pattern
+     * can start in and still end in the new data. Offset and depth of the
+     * patterns are relative to the start of the scanned data, so the scan
+     * has to start at the buffer start if any pattern uses them. */
+    uint32_t skip = 0;
+    if (list_id == ctx->base_list_id && !(mpm_ctx->flags & MPMCTX_FLAGS_OFFSET_DEPTH)) {
+        HtpBody *body = GetRequestBody(txv);
+        /* a new engine hasn't scanned anything yet */
+        if (body->body_prefiltered_version != det_ctx->de_ctx->version) {
+            body->body_prefiltered = 0;
+            body->body_prefiltered_version = det_ctx->de_ctx->version;
+        }
+        const uint64_t overlap = mpm_ctx->maxlen > 0 ? mpm_ctx->maxlen - 1 : 0;
+        if (body->body_prefiltered > buffer->inspect_offset + overlap) {
+            skip = (uint32_t)MIN(body->body_prefiltered - overlap - buffer->inspect_offset,
+                    buffer->inspect_len);
+        }
+        body->body_prefiltered = buffer->inspect_offset + buffer->inspect_len;
+    }
+
+    const uint32_t data_len = buffer->inspect_len - skip;
+    if (data_len >= mpm_ctx->minlen) {
         (void)mpm_table[mpm_ctx->mpm_type].Search(
-                mpm_ctx, &det_ctx->mtc, &det_ctx->pmq, buffer->inspect, buffer->inspect_len);
-        PREFILTER_PROFILING_ADD_BYTES(det_ctx, buffer->inspect_len);
+                mpm_ctx, &det_ctx->mtc, &det_ctx->pmq, buffer->inspect + skip, data_len);
+        PREFILTER_PROFILING_ADD_BYTES(det_ctx, data_len);
     }
 }
 
@@ -393,6 +417,9 @@ static int PrefilterMpmHttpRequestBodyRegister(DetectEngineCtx *de_ctx, SigGroup
     SCLogDebug("list_id %d base_list_id %d", list_id, pectx->base_list_id);
     pectx->mpm_ctx = mpm_ctx;
     pectx->transforms = &mpm_reg->transforms;
+    /* see PrefilterTxHttpRequestBody for when data is skipped */
+    if (list_id == pectx->base_list_id && !(mpm_ctx->flags & MPMCTX_FLAGS_OFFSET_DEPTH))
+        sgh->flags |= SIG_GROUP_HEAD_MPM_INCREMENTAL;
 
     return PrefilterAppendTxEngine(de_ctx, sgh, PrefilterTxHttpRequestBody, mpm_reg->app_v2.alproto,
             mpm_reg->app_v2.tx_min_progress, pectx, PrefilterMpmHttpRequestBodyFree,
@@ -2133,6 +2133,12 @@ void SigFree(DetectEngineCtx *de_ctx, Signature *s)
     if (s->addr_dst_match6 != NULL) {
         SCFree(s->addr_dst_match6);
     }
+    if (s->port_src_match != NULL) {
+        SCFree(s->port_src_match);
+    }
+    if (s->port_dst_match != NULL) {
+        SCFree(s->port_dst_match);
+    }
     if (s->sig_str != NULL) {
         SCFree(s->sig_str);
     }
@@ -2357,6 +2363,24 @@ static void SigBuildAddressMatchArray(Signature *s)
             SigBuildAddressMatchArrayIPv6(s->init_data->dst->ipv6_head, &s->addr_dst_match6_cnt);
 }
 
+/**
+ *  \internal
+ *  \brief build port match arrays for cache efficient matching
+ *
+ *  Not needed for 'any' as the header inspection skips the port check then.
+ *
+ *  \param s the signature
+ */
+static void SigBuildPortMatchArray(Signature *s)
+{
+    if (!(s->flags & SIG_FLAG_SP_ANY)) {
+        s->port_src_match = DetectPortBuildMatchArray(s->sp, &s->port_src_match_cnt);
+    }
+    if (!(s->flags & SIG_FLAG_DP_ANY)) {
+        s->port_dst_match = DetectPortBuildMatchArray(s->dp, &s->port_dst_match_cnt);
+    }
+}
+
 static int SigMatchListLen(SigMatch *sm)
 {
     int len = 0;
@@ -2993,6 +3017,7 @@ static Signature *SigInitHelper(
         sig->init_data->init_flags & SIG_FLAG_INIT_PACKET ? "set" : "not set");
 
     SigBuildAddressMatchArray(sig);
+    SigBuildPortMatchArray(sig);
 
     /* run buffer type callbacks if any */
     for (uint32_t x = 0; x < DETECT_SM_LIST_MAX; x++) {
@@ -393,6 +393,8 @@ error:
 #include "util-hashlist.h"
 #include "packet.h"
 #include "action-globals.h"
+#include "conf.h"
+#include "conf-yaml-loader.h"
 
 /**
  * \test ThresholdTestParse01 is a test for a valid threshold options
@@ -1741,6 +1743,133 @@ static int DetectThresholdTestSig14(void)
     PASS;
 }
 
+/**
+ * \test DetectThresholdTestSig15 tests by_src limits with approximate
+ *       counting enabled.
+ */
+static int DetectThresholdTestSig15(void)
+{
+    static const char *conf_string = "%YAML 1.1\n"
+                                     "---\n"
+                                     "detect:\n"
+                                     "  thresholds:\n"
+                                     "    approximate:\n"
+                                     "      enabled: yes\n"
+                                     "      width: 1024\n"
+                                     "      epoch: 60\n";
+    ThreadVars th_v;
+    DetectEngineThreadCtx *det_ctx;
+    int alerts1 = 0;
+    int alerts2 = 0;
+
+    SCConfCreateContextBackup();
+    SCConfInit();
+    SCConfYamlLoadString(conf_string, strlen(conf_string));
+    ThresholdInit();
+
+    memset(&th_v, 0, sizeof(th_v));
+    StatsThreadInit(&th_v.stats);
+    Packet *p1 = UTHBuildPacketReal((uint8_t *)"A", 1, IPPROTO_TCP, "1.1.1.1", "2.2.2.2", 1024, 80);
+    Packet *p2 = UTHBuildPacketReal((uint8_t *)"A", 1, IPPROTO_TCP, "1.1.1.2", "2.2.2.2", 1024, 80);
+    FAIL_IF_NULL(p1);
+    FAIL_IF_NULL(p2);
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    de_ctx->flags |= DE_QUIET;
+
+    Signature *s = DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any 80 (msg:\"Threshold limit\"; "
+            "threshold: type limit, track by_src, count 2, seconds 60; sid:1;)");
+    FAIL_IF_NULL(s);
+
+    SigGroupBuild(de_ctx);
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+
+    for (int i = 0; i < 4; i++) {
+        SigMatchSignatures(&th_v, de_ctx, det_ctx, p1);
+        alerts1 += PacketAlertCheck(p1, 1);
+    }
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p2);
+    alerts2 += PacketAlertCheck(p2, 1);
+    FAIL_IF(alerts1 != 2);
+    FAIL_IF(alerts2 != 1);
+
+    TimeSetIncrementTime(70);
+    p1->ts = TimeGet();
+
+    /* the counts were not kept in the hash table */
+    FAIL_IF(ThresholdsExpire(TimeGet()) != 0);
+
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p1);
+    alerts1 += PacketAlertCheck(p1, 1);
+    FAIL_IF(alerts1 != 3);
+
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    UTHFreePackets(&p1, 1);
+    UTHFreePackets(&p2, 1);
+    ThresholdDestroy();
+    StatsThreadCleanup(&th_v.stats);
+    SCConfDeInit();
+    SCConfRestoreContextBackup();
+    PASS;
+}
+
+/**
+ * \test DetectThresholdTestSig16 tests that entries are expired through
+ *       the timing wheel once their window has passed.
+ */
+static int DetectThresholdTestSig16(void)
+{
+    ThreadVars th_v;
+    DetectEngineThreadCtx *det_ctx;
+
+    ThresholdInit();
+
+    memset(&th_v, 0, sizeof(th_v));
+    StatsThreadInit(&th_v.stats);
+    Packet *p1 = UTHBuildPacketReal((uint8_t *)"A", 1, IPPROTO_TCP, "1.1.1.1", "2.2.2.2", 1024, 80);
+    Packet *p2 = UTHBuildPacketReal((uint8_t *)"A", 1, IPPROTO_TCP, "1.1.1.2", "2.2.2.2", 1024, 80);
+    FAIL_IF_NULL(p1);
+    FAIL_IF_NULL(p2);
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    de_ctx->flags |= DE_QUIET;
+
+    Signature *s = DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any 80 (msg:\"Threshold\"; "
+            "threshold: type threshold, track by_src, count 2, seconds 10; sid:1;)");
+    FAIL_IF_NULL(s);
+    s = DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any 80 (msg:\"Threshold\"; "
+            "threshold: type threshold, track by_src, count 2, seconds 60; sid:2;)");
+    FAIL_IF_NULL(s);
+
+    SigGroupBuild(de_ctx);
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p1);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p2);
+
+    const SCTime_t start = TimeGet();
+    FAIL_IF(ThresholdsExpire(start) != 0);
+    /* sid 1 entries */
+    FAIL_IF(ThresholdsExpire(SCTIME_ADD_SECS(start, 12)) != 2);
+    FAIL_IF(ThresholdsExpire(SCTIME_ADD_SECS(start, 30)) != 0);
+    /* sid 2 entries */
+    FAIL_IF(ThresholdsExpire(SCTIME_ADD_SECS(start, 62)) != 2);
+
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    UTHFreePackets(&p1, 1);
+    UTHFreePackets(&p2, 1);
+    ThresholdDestroy();
+    StatsThreadCleanup(&th_v.stats);
+    PASS;
+}
+
 static void ThresholdRegisterTests(void)
 {
     UtRegisterTest("ThresholdTestParse01", ThresholdTestParse01);
@@ -1766,6 +1895,8 @@ static void ThresholdRegisterTests(void)
     UtRegisterTest("DetectThresholdTestSig12", DetectThresholdTestSig12);
     UtRegisterTest("DetectThresholdTestSig13", DetectThresholdTestSig13);
     UtRegisterTest("DetectThresholdTestSig14", DetectThresholdTestSig14);
+    UtRegisterTest("DetectThresholdTestSig15", DetectThresholdTestSig15);
+    UtRegisterTest("DetectThresholdTestSig16", DetectThresholdTestSig16);
 }
 #endif /* UNITTESTS */
 
@@ -301,24 +301,30 @@ const SigGroupHead *SigMatchSignaturesGetSgh(const DetectEngineCtx *de_ctx,
 
     int proto = PacketGetIPProto(p);
     if (proto == IPPROTO_TCP) {
-        DetectPort *list = de_ctx->flow_gh[dir].tcp;
-        SCLogDebug("tcp toserver %p, tcp toclient %p: going to use %p", de_ctx->flow_gh[1].tcp,
-                de_ctx->flow_gh[0].tcp, de_ctx->flow_gh[dir].tcp);
         const uint16_t port = dir ? p->dp : p->sp;
         SCLogDebug("tcp port %u -> %u:%u", port, p->sp, p->dp);
-        DetectPort *sghport = DetectPortLookupGroup(list, port);
-        if (sghport != NULL)
-            sgh = sghport->sh;
-        SCLogDebug("TCP list %p, port %u, direction %s, sghport %p, sgh %p", list, port,
-                dir ? "toserver" : "toclient", sghport, sgh);
+        const DetectPortGroupMap *map = de_ctx->flow_gh[dir].tcp_map;
+        if (likely(map != NULL)) {
+            sgh = DetectPortGroupMapLookup(map, port);
+        } else {
+            DetectPort *list = de_ctx->flow_gh[dir].tcp;
+            DetectPort *sghport = DetectPortLookupGroup(list, port);
+            if (sghport != NULL)
+                sgh = sghport->sh;
+        }
+        SCLogDebug("TCP port %u, direction %s, sgh %p", port, dir ? "toserver" : "toclient", sgh);
     } else if (proto == IPPROTO_UDP) {
-        DetectPort *list = de_ctx->flow_gh[dir].udp;
-        uint16_t port = dir ? p->dp : p->sp;
-        DetectPort *sghport = DetectPortLookupGroup(list, port);
-        if (sghport != NULL)
-            sgh = sghport->sh;
-        SCLogDebug("UDP list %p, port %u, direction %s, sghport %p, sgh %p", list, port,
-                dir ? "toserver" : "toclient", sghport, sgh);
+        const uint16_t port = dir ? p->dp : p->sp;
+        const DetectPortGroupMap *map = de_ctx->flow_gh[dir].udp_map;
+        if (likely(map != NULL)) {
+            sgh = DetectPortGroupMapLookup(map, port);
+        } else {
+            DetectPort *list = de_ctx->flow_gh[dir].udp;
+            DetectPort *sghport = DetectPortLookupGroup(list, port);
+            if (sghport != NULL)
+                sgh = sghport->sh;
+        }
+        SCLogDebug("UDP port %u, direction %s, sgh %p", port, dir ? "toserver" : "toclient", sgh);
     } else {
         sgh = de_ctx->flow_gh[dir].sgh[proto];
     }
@@ -542,8 +548,7 @@ static inline bool DetectRunInspectRuleHeader(const Packet *p, const Flow *f, co
         if (!(sflags & SIG_FLAG_DP_ANY)) {
             if (p->flags & PKT_IS_FRAGMENT)
                 return false;
-            const DetectPort *dport = DetectPortLookupGroup(s->dp, p->dp);
-            if (dport == NULL) {
+            if (DetectPortMatchArray(s->port_dst_match, s->port_dst_match_cnt, p->dp) == 0) {
                 SCLogDebug("dport didn't match.");
                 return false;
             }
@@ -551,8 +556,7 @@ static inline bool DetectRunInspectRuleHeader(const Packet *p, const Flow *f, co
         if (!(sflags & SIG_FLAG_SP_ANY)) {
             if (p->flags & PKT_IS_FRAGMENT)
                 return false;
-            const DetectPort *sport = DetectPortLookupGroup(s->sp, p->sp);
-            if (sport == NULL) {
+            if (DetectPortMatchArray(s->port_src_match, s->port_src_match_cnt, p->sp) == 0) {
                 SCLogDebug("sport didn't match.");
                 return false;
             }
@@ -1198,6 +1202,7 @@ static bool DetectRunTxInspectRule(ThreadVars *tv,
     bool retval = false;
     bool mpm_before_progress = false;   // is mpm engine before progress?
     bool mpm_in_progress = false;       // is mpm engine in a buffer we will revisit?
+    bool mpm_incremental = false;       // will mpm skip the data it already scanned?
 
     TRACE_SID_TXS(s->id, tx, "starting %s", direction ? "toclient" : "toserver");
 
@@ -1259,6 +1264,8 @@ static bool DetectRunTxInspectRule(ThreadVars *tv,
                             "mpm_in_progress",
                             tx->tx_progress, engine->progress);
                     mpm_in_progress = true;
+                    mpm_incremental = engine->mpm_incremental &&
+                                      (scratch->sgh->flags & SIG_GROUP_HEAD_MPM_INCREMENTAL);
                 }
             }
 
@@ -1379,10 +1386,11 @@ static bool DetectRunTxInspectRule(ThreadVars *tv,
                 DetectRunStoreStateTx(scratch->sgh, f, tx->tx_ptr, tx->tx_id, s,
                         inspect_flags, flow_flags, file_no_match);
             }
-        } else if ((inspect_flags & DE_STATE_FLAG_FULL_INSPECT) == 0 && mpm_in_progress) {
+        } else if ((inspect_flags & DE_STATE_FLAG_FULL_INSPECT) == 0 && mpm_in_progress &&
+                   !mpm_incremental) {
             TRACE_SID_TXS(s->id, tx, "no need to store no-match sig, "
                     "mpm will revisit it");
-        } else if (inspect_flags != 0 || file_no_match != 0) {
+        } else if (inspect_flags != 0 || file_no_match != 0 || mpm_incremental) {
             TRACE_SID_TXS(s->id, tx, "storing state: flags %08x", inspect_flags);
             DetectRunStoreStateTx(scratch->sgh, f, tx->tx_ptr, tx->tx_id, s,
                     inspect_flags, flow_flags, file_no_match);
@@ -196,6 +196,11 @@ typedef struct DetectMatchAddressIPv6_ {
     uint32_t ip2[4];
 } DetectMatchAddressIPv6;
 
+typedef struct DetectMatchPort_ {
+    uint16_t port;  /**< start of range */
+    uint16_t port2; /**< end of range */
+} DetectMatchPort;
+
 /*
  * DETECT PORT
  */
@@ -418,6 +423,9 @@ typedef struct DetectEngineAppInspectionEngine_ {
     uint8_t dir;
     uint8_t id;     /**< per sig id used in state keeping */
     bool mpm;
+    /** mpm only scans new data, so it won't revisit a no-match sig. Only
+     *  if the sgh has SIG_GROUP_HEAD_MPM_INCREMENTAL as well. */
+    bool mpm_incremental;
     bool stream;
     /** will match on a NULL buffer (so an absent buffer) */
     bool match_on_null;
@@ -456,6 +464,8 @@ typedef struct DetectBufferType_ {
     bool frame;  /**< is about Frame inspection */
     bool supports_transforms;
     bool multi_instance; /**< buffer supports multiple buffer instances per tx */
+    /** protocol for which the mpm doesn't rescan data it scanned before */
+    AppProto mpm_incremental;
     void (*SetupCallback)(const struct DetectEngineCtx_ *, struct Signature_ *);
     bool (*ValidateCallback)(
             const struct Signature_ *, const char **sigerror, const struct DetectBufferType_ *);
@@ -463,6 +473,12 @@ typedef struct DetectBufferType_ {
     TransformIdData xform_id[DETECT_TRANSFORMS_MAX];
 } DetectBufferType;
 
+/** buffer type with the same transforms as another one, except for the last
+ *  transform. Its result can be used as the input of that last transform. */
+typedef struct DetectBufferTransformsPrefix_ {
+    int list_id; /**< 0 if there is no such buffer type */
+} DetectBufferTransformsPrefix;
+
 struct DetectEnginePktInspectionEngine;
 
 /**
@@ -695,6 +711,10 @@ typedef struct Signature_ {
     uint16_t addr_dst_match6_cnt;
     uint16_t addr_src_match6_cnt;
 
+    /** port match arrays */
+    uint16_t port_dst_match_cnt;
+    uint16_t port_src_match_cnt;
+
     /** classification id **/
     uint16_t class_id;
 
@@ -709,6 +729,9 @@ typedef struct Signature_ {
     /** ipv6 match arrays */
     DetectMatchAddressIPv6 *addr_dst_match6;
     DetectMatchAddressIPv6 *addr_src_match6;
+    /** port match arrays */
+    DetectMatchPort *port_dst_match;
+    DetectMatchPort *port_src_match;
 
     uint32_t id;  /**< sid, set by the 'sid' rule keyword */
     uint32_t gid; /**< generator id */
@@ -859,9 +882,23 @@ typedef struct DetectEngineIPOnlyCtx_ {
     uint32_t sig_mapping_size;
 } DetectEngineIPOnlyCtx;
 
+/** \brief flattened port to rule group lookup table
+ *
+ *  Built from a final port group list so that the runtime lookup is
+ *  a direct index instead of a walk over the list. */
+typedef struct DetectPortGroupMap_ {
+    /** port -> index in `sghs`. 0 means no rule group for the port. */
+    uint16_t map[UINT16_MAX + 1];
+    uint32_t sghs_cnt;
+    struct SigGroupHead_ **sghs; /**< sghs[0] is always NULL */
+} DetectPortGroupMap;
+
 typedef struct DetectEngineLookupFlow_ {
     DetectPort *tcp;
     DetectPort *udp;
+    /* lookup tables created from the tcp and udp lists */
+    DetectPortGroupMap *tcp_map;
+    DetectPortGroupMap *udp_map;
     struct SigGroupHead_ *sgh[256];
 } DetectEngineLookupFlow;
 
@@ -1080,6 +1117,8 @@ typedef struct DetectEngineCtx_ {
     HashListTable *buffer_type_hash_name;
     HashListTable *buffer_type_hash_id;
     uint32_t buffer_type_id;
+    /** transforms prefix of each buffer type, indexed by buffer type id */
+    DetectBufferTransformsPrefix *buffer_transforms_prefix;
 
     uint32_t app_mpms_list_cnt;
     DetectBufferMpmRegistry *app_mpms_list;
@@ -1142,6 +1181,10 @@ typedef struct DetectEngineCtx_ {
      * part of the API, so hash is always used. */
     HashTable *non_pf_engine_names;
 
+    /* store for the sid lists of the non-prefilter engines. Identical
+     * lists are shared between rule groups. */
+    HashListTable *non_pf_store;
+
     const char *firewall_rule_file_exclusive;
 
     /* user provided rate filter callbacks. */
@@ -1410,6 +1453,8 @@ typedef struct DetectEngineThreadCtx_ {
     uint64_t prefilter_bytes;
     /** number of times we inspected a buffer */
     uint64_t prefilter_bytes_called;
+    /** rule id array size before the current prefilter callback call */
+    uint32_t prefilter_rule_id_cnt;
 #endif
 } DetectEngineThreadCtx;
 
@@ -1489,7 +1534,8 @@ enum {
 #define SIG_GROUP_HEAD_HAVEFILEMAGIC BIT_U16(1)
 #endif
 #define SIG_GROUP_HEAD_HAVEFILEMD5    BIT_U16(2)
-// vacancy
+/** an incremental mpm skips data it scanned before */
+#define SIG_GROUP_HEAD_MPM_INCREMENTAL BIT_U16(3)
 #define SIG_GROUP_HEAD_HAVEFILESHA1   BIT_U16(4)
 #define SIG_GROUP_HEAD_HAVEFILESHA256 BIT_U16(5)
 
@@ -20,11 +20,10 @@
  *
  * \author Victor Julien <victor@inliniac.net>
  *
- * Implements per flow bits. Actually, not a bit,
- * but called that way because of Snort's flowbits.
- * It's a binary storage.
+ * Implements per flow bits. The bits of a flow are stored in a bitset
+ * indexed by the variable name idx, sized for the highest flowbit idx of
+ * the loaded rules.
  *
- * \todo move away from a linked list implementation
  * \todo use different datatypes, such as string, int, etc.
  * \todo have more than one instance of the same var, and be able to match on a
  *       specific one, or one all at a time. So if a certain capture matches
@@ -42,49 +41,63 @@
 #include "util-debug.h"
 #include "util-unittest.h"
 
-/* get the flowbit with idx from the flow */
-static FlowBit *FlowBitGet(Flow *f, uint32_t idx)
+/** highest flowbit idx used by the loaded rules */
+static SC_ATOMIC_DECLARE(uint32_t, flowbit_max_id);
+
+/** \brief set the highest flowbit idx in use, called at rule load
+ *
+ *  New bitsets are sized for this, so they don't have to grow when the
+ *  flow sets more bits. */
+void FlowBitSetMaxId(uint32_t idx)
 {
-    GenericVar *gv = f->flowvar;
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_FLOWBITS && gv->idx == idx) {
-            return (FlowBit *)gv;
-        }
+    while (1) {
+        uint32_t cur = SC_ATOMIC_GET(flowbit_max_id);
+        if (idx <= cur || SC_ATOMIC_CAS(&flowbit_max_id, cur, idx))
+            break;
     }
+}
 
+/* get the flowbits of the flow */
+static inline FlowBit *FlowBitGet(const Flow *f)
+{
+    GenericVar *gv = f->flowvar;
+    if (gv != NULL && gv->type == DETECT_FLOWBITS)
+        return (FlowBit *)gv;
     return NULL;
 }
 
-/** \brief add a flowbit to the flow
- *  \retval -1 error
- *  \retval 0 not added, already set before
- *  \retval 1 added */
-static int FlowBitAdd(Flow *f, uint32_t idx)
+/** \brief get the flowbits of the flow, set up or grown to hold \a idx
+ *  \retval fb flowbits or NULL on error */
+static FlowBit *FlowBitGetForIdx(Flow *f, uint32_t idx)
 {
-    FlowBit *fb = FlowBitGet(f, idx);
+    FlowBit *fb = FlowBitGet(f);
+    if (fb != NULL && idx / 64 < fb->size)
+        return fb;
+
+    const uint32_t max_id = MAX(idx, SC_ATOMIC_GET(flowbit_max_id));
+    const uint32_t size = max_id / 64 + 1;
     if (fb == NULL) {
-        fb = SCMalloc(sizeof(FlowBit));
+        fb = SCCalloc(1, sizeof(FlowBit) + size * sizeof(uint64_t));
         if (unlikely(fb == NULL))
-            return -1;
-
+            return NULL;
         fb->type = DETECT_FLOWBITS;
-        fb->idx = idx;
-        fb->next = NULL;
-        GenericVarAppend(&f->flowvar, (GenericVar *)fb);
-        return 1;
+        fb->next = f->flowvar;
     } else {
-        return 0;
+        /* idx registered after the bitset was created */
+        FlowBit *nfb = SCRealloc(fb, sizeof(FlowBit) + size * sizeof(uint64_t));
+        if (unlikely(nfb == NULL))
+            return NULL;
+        fb = nfb;
+        memset(&fb->bits[fb->size], 0, (size - fb->size) * sizeof(uint64_t));
     }
+    fb->size = size;
+    f->flowvar = (GenericVar *)fb;
+    return fb;
 }
 
-static void FlowBitRemove(Flow *f, uint32_t idx)
+static inline bool FlowBitTest(const FlowBit *fb, uint32_t idx)
 {
-    FlowBit *fb = FlowBitGet(f, idx);
-    if (fb == NULL)
-        return;
-
-    GenericVarRemove(&f->flowvar, (GenericVar *)fb);
-    FlowBitFree(fb);
+    return fb != NULL && idx / 64 < fb->size && (fb->bits[idx / 64] & BIT_U64(idx % 64));
 }
 
 /** \brief add a flowbit to the flow
@@ -93,12 +106,29 @@ static void FlowBitRemove(Flow *f, uint32_t idx)
  *  \retval 1 added */
 int FlowBitSet(Flow *f, uint32_t idx)
 {
-    return FlowBitAdd(f, idx);
+    FlowBit *fb = FlowBitGetForIdx(f, idx);
+    if (fb == NULL)
+        return -1;
+    if (fb->bits[idx / 64] & BIT_U64(idx % 64))
+        return 0;
+    fb->bits[idx / 64] |= BIT_U64(idx % 64);
+    fb->cnt++;
+    return 1;
 }
 
 void FlowBitUnset(Flow *f, uint32_t idx)
 {
-    FlowBitRemove(f, idx);
+    FlowBit *fb = FlowBitGet(f);
+    if (!FlowBitTest(fb, idx))
+        return;
+
+    fb->bits[idx / 64] &= ~BIT_U64(idx % 64);
+    if (--fb->cnt == 0) {
+        /* no flowbits left: remove the bitset so the flow
+         * doesn't appear to have vars */
+        f->flowvar = fb->next;
+        FlowBitFree(fb);
+    }
 }
 
 /**
@@ -106,38 +136,50 @@ void FlowBitUnset(Flow *f, uint32_t idx)
  */
 bool FlowBitToggle(Flow *f, uint32_t idx)
 {
-    FlowBit *fb = FlowBitGet(f, idx);
-    if (fb != NULL) {
-        FlowBitRemove(f, idx);
+    if (FlowBitTest(FlowBitGet(f), idx)) {
+        FlowBitUnset(f, idx);
         return false;
     } else {
-        FlowBitAdd(f, idx);
+        FlowBitSet(f, idx);
         return true;
     }
 }
 
-int FlowBitIsset(Flow *f, uint32_t idx)
+int FlowBitIsset(const Flow *f, uint32_t idx)
 {
-    int r = 0;
-
-    FlowBit *fb = FlowBitGet(f, idx);
-    if (fb != NULL) {
-        r = 1;
-    }
+    return FlowBitTest(FlowBitGet(f), idx) ? 1 : 0;
+}
 
-    return r;
+int FlowBitIsnotset(const Flow *f, uint32_t idx)
+{
+    return FlowBitTest(FlowBitGet(f), idx) ? 0 : 1;
 }
 
-int FlowBitIsnotset(Flow *f, uint32_t idx)
+/** \brief get the next flowbit that is set
+ *
+ *  Iterate all flowbits of a flow with:
+ *  for (uint32_t idx = 0; FlowBitGetNext(f, &idx); idx++)
+ *
+ *  \param idx in: the first idx to consider, out: the idx that is set
+ *  \retval bool true if a set flowbit was found
+ */
+bool FlowBitGetNext(const Flow *f, uint32_t *idx)
 {
-    int r = 0;
+    const FlowBit *fb = FlowBitGet(f);
+    if (fb == NULL)
+        return false;
 
-    FlowBit *fb = FlowBitGet(f, idx);
-    if (fb == NULL) {
-        r = 1;
+    uint32_t word = *idx / 64;
+    if (word >= fb->size)
+        return false;
+    uint64_t bits = fb->bits[word] & (UINT64_MAX << (*idx % 64));
+    while (bits == 0) {
+        if (++word >= fb->size)
+            return false;
+        bits = fb->bits[word];
     }
-
-    return r;
+    *idx = word * 64 + (uint32_t)__builtin_ctzll(bits);
+    return true;
 }
 
 void FlowBitFree(FlowBit *fb)
@@ -151,15 +193,16 @@ void FlowBitFree(FlowBit *fb)
 
 /* TESTS */
 #ifdef UNITTESTS
+#include "flow-var.h"
+
 static int FlowBitTest01 (void)
 {
     Flow f;
     memset(&f, 0, sizeof(Flow));
 
-    FlowBitAdd(&f, 0);
-
-    FlowBit *fb = FlowBitGet(&f, 0);
-    FAIL_IF_NULL(fb);
+    FAIL_IF_NOT(FlowBitSet(&f, 0) == 1);
+    FAIL_IF_NOT(FlowBitIsset(&f, 0));
+    FAIL_IF_NOT(FlowBitSet(&f, 0) == 0);
 
     SCGenericVarFree(f.flowvar);
     PASS;
@@ -170,10 +213,10 @@ static int FlowBitTest02 (void)
     Flow f;
     memset(&f, 0, sizeof(Flow));
 
-    FlowBit *fb = FlowBitGet(&f, 0);
-    FAIL_IF_NOT_NULL(fb);
+    FAIL_IF(FlowBitIsset(&f, 0));
+    FAIL_IF_NOT(FlowBitIsnotset(&f, 0));
+    FAIL_IF_NOT_NULL(f.flowvar);
 
-    SCGenericVarFree(f.flowvar);
     PASS;
 }
 
@@ -182,17 +225,14 @@ static int FlowBitTest03 (void)
     Flow f;
     memset(&f, 0, sizeof(Flow));
 
-    FlowBitAdd(&f, 0);
-
-    FlowBit *fb = FlowBitGet(&f,0);
-    FAIL_IF_NULL(fb);
-
-    FlowBitRemove(&f, 0);
+    FlowBitSet(&f, 0);
+    FAIL_IF_NOT(FlowBitIsset(&f, 0));
 
-    fb = FlowBitGet(&f, 0);
-    FAIL_IF_NOT_NULL(fb);
+    FlowBitUnset(&f, 0);
+    FAIL_IF(FlowBitIsset(&f, 0));
+    /* bitset is removed with the last bit */
+    FAIL_IF_NOT_NULL(f.flowvar);
 
-    SCGenericVarFree(f.flowvar);
     PASS;
 }
 
@@ -201,13 +241,15 @@ static int FlowBitTest04 (void)
     Flow f;
     memset(&f, 0, sizeof(Flow));
 
-    FlowBitAdd(&f, 0);
-    FlowBitAdd(&f, 1);
-    FlowBitAdd(&f, 2);
-    FlowBitAdd(&f, 3);
+    FlowBitSet(&f, 0);
+    FlowBitSet(&f, 1);
+    FlowBitSet(&f, 2);
+    FlowBitSet(&f, 3);
 
-    FlowBit *fb = FlowBitGet(&f, 0);
-    FAIL_IF_NULL(fb);
+    for (uint32_t i = 0; i < 4; i++) {
+        FAIL_IF_NOT(FlowBitIsset(&f, i));
+    }
+    FAIL_IF(FlowBitIsset(&f, 4));
 
     SCGenericVarFree(f.flowvar);
     PASS;
@@ -218,135 +260,88 @@ static int FlowBitTest05 (void)
     Flow f;
     memset(&f, 0, sizeof(Flow));
 
-    FlowBitAdd(&f, 0);
-    FlowBitAdd(&f, 1);
-    FlowBitAdd(&f, 2);
-    FlowBitAdd(&f, 3);
+    FlowBitSet(&f, 0);
+    FlowBitSet(&f, 1);
+    FlowBitSet(&f, 2);
+    FlowBitSet(&f, 3);
 
-    FlowBit *fb = FlowBitGet(&f, 1);
-    FAIL_IF_NULL(fb);
+    for (uint32_t i = 0; i < 4; i++) {
+        FlowBitUnset(&f, i);
+        FAIL_IF(FlowBitIsset(&f, i));
+        for (uint32_t j = i + 1; j < 4; j++) {
+            FAIL_IF_NOT(FlowBitIsset(&f, j));
+        }
+    }
+    FAIL_IF_NOT_NULL(f.flowvar);
 
-    SCGenericVarFree(f.flowvar);
     PASS;
 }
 
+/** \test bitset grows for an idx past its size, order of the var list is kept */
 static int FlowBitTest06 (void)
 {
     Flow f;
     memset(&f, 0, sizeof(Flow));
 
-    FlowBitAdd(&f, 0);
-    FlowBitAdd(&f, 1);
-    FlowBitAdd(&f, 2);
-    FlowBitAdd(&f, 3);
+    FlowVarAddInt(&f, 1, 10);
+    GenericVar *fv = f.flowvar;
 
-    FlowBit *fb = FlowBitGet(&f, 2);
-    FAIL_IF_NULL(fb);
+    FAIL_IF_NOT(FlowBitSet(&f, 3) == 1);
+    FAIL_IF_NULL(f.flowvar);
+    FAIL_IF_NOT(f.flowvar->type == DETECT_FLOWBITS);
+    FAIL_IF_NOT(f.flowvar->next == fv);
 
-    SCGenericVarFree(f.flowvar);
-    PASS;
-}
-
-static int FlowBitTest07 (void)
-{
-    Flow f;
-    memset(&f, 0, sizeof(Flow));
-
-    FlowBitAdd(&f, 0);
-    FlowBitAdd(&f, 1);
-    FlowBitAdd(&f, 2);
-    FlowBitAdd(&f, 3);
-
-    FlowBit *fb = FlowBitGet(&f, 3);
-    FAIL_IF_NULL(fb);
-
-    SCGenericVarFree(f.flowvar);
-    PASS;
-}
-
-static int FlowBitTest08 (void)
-{
-    Flow f;
-    memset(&f, 0, sizeof(Flow));
-
-    FlowBitAdd(&f, 0);
-    FlowBitAdd(&f, 1);
-    FlowBitAdd(&f, 2);
-    FlowBitAdd(&f, 3);
-
-    FlowBit *fb = FlowBitGet(&f,0);
-    FAIL_IF_NULL(fb);
-
-    FlowBitRemove(&f,0);
+    FAIL_IF_NOT(FlowBitSet(&f, 1000) == 1);
+    FAIL_IF_NOT(f.flowvar->type == DETECT_FLOWBITS);
+    FAIL_IF_NOT(f.flowvar->next == fv);
+    FAIL_IF_NOT(FlowBitIsset(&f, 3));
+    FAIL_IF_NOT(FlowBitIsset(&f, 1000));
+    FAIL_IF(FlowBitIsset(&f, 999));
+    FAIL_IF(FlowBitIsset(&f, 100000));
 
-    fb = FlowBitGet(&f, 0);
-    FAIL_IF_NOT_NULL(fb);
+    FlowVar *v = FlowVarGet(&f, 1);
+    FAIL_IF_NULL(v);
+    FAIL_IF_NOT(v->data.fv_int.value == 10);
 
     SCGenericVarFree(f.flowvar);
     PASS;
 }
 
-static int FlowBitTest09 (void)
-{
-    Flow f;
-    memset(&f, 0, sizeof(Flow));
-
-    FlowBitAdd(&f, 0);
-    FlowBitAdd(&f, 1);
-    FlowBitAdd(&f, 2);
-    FlowBitAdd(&f, 3);
-
-    FlowBit *fb = FlowBitGet(&f,1);
-    FAIL_IF_NULL(fb);
-
-    FlowBitRemove(&f,1);
-
-    fb = FlowBitGet(&f, 1);
-    FAIL_IF_NOT_NULL(fb);
-
-    SCGenericVarFree(f.flowvar);
-    PASS;
-}
-
-static int FlowBitTest10 (void)
+static int FlowBitTest07 (void)
 {
     Flow f;
     memset(&f, 0, sizeof(Flow));
 
-    FlowBitAdd(&f, 0);
-    FlowBitAdd(&f, 1);
-    FlowBitAdd(&f, 2);
-    FlowBitAdd(&f, 3);
-
-    FlowBit *fb = FlowBitGet(&f,2);
-    FAIL_IF_NULL(fb);
+    FAIL_IF_NOT(FlowBitToggle(&f, 5));
+    FAIL_IF_NOT(FlowBitIsset(&f, 5));
+    FAIL_IF(FlowBitToggle(&f, 5));
+    FAIL_IF(FlowBitIsset(&f, 5));
+    FAIL_IF_NOT_NULL(f.flowvar);
 
-    FlowBitRemove(&f,2);
-
-    fb = FlowBitGet(&f, 2);
-    FAIL_IF_NOT_NULL(fb);
-
-    SCGenericVarFree(f.flowvar);
     PASS;
 }
 
-static int FlowBitTest11 (void)
+static int FlowBitTest08 (void)
 {
     Flow f;
     memset(&f, 0, sizeof(Flow));
 
-    FlowBitAdd(&f, 0);
-    FlowBitAdd(&f, 1);
-    FlowBitAdd(&f, 2);
-    FlowBitAdd(&f, 3);
-
-    FlowBit *fb = FlowBitGet(&f,3);
-    FAIL_IF_NULL(fb);
+    const uint32_t set[] = { 0, 1, 63, 64, 200, 255 };
+    for (uint32_t i = 0; i < ARRAY_SIZE(set); i++) {
+        FlowBitSet(&f, set[i]);
+    }
 
-    FlowBitRemove(&f,3);
+    uint32_t n = 0;
+    for (uint32_t idx = 0; FlowBitGetNext(&f, &idx); idx++) {
+        FAIL_IF(n >= ARRAY_SIZE(set));
+        FAIL_IF_NOT(idx == set[n]);
+        n++;
+    }
+    FAIL_IF_NOT(n == ARRAY_SIZE(set));
 
-    fb = FlowBitGet(&f, 3);
-    FAIL_IF_NOT_NULL(fb);
+    uint32_t idx = 65;
+    FAIL_IF_NOT(FlowBitGetNext(&f, &idx));
+    FAIL_IF_NOT(idx == 200);
 
     SCGenericVarFree(f.flowvar);
     PASS;
@@ -365,9 +360,5 @@ void FlowBitRegisterTests(void)
     UtRegisterTest("FlowBitTest06", FlowBitTest06);
     UtRegisterTest("FlowBitTest07", FlowBitTest07);
     UtRegisterTest("FlowBitTest08", FlowBitTest08);
-    UtRegisterTest("FlowBitTest09", FlowBitTest09);
-    UtRegisterTest("FlowBitTest10", FlowBitTest10);
-    UtRegisterTest("FlowBitTest11", FlowBitTest11);
 #endif /* UNITTESTS */
 }
-
@@ -27,21 +27,26 @@
 #include "flow.h"
 #include "util-var.h"
 
+/** all flowbits of a flow, as a bitset indexed by the name idx. If the
+ *  flow has flowbits set, this is the first item of the flow's var list. */
 typedef struct FlowBit_ {
     uint16_t type; /* type, DETECT_FLOWBITS in this case */
     uint8_t pad[2];
-    uint32_t idx; /* name idx */
-    GenericVar *next; /* right now just implement this as a list,
-                       * in the long run we have think of something
-                       * faster. */
+    uint32_t size; /**< number of words in bits */
+    GenericVar *next;
+    uint32_t cnt; /**< number of bits set */
+    uint64_t bits[];
 } FlowBit;
 
 void FlowBitFree(FlowBit *);
 void FlowBitRegisterTests(void);
 
+void FlowBitSetMaxId(uint32_t);
+
 int FlowBitSet(Flow *, uint32_t);
 void FlowBitUnset(Flow *, uint32_t);
 bool FlowBitToggle(Flow *, uint32_t);
-int FlowBitIsset(Flow *, uint32_t);
-int FlowBitIsnotset(Flow *, uint32_t);
+int FlowBitIsset(const Flow *, uint32_t);
+int FlowBitIsnotset(const Flow *, uint32_t);
+bool FlowBitGetNext(const Flow *, uint32_t *);
 #endif /* SURICATA_FLOW_BIT_H */
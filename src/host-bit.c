@@ -24,7 +24,6 @@
  * but called that way because of Snort's flowbits.
  * It's a binary storage.
  *
- * \todo move away from a linked list implementation
  * \todo use different datatypes, such as string, int, etc.
  */
 
@@ -42,8 +41,8 @@ static HostStorageId host_bit_id = { .id = -1 }; /**< Host storage id for bits *
 
 static void HostBitFreeAll(void *store)
 {
-    GenericVar *gv = store;
-    SCGenericVarFree(gv);
+    XBitArray *xa = store;
+    XBitArrayFree(xa);
 }
 
 void HostBitInitCtx(void)
@@ -66,88 +65,61 @@ int HostHasHostBits(Host *host)
   * \retval 0 host still has active (non-expired) xbits */
 int HostBitsTimedoutCheck(Host *h, SCTime_t ts)
 {
-    GenericVar *gv = HostGetStorageById(h, host_bit_id);
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_XBITS) {
-            XBit *xb = (XBit *)gv;
-            if (SCTIME_CMP_GT(xb->expire, ts))
-                return 0;
-        }
-    }
-    return 1;
+    const XBitArray *xa = HostGetStorageById(h, host_bit_id);
+    return XBitArrayTimedout(xa, ts) ? 1 : 0;
 }
 
-/* get the bit with idx from the host */
-static XBit *HostBitGet(Host *h, uint32_t idx)
+/* get the position of the bit with idx in the host's bit array, -1 if not set */
+static int HostBitGet(Host *h, uint32_t idx)
 {
-    GenericVar *gv = HostGetStorageById(h, host_bit_id);
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_XBITS && gv->idx == idx) {
-            return (XBit *)gv;
-        }
-    }
-
-    return NULL;
+    const XBitArray *xa = HostGetStorageById(h, host_bit_id);
+    return XBitArrayFind(xa, idx);
 }
 
-/* add a flowbit to the flow */
+/* add a bit to the host */
 static void HostBitAdd(Host *h, uint32_t idx, SCTime_t expire)
 {
-    XBit *fb = HostBitGet(h, idx);
-    if (fb == NULL) {
-        fb = SCMalloc(sizeof(XBit));
-        if (unlikely(fb == NULL))
+    XBitArray *xa = HostGetStorageById(h, host_bit_id);
+    int pos = XBitArrayFind(xa, idx);
+    if (pos == -1) {
+        if (XBitArrayAdd(&xa, idx, expire) == -1)
             return;
+        HostSetStorageById(h, host_bit_id, xa);
 
-        fb->type = DETECT_XBITS;
-        fb->idx = idx;
-        fb->next = NULL;
-        fb->expire = expire;
-
-        GenericVar *gv = HostGetStorageById(h, host_bit_id);
-        GenericVarAppend(&gv, (GenericVar *)fb);
-        HostSetStorageById(h, host_bit_id, gv);
-
-    // bit already set, lets update it's time
+        // bit already set, lets update it's time
     } else {
-        fb->expire = expire;
+        xa->expire[pos] = expire;
+        if (SCTIME_CMP_GT(expire, xa->max_expire))
+            xa->max_expire = expire;
     }
 }
 
 static void HostBitRemove(Host *h, uint32_t idx)
 {
-    XBit *fb = HostBitGet(h, idx);
-    if (fb == NULL)
+    XBitArray *xa = HostGetStorageById(h, host_bit_id);
+    int pos = XBitArrayFind(xa, idx);
+    if (pos == -1)
         return;
 
-    GenericVar *gv = HostGetStorageById(h, host_bit_id);
-    if (gv) {
-        GenericVarRemove(&gv, (GenericVar *)fb);
-        XBitFree(fb);
-        HostSetStorageById(h, host_bit_id, gv);
-    }
+    XBitArrayRemove(&xa, (uint32_t)pos);
+    HostSetStorageById(h, host_bit_id, xa);
 }
 
 void HostBitSet(Host *h, uint32_t idx, SCTime_t expire)
 {
-    XBit *fb = HostBitGet(h, idx);
-    if (fb == NULL) {
+    if (HostBitGet(h, idx) == -1) {
         HostBitAdd(h, idx, expire);
     }
 }
 
 void HostBitUnset(Host *h, uint32_t idx)
 {
-    XBit *fb = HostBitGet(h, idx);
-    if (fb != NULL) {
-        HostBitRemove(h, idx);
-    }
+    HostBitRemove(h, idx);
 }
 
 void HostBitToggle(Host *h, uint32_t idx, SCTime_t expire)
 {
-    XBit *fb = HostBitGet(h, idx);
-    if (fb != NULL) {
+    if (HostBitGet(h, idx) != -1) {
         HostBitRemove(h, idx);
     } else {
         HostBitAdd(h, idx, expire);
@@ -156,10 +128,12 @@ void HostBitToggle(Host *h, uint32_t idx, SCTime_t expire)
 
 int HostBitIsset(Host *h, uint32_t idx, SCTime_t ts)
 {
-    XBit *fb = HostBitGet(h, idx);
-    if (fb != NULL) {
-        if (SCTIME_CMP_LT(fb->expire, ts)) {
-            HostBitRemove(h,idx);
+    XBitArray *xa = HostGetStorageById(h, host_bit_id);
+    int pos = XBitArrayFind(xa, idx);
+    if (pos != -1) {
+        if (SCTIME_CMP_LT(xa->expire[pos], ts)) {
+            XBitArrayRemove(&xa, (uint32_t)pos);
+            HostSetStorageById(h, host_bit_id, xa);
             return 0;
         }
         return 1;
@@ -169,35 +143,36 @@ int HostBitIsset(Host *h, uint32_t idx, SCTime_t ts)
 
 int HostBitIsnotset(Host *h, uint32_t idx, SCTime_t ts)
 {
-    XBit *fb = HostBitGet(h, idx);
-    if (fb == NULL) {
+    XBitArray *xa = HostGetStorageById(h, host_bit_id);
+    int pos = XBitArrayFind(xa, idx);
+    if (pos == -1) {
         return 1;
     }
 
-    if (SCTIME_CMP_LT(fb->expire, ts)) {
-        HostBitRemove(h,idx);
+    if (SCTIME_CMP_LT(xa->expire[pos], ts)) {
+        XBitArrayRemove(&xa, (uint32_t)pos);
+        HostSetStorageById(h, host_bit_id, xa);
         return 1;
     }
     return 0;
 }
 
-int HostBitList(Host *h, XBit **iter)
+/** \brief get the next bit of the host
+ *
+ *  \param iter position to start at, 0 for the first bit. Updated to the
+ *              position of the next bit.
+ *  \retval 1 bit returned in \a idx and \a expire
+ *  \retval 0 no more bits */
+int HostBitList(Host *h, uint32_t *iter, uint32_t *idx, SCTime_t *expire)
 {
-    GenericVar *gv = (GenericVar *)*iter;
-    if (gv == NULL) {
-        gv = HostGetStorageById(h, host_bit_id);
-    } else {
-        gv = gv->next;
-    }
+    const XBitArray *xa = HostGetStorageById(h, host_bit_id);
+    if (xa == NULL || *iter >= xa->cnt)
+        return 0;
 
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_XBITS) {
-            *iter = (XBit *)gv;
-            return 1;
-        }
-    }
-    *iter = NULL;
-    return 0;
+    *idx = xa->idx[*iter];
+    *expire = xa->expire[*iter];
+    (*iter)++;
+    return 1;
 }
 
 /* TESTS */
@@ -218,8 +193,8 @@ static int HostBitTest01 (void)
 
     HostBitAdd(h, 0, SCTIME_FROM_SECS(0));
 
-    XBit *fb = HostBitGet(h,0);
-    if (fb != NULL)
+    int fb = HostBitGet(h,0);
+    if (fb != -1)
         ret = 1;
 
     HostFree(h);
@@ -243,8 +218,8 @@ static int HostBitTest02 (void)
     if (h == NULL)
         goto end;
 
-    XBit *fb = HostBitGet(h,0);
-    if (fb == NULL)
+    int fb = HostBitGet(h,0);
+    if (fb == -1)
         ret = 1;
 
     HostFree(h);
@@ -270,17 +245,17 @@ static int HostBitTest03 (void)
 
     HostBitAdd(h, 0, SCTIME_FROM_SECS(30));
 
-    XBit *fb = HostBitGet(h,0);
-    if (fb == NULL) {
-        printf("fb == NULL although it was just added: ");
+    int fb = HostBitGet(h,0);
+    if (fb == -1) {
+        printf("fb == -1 although it was just added: ");
         goto end;
     }
 
     HostBitRemove(h, 0);
 
     fb = HostBitGet(h,0);
-    if (fb != NULL) {
-        printf("fb != NULL although it was just removed: ");
+    if (fb != -1) {
+        printf("fb != -1 although it was just removed: ");
         goto end;
     } else {
         ret = 1;
@@ -312,8 +287,8 @@ static int HostBitTest04 (void)
     HostBitAdd(h, 2, SCTIME_FROM_SECS(30));
     HostBitAdd(h, 3, SCTIME_FROM_SECS(30));
 
-    XBit *fb = HostBitGet(h,0);
-    if (fb != NULL)
+    int fb = HostBitGet(h,0);
+    if (fb != -1)
         ret = 1;
 
     HostFree(h);
@@ -342,8 +317,8 @@ static int HostBitTest05 (void)
     HostBitAdd(h, 2, SCTIME_FROM_SECS(30));
     HostBitAdd(h, 3, SCTIME_FROM_SECS(30));
 
-    XBit *fb = HostBitGet(h,1);
-    if (fb != NULL)
+    int fb = HostBitGet(h,1);
+    if (fb != -1)
         ret = 1;
 
     HostFree(h);
@@ -372,8 +347,8 @@ static int HostBitTest06 (void)
     HostBitAdd(h, 2, SCTIME_FROM_SECS(90));
     HostBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = HostBitGet(h,2);
-    if (fb != NULL)
+    int fb = HostBitGet(h,2);
+    if (fb != -1)
         ret = 1;
 
     HostFree(h);
@@ -402,8 +377,8 @@ static int HostBitTest07 (void)
     HostBitAdd(h, 2, SCTIME_FROM_SECS(90));
     HostBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = HostBitGet(h,3);
-    if (fb != NULL)
+    int fb = HostBitGet(h,3);
+    if (fb != -1)
         ret = 1;
 
     HostFree(h);
@@ -432,15 +407,15 @@ static int HostBitTest08 (void)
     HostBitAdd(h, 2, SCTIME_FROM_SECS(90));
     HostBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = HostBitGet(h,0);
-    if (fb == NULL)
+    int fb = HostBitGet(h,0);
+    if (fb == -1)
         goto end;
 
     HostBitRemove(h,0);
 
     fb = HostBitGet(h,0);
-    if (fb != NULL) {
-        printf("fb != NULL even though it was removed: ");
+    if (fb != -1) {
+        printf("fb != -1 even though it was removed: ");
         goto end;
     }
 
@@ -471,15 +446,15 @@ static int HostBitTest09 (void)
     HostBitAdd(h, 2, SCTIME_FROM_SECS(90));
     HostBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = HostBitGet(h,1);
-    if (fb == NULL)
+    int fb = HostBitGet(h,1);
+    if (fb == -1)
         goto end;
 
     HostBitRemove(h,1);
 
     fb = HostBitGet(h,1);
-    if (fb != NULL) {
-        printf("fb != NULL even though it was removed: ");
+    if (fb != -1) {
+        printf("fb != -1 even though it was removed: ");
         goto end;
     }
 
@@ -510,15 +485,15 @@ static int HostBitTest10 (void)
     HostBitAdd(h, 2, SCTIME_FROM_SECS(90));
     HostBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = HostBitGet(h,2);
-    if (fb == NULL)
+    int fb = HostBitGet(h,2);
+    if (fb == -1)
         goto end;
 
     HostBitRemove(h,2);
 
     fb = HostBitGet(h,2);
-    if (fb != NULL) {
-        printf("fb != NULL even though it was removed: ");
+    if (fb != -1) {
+        printf("fb != -1 even though it was removed: ");
         goto end;
     }
 
@@ -549,15 +524,15 @@ static int HostBitTest11 (void)
     HostBitAdd(h, 2, SCTIME_FROM_SECS(90));
     HostBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = HostBitGet(h,3);
-    if (fb == NULL)
+    int fb = HostBitGet(h,3);
+    if (fb == -1)
         goto end;
 
     HostBitRemove(h,3);
 
     fb = HostBitGet(h,3);
-    if (fb != NULL) {
-        printf("fb != NULL even though it was removed: ");
+    if (fb != -1) {
+        printf("fb != -1 even though it was removed: ");
         goto end;
     }
 
@@ -569,6 +544,54 @@ end:
     return ret;
 }
 
+static int HostBitTest12(void)
+{
+    StorageCleanup();
+    StorageInit();
+    HostBitInitCtx();
+    StorageFinalize();
+
+    HostInitConfig(true);
+    Host *h = HostAlloc();
+    FAIL_IF_NULL(h);
+
+    /* more bits than the initial array holds */
+    for (uint32_t i = 0; i < 10; i++) {
+        HostBitSet(h, i * 3, SCTIME_FROM_SECS(100 + i));
+    }
+    for (uint32_t i = 0; i < 30; i++) {
+        FAIL_IF((HostBitGet(h, i) != -1) != (i % 3 == 0));
+    }
+    FAIL_IF(HostBitsTimedoutCheck(h, SCTIME_FROM_SECS(108)) != 0);
+    FAIL_IF(HostBitsTimedoutCheck(h, SCTIME_FROM_SECS(109)) != 1);
+
+    /* removing the bit with the latest expire time */
+    HostBitUnset(h, 27);
+    FAIL_IF(HostBitGet(h, 27) != -1);
+    FAIL_IF(HostBitGet(h, 24) == -1);
+    FAIL_IF(HostBitsTimedoutCheck(h, SCTIME_FROM_SECS(108)) != 1);
+
+    uint32_t iter = 0, idx = 0, cnt = 0;
+    SCTime_t expire;
+    while (HostBitList(h, &iter, &idx, &expire) == 1) {
+        FAIL_IF(idx % 3 != 0);
+        FAIL_IF(SCTIME_SECS(expire) != 100 + idx / 3);
+        cnt++;
+    }
+    FAIL_IF(cnt != 9);
+
+    for (uint32_t i = 0; i < 9; i++) {
+        HostBitUnset(h, i * 3);
+    }
+    FAIL_IF(HostHasHostBits(h));
+    FAIL_IF(HostBitsTimedoutCheck(h, SCTIME_FROM_SECS(0)) != 1);
+
+    HostFree(h);
+    HostShutdown();
+    StorageCleanup();
+    PASS;
+}
+
 #endif /* UNITTESTS */
 
 void HostBitRegisterTests(void)
@@ -585,5 +608,6 @@ void HostBitRegisterTests(void)
     UtRegisterTest("HostBitTest09", HostBitTest09);
     UtRegisterTest("HostBitTest10", HostBitTest10);
     UtRegisterTest("HostBitTest11", HostBitTest11);
+    UtRegisterTest("HostBitTest12", HostBitTest12);
 #endif /* UNITTESTS */
 }
@@ -38,6 +38,6 @@ void HostBitUnset(Host *, uint32_t);
 void HostBitToggle(Host *, uint32_t, SCTime_t);
 int HostBitIsset(Host *, uint32_t, SCTime_t);
 int HostBitIsnotset(Host *, uint32_t, SCTime_t);
-int HostBitList(Host *, XBit **);
+int HostBitList(Host *, uint32_t *, uint32_t *, SCTime_t *);
 
 #endif /* SURICATA_HOST_BIT_H */
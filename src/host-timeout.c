@@ -29,8 +29,6 @@
 #include "host-bit.h"
 #include "host-timeout.h"
 
-#include "reputation.h"
-
 /** \internal
  *  \brief See if we can really discard this host. Check use_cnt reference.
  *
@@ -50,7 +48,6 @@ static int HostHostTimedOut(Host *h, SCTime_t ts)
         return 0;
     }
 
-    busy |= (h->iprep && SRepHostTimedOut(h) == 0);
     busy |= (TagHostHasTag(h) && TagTimeoutCheck(h, ts) == 0);
     busy |= (HostHasHostBits(h) && HostBitsTimedoutCheck(h, ts) == 0);
     SCLogDebug("host %p %s", h, busy ? "still active" : "timed out");
@@ -84,6 +81,7 @@ static uint32_t HostHashRowTimeout(HostHashRow *hb, Host *h, SCTime_t ts)
          * ready to be discarded. */
         if (HostHostTimedOut(h, ts) == 1) {
             /* remove from the hash */
+            HostRowWriteBegin(hb);
             if (h->hprev != NULL)
                 h->hprev->hnext = h->hnext;
             if (h->hnext != NULL)
@@ -95,6 +93,7 @@ static uint32_t HostHashRowTimeout(HostHashRow *hb, Host *h, SCTime_t ts)
 
             h->hnext = NULL;
             h->hprev = NULL;
+            HostRowWriteEnd(hb);
 
             HostClearMemory (h);
 
@@ -149,10 +149,6 @@ error:
 
 void HostClearMemory(Host *h)
 {
-    if (h->iprep != NULL) {
-        SRepFreeHostData(h);
-    }
-
     if (HostStorageSize() > 0)
         HostFreeStorage(h);
 
@@ -242,6 +238,7 @@ void HostInitConfig(bool quiet)
     uint32_t i = 0;
     for (i = 0; i < host_config.hash_size; i++) {
         HRLOCK_INIT(&host_hash[i]);
+        SC_ATOMIC_INIT(host_hash[i].seq);
     }
     (void) SC_ATOMIC_ADD(host_memuse, (host_config.hash_size * sizeof(HostHashRow)));
 
@@ -337,13 +334,14 @@ void HostCleanup(void)
             HRLOCK_LOCK(hb);
             Host *h = host_hash[u].head;
             while (h) {
-                if ((SC_ATOMIC_GET(h->use_cnt) > 0) && (h->iprep != NULL)) {
-                    /* iprep is attached to host only clear local storage */
+                if (SC_ATOMIC_GET(h->use_cnt) > 0) {
+                    /* host is still referenced, only clear local storage */
                     HostFreeStorage(h);
                     h = h->hnext;
                 } else {
                     Host *n = h->hnext;
                     /* remove from the hash */
+                    HostRowWriteBegin(hb);
                     if (h->hprev != NULL)
                         h->hprev->hnext = h->hnext;
                     if (h->hnext != NULL)
@@ -354,6 +352,7 @@ void HostCleanup(void)
                         hb->tail = h->hprev;
                     h->hnext = NULL;
                     h->hprev = NULL;
+                    HostRowWriteEnd(hb);
                     HostClearMemory(h);
                     HostMoveToSpare(h);
                     h = n;
@@ -475,6 +474,65 @@ void HostUnlock(Host *h)
 }
 
 
+#define HOST_OPTIMISTIC_TRIES     4
+#define HOST_OPTIMISTIC_MAX_STEPS 64
+
+/** \internal
+ *  \brief look up a host without taking the row lock
+ *
+ *  Reader side of the row seqlock. Hosts are never freed while the hash
+ *  exists, only moved to the spare queue, so following stale pointers is
+ *  harmless. A found host is only returned if the row is still unchanged
+ *  once the host is locked: at runtime a host is only removed from the hash
+ *  while it is locked, so it is then still in the hash.
+ *
+ *  Unlike the locked lookup this doesn't move the host to the front of the
+ *  row, so concurrent lookups of the same host don't write to the row.
+ *
+ *  \param stable set to true if the result is reliable, false if the row
+ *                kept changing and the caller needs to take the row lock
+ *
+ *  \retval h *LOCKED* host or NULL
+ */
+static Host *HostLookupOptimistic(HostHashRow *hb, Address *a, bool *stable)
+{
+    for (int tries = 0; tries < HOST_OPTIMISTIC_TRIES; tries++) {
+        const uint32_t seq = SC_ATOMIC_LOAD_EXPLICIT(hb->seq, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (seq & 1)
+            continue;
+
+        Host *h = hb->head;
+        uint32_t steps = 0;
+        while (h != NULL && steps < HOST_OPTIMISTIC_MAX_STEPS && HostCompare(h, a) == 0) {
+            h = h->hnext;
+            steps++;
+        }
+
+        SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (SC_ATOMIC_LOAD_EXPLICIT(hb->seq, SC_ATOMIC_MEMORY_ORDER_RELAXED) != seq ||
+                steps == HOST_OPTIMISTIC_MAX_STEPS)
+            continue;
+        if (h == NULL) {
+            *stable = true;
+            return NULL;
+        }
+
+        SCMutexLock(&h->m);
+        /* a recycled host gets its new address after it is linked in, so
+         * check the address again now that we hold the lock */
+        SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (SC_ATOMIC_LOAD_EXPLICIT(hb->seq, SC_ATOMIC_MEMORY_ORDER_RELAXED) == seq &&
+                HostCompare(h, a) != 0) {
+            (void)HostIncrUsecnt(h);
+            *stable = true;
+            return h;
+        }
+        SCMutexUnlock(&h->m);
+    }
+    *stable = false;
+    return NULL;
+}
+
 /* HostGetHostFromHash
  *
  * Hash retrieval function for hosts. Looks up the hash bucket containing the
@@ -491,6 +549,13 @@ Host *HostGetHostFromHash (Address *a)
     uint32_t key = HostGetKey(a);
     /* get our hash bucket and lock it */
     HostHashRow *hb = &host_hash[key];
+
+    /* most lookups are for existing hosts, try without the row lock first */
+    bool stable = false;
+    h = HostLookupOptimistic(hb, a, &stable);
+    if (h != NULL)
+        return h;
+
     HRLOCK_LOCK(hb);
 
     /* see if the bucket already has a host */
@@ -502,8 +567,10 @@ Host *HostGetHostFromHash (Address *a)
         }
 
         /* host is locked */
+        HostRowWriteBegin(hb);
         hb->head = h;
         hb->tail = h;
+        HostRowWriteEnd(hb);
 
         /* got one, now lock, initialize and return */
         HostInit(h,a);
@@ -524,16 +591,19 @@ Host *HostGetHostFromHash (Address *a)
             h = h->hnext;
 
             if (h == NULL) {
-                h = ph->hnext = HostGetNew(a);
+                h = HostGetNew(a);
                 if (h == NULL) {
                     HRLOCK_UNLOCK(hb);
                     return NULL;
                 }
-                hb->tail = h;
 
                 /* host is locked */
 
+                HostRowWriteBegin(hb);
+                ph->hnext = h;
+                hb->tail = h;
                 h->hprev = ph;
+                HostRowWriteEnd(hb);
 
                 /* initialize and return */
                 HostInit(h,a);
@@ -545,6 +615,7 @@ Host *HostGetHostFromHash (Address *a)
             if (HostCompare(h, a) != 0) {
                 /* we found our host, lets put it on top of the
                  * hash list -- this rewards active hosts */
+                HostRowWriteBegin(hb);
                 if (h->hnext) {
                     h->hnext->hprev = h->hprev;
                 }
@@ -559,6 +630,7 @@ Host *HostGetHostFromHash (Address *a)
                 h->hprev = NULL;
                 hb->head->hprev = h;
                 hb->head = h;
+                HostRowWriteEnd(hb);
 
                 /* found our host, lock & return */
                 SCMutexLock(&h->m);
@@ -590,6 +662,12 @@ Host *HostLookupHostFromHash (Address *a)
     uint32_t key = HostGetKey(a);
     /* get our hash bucket and lock it */
     HostHashRow *hb = &host_hash[key];
+
+    bool stable = false;
+    h = HostLookupOptimistic(hb, a, &stable);
+    if (stable)
+        return h;
+
     HRLOCK_LOCK(hb);
 
     /* see if the bucket already has a host */
@@ -614,6 +692,7 @@ Host *HostLookupHostFromHash (Address *a)
             if (HostCompare(h, a) != 0) {
                 /* we found our host, lets put it on top of the
                  * hash list -- this rewards active hosts */
+                HostRowWriteBegin(hb);
                 if (h->hnext) {
                     h->hnext->hprev = h->hprev;
                 }
@@ -628,6 +707,7 @@ Host *HostLookupHostFromHash (Address *a)
                 h->hprev = NULL;
                 hb->head->hprev = h;
                 hb->head = h;
+                HostRowWriteEnd(hb);
 
                 /* found our host, lock & return */
                 SCMutexLock(&h->m);
@@ -690,6 +770,7 @@ static Host *HostGetUsedHost(void)
         }
 
         /* remove from the hash */
+        HostRowWriteBegin(hb);
         if (h->hprev != NULL)
             h->hprev->hnext = h->hnext;
         if (h->hnext != NULL)
@@ -701,6 +782,7 @@ static Host *HostGetUsedHost(void)
 
         h->hnext = NULL;
         h->hprev = NULL;
+        HostRowWriteEnd(hb);
         HRLOCK_UNLOCK(hb);
 
         HostClearMemory (h);
@@ -714,7 +796,154 @@ static Host *HostGetUsedHost(void)
     return NULL;
 }
 
+#ifdef UNITTESTS
+#include "util-unittest.h"
+
+static void HostTestAddress(Address *a, uint32_t ip)
+{
+    memset(a, 0, sizeof(*a));
+    a->family = AF_INET;
+    a->addr_data32[0] = ip;
+}
+
+/** \test optimistic lookup finds an existing host and reports a miss as stable */
+static int HostLookupOptimisticTest01(void)
+{
+    StorageCleanup();
+    StorageInit();
+    StorageFinalize();
+    HostInitConfig(true);
+
+    Address a, c;
+    HostTestAddress(&a, 0x01020304);
+    HostTestAddress(&c, 0x05060708);
+    Host *h = HostGetHostFromHash(&a);
+    FAIL_IF_NULL(h);
+    HostRelease(h);
+
+    bool stable = false;
+    Host *h2 = HostLookupOptimistic(&host_hash[HostGetKey(&a)], &a, &stable);
+    FAIL_IF_NOT(h2 == h);
+    FAIL_IF_NOT(stable);
+    FAIL_IF_NOT(SC_ATOMIC_GET(h->use_cnt) == 1);
+    HostRelease(h2);
+
+    stable = false;
+    h2 = HostLookupOptimistic(&host_hash[HostGetKey(&c)], &c, &stable);
+    FAIL_IF_NOT_NULL(h2);
+    FAIL_IF_NOT(stable);
+
+    HostShutdown();
+    StorageCleanup();
+    PASS;
+}
+
+/** \test a row that is being modified makes the optimistic lookup give up,
+ *        the lookup functions then fall back to the locked lookup */
+static int HostLookupOptimisticTest02(void)
+{
+    StorageCleanup();
+    StorageInit();
+    StorageFinalize();
+    HostInitConfig(true);
+
+    Address a, c;
+    HostTestAddress(&a, 0x01020304);
+    HostTestAddress(&c, 0x05060708);
+    Host *h = HostGetHostFromHash(&a);
+    FAIL_IF_NULL(h);
+    HostRelease(h);
+
+    HostHashRow *hb = &host_hash[HostGetKey(&a)];
+    HostRowWriteBegin(hb);
+    bool stable = true;
+    Host *h2 = HostLookupOptimistic(hb, &a, &stable);
+    FAIL_IF_NOT_NULL(h2);
+    FAIL_IF(stable);
+
+    h2 = HostLookupHostFromHash(&a);
+    FAIL_IF_NOT(h2 == h);
+    HostRelease(h2);
+    h2 = HostGetHostFromHash(&a);
+    FAIL_IF_NOT(h2 == h);
+    HostRelease(h2);
+    HostRowWriteEnd(hb);
+
+    /* the row changed since the first lookup, but is stable again */
+    h2 = HostLookupOptimistic(hb, &a, &stable);
+    FAIL_IF_NOT(h2 == h);
+    FAIL_IF_NOT(stable);
+    HostRelease(h2);
+
+    HostShutdown();
+    StorageCleanup();
+    PASS;
+}
+
+/** \test the optimistic lookup gives up after HOST_OPTIMISTIC_MAX_STEPS steps, the locked
+ *        lookup then moves the host to the front of the row */
+static int HostLookupOptimisticTest03(void)
+{
+    SCConfCreateContextBackup();
+    SCConfInit();
+    SCConfSet("host.hash-size", "1");
+
+    StorageCleanup();
+    StorageInit();
+    StorageFinalize();
+    HostInitConfig(true);
+    FAIL_IF_NOT(host_config.hash_size == 1);
+
+    Address a, c;
+    HostTestAddress(&a, 0x01020304);
+    HostTestAddress(&c, 0x05060708);
+    /* new hosts are added at the tail, put 'a' behind HOST_OPTIMISTIC_MAX_STEPS others */
+    for (uint32_t i = 0; i < HOST_OPTIMISTIC_MAX_STEPS; i++) {
+        Address x;
+        HostTestAddress(&x, 0x0a000001 + i);
+        Host *o = HostGetHostFromHash(&x);
+        FAIL_IF_NULL(o);
+        HostRelease(o);
+    }
+    Host *h = HostGetHostFromHash(&a);
+    FAIL_IF_NULL(h);
+    HostRelease(h);
+    FAIL_IF_NOT(host_hash[0].tail == h);
+
+    bool stable = true;
+    Host *h2 = HostLookupOptimistic(&host_hash[0], &a, &stable);
+    FAIL_IF_NOT_NULL(h2);
+    FAIL_IF(stable);
+    /* a miss can't be told apart from a long row either */
+    stable = true;
+    h2 = HostLookupOptimistic(&host_hash[0], &c, &stable);
+    FAIL_IF_NOT_NULL(h2);
+    FAIL_IF(stable);
+
+    h2 = HostLookupHostFromHash(&a);
+    FAIL_IF_NOT(h2 == h);
+    HostRelease(h2);
+    FAIL_IF_NOT(host_hash[0].head == h);
+
+    h2 = HostLookupOptimistic(&host_hash[0], &a, &stable);
+    FAIL_IF_NOT(h2 == h);
+    FAIL_IF_NOT(stable);
+    HostRelease(h2);
+
+    HostShutdown();
+    StorageCleanup();
+    SCConfDeInit();
+    SCConfRestoreContextBackup();
+    PASS;
+}
+#endif /* UNITTESTS */
+
 void HostRegisterUnittests(void)
 {
     RegisterHostStorageTests();
+#ifdef UNITTESTS
+    UtRegisterTest("HostLookupOptimisticTest01", HostLookupOptimisticTest01);
+    UtRegisterTest("HostLookupOptimisticTest02", HostLookupOptimisticTest02);
+    UtRegisterTest("HostLookupOptimisticTest03", HostLookupOptimisticTest03);
+#endif
 }
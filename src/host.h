@@ -65,9 +65,6 @@ typedef struct Host_ {
     /** use cnt, reference counter */
     SC_ATOMIC_DECLARE(unsigned int, use_cnt);
 
-    /** pointers to iprep storage */
-    void *iprep;
-
     /** hash pointers, protected by hash row mutex/spin */
     struct Host_ *hnext;
     struct Host_ *hprev;
@@ -82,10 +79,28 @@ typedef struct Host_ {
 
 typedef struct HostHashRow_ {
     HRLOCK_TYPE lock;
+    /** sequence counter, odd while the row's list is being modified. Used
+     *  by lookups that walk the row without taking the lock. */
+    SC_ATOMIC_DECLARE(uint32_t, seq);
     Host *head;
     Host *tail;
 } __attribute__((aligned(CLS))) HostHashRow;
 
+/** \brief mark the start of a change to the list of a locked row
+ *
+ *  Together with HostRowWriteEnd this forms the writer side of a seqlock. */
+static inline void HostRowWriteBegin(HostHashRow *hb)
+{
+    (void)SC_ATOMIC_ADD(hb->seq, 1);
+    SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_RELEASE);
+}
+
+static inline void HostRowWriteEnd(HostHashRow *hb)
+{
+    SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_RELEASE);
+    (void)SC_ATOMIC_ADD(hb->seq, 1);
+}
+
 /** host hash table */
 extern HostHashRow *host_hash;
 
@@ -24,7 +24,6 @@
  * but called that way because of Snort's flowbits.
  * It's a binary storage.
  *
- * \todo move away from a linked list implementation
  * \todo use different datatypes, such as string, int, etc.
  */
 
@@ -42,8 +41,8 @@ static IPPairStorageId g_ippair_bit_storage_id = { .id = -1 }; /**< IPPair stora
 
 static void XBitFreeAll(void *store)
 {
-    GenericVar *gv = store;
-    SCGenericVarFree(gv);
+    XBitArray *xa = store;
+    XBitArrayFree(xa);
 }
 
 void IPPairBitInitCtx(void)
@@ -66,88 +65,61 @@ int IPPairHasBits(IPPair *ippair)
   * \retval 0 ippair still has active (non-expired) xbits */
 int IPPairBitsTimedoutCheck(IPPair *h, SCTime_t ts)
 {
-    GenericVar *gv = IPPairGetStorageById(h, g_ippair_bit_storage_id);
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_XBITS) {
-            XBit *xb = (XBit *)gv;
-            if (SCTIME_CMP_GT(xb->expire, ts))
-                return 0;
-        }
-    }
-    return 1;
+    const XBitArray *xa = IPPairGetStorageById(h, g_ippair_bit_storage_id);
+    return XBitArrayTimedout(xa, ts) ? 1 : 0;
 }
 
-/* get the bit with idx from the ippair */
-static XBit *IPPairBitGet(IPPair *h, uint32_t idx)
+/* get the position of the bit with idx in the ippair's bit array, -1 if not set */
+static int IPPairBitGet(IPPair *h, uint32_t idx)
 {
-    GenericVar *gv = IPPairGetStorageById(h, g_ippair_bit_storage_id);
-    for ( ; gv != NULL; gv = gv->next) {
-        if (gv->type == DETECT_XBITS && gv->idx == idx) {
-            return (XBit *)gv;
-        }
-    }
-
-    return NULL;
+    const XBitArray *xa = IPPairGetStorageById(h, g_ippair_bit_storage_id);
+    return XBitArrayFind(xa, idx);
 }
 
-/* add a flowbit to the flow */
+/* add a bit to the ippair */
 static void IPPairBitAdd(IPPair *h, uint32_t idx, SCTime_t expire)
 {
-    XBit *fb = IPPairBitGet(h, idx);
-    if (fb == NULL) {
-        fb = SCMalloc(sizeof(XBit));
-        if (unlikely(fb == NULL))
+    XBitArray *xa = IPPairGetStorageById(h, g_ippair_bit_storage_id);
+    int pos = XBitArrayFind(xa, idx);
+    if (pos == -1) {
+        if (XBitArrayAdd(&xa, idx, expire) == -1)
             return;
+        IPPairSetStorageById(h, g_ippair_bit_storage_id, xa);
 
-        fb->type = DETECT_XBITS;
-        fb->idx = idx;
-        fb->next = NULL;
-        fb->expire = expire;
-
-        GenericVar *gv = IPPairGetStorageById(h, g_ippair_bit_storage_id);
-        GenericVarAppend(&gv, (GenericVar *)fb);
-        IPPairSetStorageById(h, g_ippair_bit_storage_id, gv);
-
-        // bit already set, lets update it's timer
+        // bit already set, lets update it's time
     } else {
-        fb->expire = expire;
+        xa->expire[pos] = expire;
+        if (SCTIME_CMP_GT(expire, xa->max_expire))
+            xa->max_expire = expire;
     }
 }
 
 static void IPPairBitRemove(IPPair *h, uint32_t idx)
 {
-    XBit *fb = IPPairBitGet(h, idx);
-    if (fb == NULL)
+    XBitArray *xa = IPPairGetStorageById(h, g_ippair_bit_storage_id);
+    int pos = XBitArrayFind(xa, idx);
+    if (pos == -1)
         return;
 
-    GenericVar *gv = IPPairGetStorageById(h, g_ippair_bit_storage_id);
-    if (gv) {
-        GenericVarRemove(&gv, (GenericVar *)fb);
-        XBitFree(fb);
-        IPPairSetStorageById(h, g_ippair_bit_storage_id, gv);
-    }
+    XBitArrayRemove(&xa, (uint32_t)pos);
+    IPPairSetStorageById(h, g_ippair_bit_storage_id, xa);
 }
 
 void IPPairBitSet(IPPair *h, uint32_t idx, SCTime_t expire)
 {
-    XBit *fb = IPPairBitGet(h, idx);
-    if (fb == NULL) {
+    if (IPPairBitGet(h, idx) == -1) {
         IPPairBitAdd(h, idx, expire);
     }
 }
 
 void IPPairBitUnset(IPPair *h, uint32_t idx)
 {
-    XBit *fb = IPPairBitGet(h, idx);
-    if (fb != NULL) {
-        IPPairBitRemove(h, idx);
-    }
+    IPPairBitRemove(h, idx);
 }
 
 void IPPairBitToggle(IPPair *h, uint32_t idx, SCTime_t expire)
 {
-    XBit *fb = IPPairBitGet(h, idx);
-    if (fb != NULL) {
+    if (IPPairBitGet(h, idx) != -1) {
         IPPairBitRemove(h, idx);
     } else {
         IPPairBitAdd(h, idx, expire);
@@ -156,13 +128,14 @@ void IPPairBitToggle(IPPair *h, uint32_t idx, SCTime_t expire)
 
 int IPPairBitIsset(IPPair *h, uint32_t idx, SCTime_t ts)
 {
-    XBit *fb = IPPairBitGet(h, idx);
-    if (fb != NULL) {
-        if (SCTIME_CMP_LT(fb->expire, ts)) {
-            IPPairBitRemove(h, idx);
+    XBitArray *xa = IPPairGetStorageById(h, g_ippair_bit_storage_id);
+    int pos = XBitArrayFind(xa, idx);
+    if (pos != -1) {
+        if (SCTIME_CMP_LT(xa->expire[pos], ts)) {
+            XBitArrayRemove(&xa, (uint32_t)pos);
+            IPPairSetStorageById(h, g_ippair_bit_storage_id, xa);
             return 0;
         }
-
         return 1;
     }
     return 0;
@@ -170,20 +143,20 @@ int IPPairBitIsset(IPPair *h, uint32_t idx, SCTime_t ts)
 
 int IPPairBitIsnotset(IPPair *h, uint32_t idx, SCTime_t ts)
 {
-    XBit *fb = IPPairBitGet(h, idx);
-    if (fb == NULL) {
+    XBitArray *xa = IPPairGetStorageById(h, g_ippair_bit_storage_id);
+    int pos = XBitArrayFind(xa, idx);
+    if (pos == -1) {
         return 1;
     }
 
-    if (SCTIME_CMP_LT(fb->expire, ts)) {
-        IPPairBitRemove(h, idx);
+    if (SCTIME_CMP_LT(xa->expire[pos], ts)) {
+        XBitArrayRemove(&xa, (uint32_t)pos);
+        IPPairSetStorageById(h, g_ippair_bit_storage_id, xa);
         return 1;
     }
-
     return 0;
 }
 
-
 /* TESTS */
 #ifdef UNITTESTS
 static int IPPairBitTest01 (void)
@@ -198,8 +171,8 @@ static int IPPairBitTest01 (void)
 
     IPPairBitAdd(h, 0, SCTIME_FROM_SECS(0));
 
-    XBit *fb = IPPairBitGet(h,0);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,0);
+    FAIL_IF(fb == -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -217,8 +190,8 @@ static int IPPairBitTest02 (void)
     IPPair *h = IPPairAlloc();
     FAIL_IF_NULL(h);
 
-    XBit *fb = IPPairBitGet(h,0);
-    FAIL_IF_NOT_NULL(fb);
+    int fb = IPPairBitGet(h,0);
+    FAIL_IF(fb != -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -238,13 +211,13 @@ static int IPPairBitTest03 (void)
 
     IPPairBitAdd(h, 0, SCTIME_FROM_SECS(30));
 
-    XBit *fb = IPPairBitGet(h,0);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,0);
+    FAIL_IF(fb == -1);
 
     IPPairBitRemove(h, 0);
 
     fb = IPPairBitGet(h,0);
-    FAIL_IF_NOT_NULL(fb);
+    FAIL_IF(fb != -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -267,8 +240,8 @@ static int IPPairBitTest04 (void)
     IPPairBitAdd(h, 2, SCTIME_FROM_SECS(30));
     IPPairBitAdd(h, 3, SCTIME_FROM_SECS(30));
 
-    XBit *fb = IPPairBitGet(h,0);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,0);
+    FAIL_IF(fb == -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -291,8 +264,8 @@ static int IPPairBitTest05 (void)
     IPPairBitAdd(h, 2, SCTIME_FROM_SECS(90));
     IPPairBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = IPPairBitGet(h,1);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,1);
+    FAIL_IF(fb == -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -315,8 +288,8 @@ static int IPPairBitTest06 (void)
     IPPairBitAdd(h, 2, SCTIME_FROM_SECS(90));
     IPPairBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = IPPairBitGet(h,2);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,2);
+    FAIL_IF(fb == -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -339,8 +312,8 @@ static int IPPairBitTest07 (void)
     IPPairBitAdd(h, 2, SCTIME_FROM_SECS(90));
     IPPairBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = IPPairBitGet(h,3);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,3);
+    FAIL_IF(fb == -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -363,13 +336,13 @@ static int IPPairBitTest08 (void)
     IPPairBitAdd(h, 2, SCTIME_FROM_SECS(90));
     IPPairBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = IPPairBitGet(h,0);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,0);
+    FAIL_IF(fb == -1);
 
     IPPairBitRemove(h,0);
 
     fb = IPPairBitGet(h,0);
-    FAIL_IF_NOT_NULL(fb);
+    FAIL_IF(fb != -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -392,13 +365,13 @@ static int IPPairBitTest09 (void)
     IPPairBitAdd(h, 2, SCTIME_FROM_SECS(90));
     IPPairBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = IPPairBitGet(h,1);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,1);
+    FAIL_IF(fb == -1);
 
     IPPairBitRemove(h,1);
 
     fb = IPPairBitGet(h,1);
-    FAIL_IF_NOT_NULL(fb);
+    FAIL_IF(fb != -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -421,13 +394,13 @@ static int IPPairBitTest10 (void)
     IPPairBitAdd(h, 2, SCTIME_FROM_SECS(90));
     IPPairBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = IPPairBitGet(h,2);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,2);
+    FAIL_IF(fb == -1);
 
     IPPairBitRemove(h,2);
 
     fb = IPPairBitGet(h,2);
-    FAIL_IF_NOT_NULL(fb);
+    FAIL_IF(fb != -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -450,13 +423,13 @@ static int IPPairBitTest11 (void)
     IPPairBitAdd(h, 2, SCTIME_FROM_SECS(90));
     IPPairBitAdd(h, 3, SCTIME_FROM_SECS(90));
 
-    XBit *fb = IPPairBitGet(h,3);
-    FAIL_IF_NULL(fb);
+    int fb = IPPairBitGet(h,3);
+    FAIL_IF(fb == -1);
 
     IPPairBitRemove(h,3);
 
     fb = IPPairBitGet(h,3);
-    FAIL_IF_NOT_NULL(fb);
+    FAIL_IF(fb != -1);
 
     IPPairFree(h);
     IPPairShutdown();
@@ -82,6 +82,7 @@ static uint32_t IPPairHashRowTimeout(IPPairHashRow *hb, IPPair *h, SCTime_t ts)
          * ready to be discarded. */
         if (IPPairTimedOut(h, ts) == 1) {
             /* remove from the hash */
+            IPPairRowWriteBegin(hb);
             if (h->hprev != NULL)
                 h->hprev->hnext = h->hnext;
             if (h->hnext != NULL)
@@ -93,6 +94,7 @@ static uint32_t IPPairHashRowTimeout(IPPairHashRow *hb, IPPair *h, SCTime_t ts)
 
             h->hnext = NULL;
             h->hprev = NULL;
+            IPPairRowWriteEnd(hb);
 
             IPPairClearMemory (h);
 
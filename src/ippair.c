@@ -236,6 +236,7 @@ void IPPairInitConfig(bool quiet)
     uint32_t i = 0;
     for (i = 0; i < ippair_config.hash_size; i++) {
         HRLOCK_INIT(&ippair_hash[i]);
+        SC_ATOMIC_INIT(ippair_hash[i].seq);
     }
     (void) SC_ATOMIC_ADD(ippair_memuse, (ippair_config.hash_size * sizeof(IPPairHashRow)));
 
@@ -339,6 +340,7 @@ void IPPairCleanup(void)
                 } else {
                     IPPair *n = h->hnext;
                     /* remove from the hash */
+                    IPPairRowWriteBegin(hb);
                     if (h->hprev != NULL)
                         h->hprev->hnext = h->hnext;
                     if (h->hnext != NULL)
@@ -349,6 +351,7 @@ void IPPairCleanup(void)
                         hb->tail = h->hprev;
                     h->hnext = NULL;
                     h->hprev = NULL;
+                    IPPairRowWriteEnd(hb);
                     IPPairClearMemory(h);
                     IPPairMoveToSpare(h);
                     h = n;
@@ -510,6 +513,65 @@ void IPPairUnlock(IPPair *h)
     SCMutexUnlock(&h->m);
 }
 
+#define IPPAIR_OPTIMISTIC_TRIES     4
+#define IPPAIR_OPTIMISTIC_MAX_STEPS 64
+
+/** \internal
+ *  \brief look up a ippair without taking the row lock
+ *
+ *  Reader side of the row seqlock. IPPairs are never freed while the hash
+ *  exists, only moved to the spare queue, so following stale pointers is
+ *  harmless. A found ippair is only returned if the row is still unchanged
+ *  once the ippair is locked: at runtime a ippair is only removed from the hash
+ *  while it is locked, so it is then still in the hash.
+ *
+ *  Unlike the locked lookup this doesn't move the ippair to the front of the
+ *  row, so concurrent lookups of the same ippair don't write to the row.
+ *
+ *  \param stable set to true if the result is reliable, false if the row
+ *                kept changing and the caller needs to take the row lock
+ *
+ *  \retval h *LOCKED* ippair or NULL
+ */
+static IPPair *IPPairLookupOptimistic(IPPairHashRow *hb, Address *a, Address *b, bool *stable)
+{
+    for (int tries = 0; tries < IPPAIR_OPTIMISTIC_TRIES; tries++) {
+        const uint32_t seq = SC_ATOMIC_LOAD_EXPLICIT(hb->seq, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (seq & 1)
+            continue;
+
+        IPPair *h = hb->head;
+        uint32_t steps = 0;
+        while (h != NULL && steps < IPPAIR_OPTIMISTIC_MAX_STEPS && IPPairCompare(h, a, b) == 0) {
+            h = h->hnext;
+            steps++;
+        }
+
+        SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (SC_ATOMIC_LOAD_EXPLICIT(hb->seq, SC_ATOMIC_MEMORY_ORDER_RELAXED) != seq ||
+                steps == IPPAIR_OPTIMISTIC_MAX_STEPS)
+            continue;
+        if (h == NULL) {
+            *stable = true;
+            return NULL;
+        }
+
+        SCMutexLock(&h->m);
+        /* a recycled ippair gets its new address after it is linked in, so
+         * check the address again now that we hold the lock */
+        SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (SC_ATOMIC_LOAD_EXPLICIT(hb->seq, SC_ATOMIC_MEMORY_ORDER_RELAXED) == seq &&
+                IPPairCompare(h, a, b) != 0) {
+            (void)IPPairIncrUsecnt(h);
+            *stable = true;
+            return h;
+        }
+        SCMutexUnlock(&h->m);
+    }
+    *stable = false;
+    return NULL;
+}
+
 /* IPPairGetIPPairFromHash
  *
  * Hash retrieval function for ippairs. Looks up the hash bucket containing the
@@ -526,6 +588,13 @@ IPPair *IPPairGetIPPairFromHash (Address *a, Address *b)
     uint32_t key = IPPairGetKey(a, b);
     /* get our hash bucket and lock it */
     IPPairHashRow *hb = &ippair_hash[key];
+
+    /* most lookups are for existing ippairs, try without the row lock first */
+    bool stable = false;
+    h = IPPairLookupOptimistic(hb, a, b, &stable);
+    if (h != NULL)
+        return h;
+
     HRLOCK_LOCK(hb);
 
     /* see if the bucket already has a ippair */
@@ -537,8 +606,10 @@ IPPair *IPPairGetIPPairFromHash (Address *a, Address *b)
         }
 
         /* ippair is locked */
+        IPPairRowWriteBegin(hb);
         hb->head = h;
         hb->tail = h;
+        IPPairRowWriteEnd(hb);
 
         /* got one, now lock, initialize and return */
         IPPairInit(h,a,b);
@@ -559,16 +630,19 @@ IPPair *IPPairGetIPPairFromHash (Address *a, Address *b)
             h = h->hnext;
 
             if (h == NULL) {
-                h = ph->hnext = IPPairGetNew(a,b);
+                h = IPPairGetNew(a,b);
                 if (h == NULL) {
                     HRLOCK_UNLOCK(hb);
                     return NULL;
                 }
-                hb->tail = h;
 
                 /* ippair is locked */
 
+                IPPairRowWriteBegin(hb);
+                ph->hnext = h;
+                hb->tail = h;
                 h->hprev = ph;
+                IPPairRowWriteEnd(hb);
 
                 /* initialize and return */
                 IPPairInit(h,a,b);
@@ -580,6 +654,7 @@ IPPair *IPPairGetIPPairFromHash (Address *a, Address *b)
             if (IPPairCompare(h, a, b) != 0) {
                 /* we found our ippair, lets put it on top of the
                  * hash list -- this rewards active ippairs */
+                IPPairRowWriteBegin(hb);
                 if (h->hnext) {
                     h->hnext->hprev = h->hprev;
                 }
@@ -594,6 +669,7 @@ IPPair *IPPairGetIPPairFromHash (Address *a, Address *b)
                 h->hprev = NULL;
                 hb->head->hprev = h;
                 hb->head = h;
+                IPPairRowWriteEnd(hb);
 
                 /* found our ippair, lock & return */
                 SCMutexLock(&h->m);
@@ -625,6 +701,12 @@ IPPair *IPPairLookupIPPairFromHash (Address *a, Address *b)
     uint32_t key = IPPairGetKey(a, b);
     /* get our hash bucket and lock it */
     IPPairHashRow *hb = &ippair_hash[key];
+
+    bool stable = false;
+    h = IPPairLookupOptimistic(hb, a, b, &stable);
+    if (stable)
+        return h;
+
     HRLOCK_LOCK(hb);
 
     /* see if the bucket already has a ippair */
@@ -649,6 +731,7 @@ IPPair *IPPairLookupIPPairFromHash (Address *a, Address *b)
             if (IPPairCompare(h, a, b) != 0) {
                 /* we found our ippair, lets put it on top of the
                  * hash list -- this rewards active ippairs */
+                IPPairRowWriteBegin(hb);
                 if (h->hnext) {
                     h->hnext->hprev = h->hprev;
                 }
@@ -663,6 +746,7 @@ IPPair *IPPairLookupIPPairFromHash (Address *a, Address *b)
                 h->hprev = NULL;
                 hb->head->hprev = h;
                 hb->head = h;
+                IPPairRowWriteEnd(hb);
 
                 /* found our ippair, lock & return */
                 SCMutexLock(&h->m);
@@ -725,6 +809,7 @@ static IPPair *IPPairGetUsedIPPair(void)
         }
 
         /* remove from the hash */
+        IPPairRowWriteBegin(hb);
         if (h->hprev != NULL)
             h->hprev->hnext = h->hnext;
         if (h->hnext != NULL)
@@ -736,6 +821,7 @@ static IPPair *IPPairGetUsedIPPair(void)
 
         h->hnext = NULL;
         h->hprev = NULL;
+        IPPairRowWriteEnd(hb);
         HRLOCK_UNLOCK(hb);
 
         IPPairClearMemory (h);
@@ -749,7 +835,157 @@ static IPPair *IPPairGetUsedIPPair(void)
     return NULL;
 }
 
+#ifdef UNITTESTS
+#include "util-unittest.h"
+
+static void IPPairTestAddress(Address *a, uint32_t ip)
+{
+    memset(a, 0, sizeof(*a));
+    a->family = AF_INET;
+    a->addr_data32[0] = ip;
+}
+
+/** \test optimistic lookup finds an existing ippair and reports a miss as stable */
+static int IPPairLookupOptimisticTest01(void)
+{
+    StorageCleanup();
+    StorageInit();
+    StorageFinalize();
+    IPPairInitConfig(true);
+
+    Address a, b, c;
+    IPPairTestAddress(&a, 0x01020304);
+    IPPairTestAddress(&b, 0x0b0b0b0b);
+    IPPairTestAddress(&c, 0x05060708);
+    IPPair *h = IPPairGetIPPairFromHash(&a, &b);
+    FAIL_IF_NULL(h);
+    IPPairRelease(h);
+
+    bool stable = false;
+    IPPair *h2 = IPPairLookupOptimistic(&ippair_hash[IPPairGetKey(&a, &b)], &a, &b, &stable);
+    FAIL_IF_NOT(h2 == h);
+    FAIL_IF_NOT(stable);
+    FAIL_IF_NOT(SC_ATOMIC_GET(h->use_cnt) == 1);
+    IPPairRelease(h2);
+
+    stable = false;
+    h2 = IPPairLookupOptimistic(&ippair_hash[IPPairGetKey(&c, &b)], &c, &b, &stable);
+    FAIL_IF_NOT_NULL(h2);
+    FAIL_IF_NOT(stable);
+
+    IPPairShutdown();
+    StorageCleanup();
+    PASS;
+}
+
+/** \test a row that is being modified makes the optimistic lookup give up,
+ *        the lookup functions then fall back to the locked lookup */
+static int IPPairLookupOptimisticTest02(void)
+{
+    StorageCleanup();
+    StorageInit();
+    StorageFinalize();
+    IPPairInitConfig(true);
+
+    Address a, b, c;
+    IPPairTestAddress(&a, 0x01020304);
+    IPPairTestAddress(&b, 0x0b0b0b0b);
+    IPPairTestAddress(&c, 0x05060708);
+    IPPair *h = IPPairGetIPPairFromHash(&a, &b);
+    FAIL_IF_NULL(h);
+    IPPairRelease(h);
+
+    IPPairHashRow *hb = &ippair_hash[IPPairGetKey(&a, &b)];
+    IPPairRowWriteBegin(hb);
+    bool stable = true;
+    IPPair *h2 = IPPairLookupOptimistic(hb, &a, &b, &stable);
+    FAIL_IF_NOT_NULL(h2);
+    FAIL_IF(stable);
+
+    h2 = IPPairLookupIPPairFromHash(&a, &b);
+    FAIL_IF_NOT(h2 == h);
+    IPPairRelease(h2);
+    h2 = IPPairGetIPPairFromHash(&a, &b);
+    FAIL_IF_NOT(h2 == h);
+    IPPairRelease(h2);
+    IPPairRowWriteEnd(hb);
+
+    /* the row changed since the first lookup, but is stable again */
+    h2 = IPPairLookupOptimistic(hb, &a, &b, &stable);
+    FAIL_IF_NOT(h2 == h);
+    FAIL_IF_NOT(stable);
+    IPPairRelease(h2);
+
+    IPPairShutdown();
+    StorageCleanup();
+    PASS;
+}
+
+/** \test the optimistic lookup gives up after IPPAIR_OPTIMISTIC_MAX_STEPS steps, the locked
+ *        lookup then moves the ippair to the front of the row */
+static int IPPairLookupOptimisticTest03(void)
+{
+    SCConfCreateContextBackup();
+    SCConfInit();
+    SCConfSet("ippair.hash-size", "1");
+
+    StorageCleanup();
+    StorageInit();
+    StorageFinalize();
+    IPPairInitConfig(true);
+    FAIL_IF_NOT(ippair_config.hash_size == 1);
+
+    Address a, b, c;
+    IPPairTestAddress(&a, 0x01020304);
+    IPPairTestAddress(&b, 0x0b0b0b0b);
+    IPPairTestAddress(&c, 0x05060708);
+    /* new ippairs are added at the tail, put 'a' behind IPPAIR_OPTIMISTIC_MAX_STEPS others */
+    for (uint32_t i = 0; i < IPPAIR_OPTIMISTIC_MAX_STEPS; i++) {
+        Address x;
+        IPPairTestAddress(&x, 0x0a000001 + i);
+        IPPair *o = IPPairGetIPPairFromHash(&x, &b);
+        FAIL_IF_NULL(o);
+        IPPairRelease(o);
+    }
+    IPPair *h = IPPairGetIPPairFromHash(&a, &b);
+    FAIL_IF_NULL(h);
+    IPPairRelease(h);
+    FAIL_IF_NOT(ippair_hash[0].tail == h);
+
+    bool stable = true;
+    IPPair *h2 = IPPairLookupOptimistic(&ippair_hash[0], &a, &b, &stable);
+    FAIL_IF_NOT_NULL(h2);
+    FAIL_IF(stable);
+    /* a miss can't be told apart from a long row either */
+    stable = true;
+    h2 = IPPairLookupOptimistic(&ippair_hash[0], &c, &b, &stable);
+    FAIL_IF_NOT_NULL(h2);
+    FAIL_IF(stable);
+
+    h2 = IPPairLookupIPPairFromHash(&a, &b);
+    FAIL_IF_NOT(h2 == h);
+    IPPairRelease(h2);
+    FAIL_IF_NOT(ippair_hash[0].head == h);
+
+    h2 = IPPairLookupOptimistic(&ippair_hash[0], &a, &b, &stable);
+    FAIL_IF_NOT(h2 == h);
+    FAIL_IF_NOT(stable);
+    IPPairRelease(h2);
+
+    IPPairShutdown();
+    StorageCleanup();
+    SCConfDeInit();
+    SCConfRestoreContextBackup();
+    PASS;
+}
+#endif /* UNITTESTS */
+
 void IPPairRegisterUnittests(void)
 {
     RegisterIPPairStorageTests();
+#ifdef UNITTESTS
+    UtRegisterTest("IPPairLookupOptimisticTest01", IPPairLookupOptimisticTest01);
+    UtRegisterTest("IPPairLookupOptimisticTest02", IPPairLookupOptimisticTest02);
+    UtRegisterTest("IPPairLookupOptimisticTest03", IPPairLookupOptimisticTest03);
+#endif
 }
@@ -79,10 +79,28 @@ typedef struct IPPair_ {
 
 typedef struct IPPairHashRow_ {
     HRLOCK_TYPE lock;
+    /** sequence counter, odd while the row's list is being modified. Used
+     *  by lookups that walk the row without taking the lock. */
+    SC_ATOMIC_DECLARE(uint32_t, seq);
     IPPair *head;
     IPPair *tail;
 } __attribute__((aligned(CLS))) IPPairHashRow;
 
+/** \brief mark the start of a change to the list of a locked row
+ *
+ *  Together with IPPairRowWriteEnd this forms the writer side of a seqlock. */
+static inline void IPPairRowWriteBegin(IPPairHashRow *hb)
+{
+    (void)SC_ATOMIC_ADD(hb->seq, 1);
+    SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_RELEASE);
+}
+
+static inline void IPPairRowWriteEnd(IPPairHashRow *hb)
+{
+    SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_RELEASE);
+    (void)SC_ATOMIC_ADD(hb->seq, 1);
+}
+
 /** ippair hash table */
 extern IPPairHashRow *ippair_hash;
 
@@ -301,35 +301,43 @@ static void EveAddFlowVars(const Flow *f, SCJsonBuilder *js_root, SCJsonBuilder
                 }
             }
         } else if (gv->type == DETECT_FLOWBITS) {
-            FlowBit *fb = (FlowBit *)gv;
-            const char *varname = VarNameStoreLookupById(fb->idx,
-                    VAR_TYPE_FLOW_BIT);
-            if (varname) {
-                if (SCStringHasPrefix(varname, TRAFFIC_ID_PREFIX)) {
-                    if (js_traffic_id == NULL) {
-                        js_traffic_id = SCJbNewArray();
-                        if (unlikely(js_traffic_id == NULL)) {
-                            break;
+            /* an alloc failure stops the output of all vars, not just the bits */
+            bool alloc_failed = false;
+            for (uint32_t idx = 0; FlowBitGetNext(f, &idx); idx++) {
+                const char *varname = VarNameStoreLookupById(idx, VAR_TYPE_FLOW_BIT);
+                if (varname) {
+                    if (SCStringHasPrefix(varname, TRAFFIC_ID_PREFIX)) {
+                        if (js_traffic_id == NULL) {
+                            js_traffic_id = SCJbNewArray();
+                            if (unlikely(js_traffic_id == NULL)) {
+                                alloc_failed = true;
+                                break;
+                            }
                         }
-                    }
-                    SCJbAppendString(js_traffic_id, &varname[traffic_id_prefix_len]);
-                } else if (SCStringHasPrefix(varname, TRAFFIC_LABEL_PREFIX)) {
-                    if (js_traffic_label == NULL) {
-                        js_traffic_label = SCJbNewArray();
-                        if (unlikely(js_traffic_label == NULL)) {
-                            break;
+                        SCJbAppendString(js_traffic_id, &varname[traffic_id_prefix_len]);
+                    } else if (SCStringHasPrefix(varname, TRAFFIC_LABEL_PREFIX)) {
+                        if (js_traffic_label == NULL) {
+                            js_traffic_label = SCJbNewArray();
+                            if (unlikely(js_traffic_label == NULL)) {
+                                alloc_failed = true;
+                                break;
+                            }
                         }
+                        SCJbAppendString(js_traffic_label, &varname[traffic_label_prefix_len]);
+                    } else {
+                        if (js_flowbits == NULL) {
+                            js_flowbits = SCJbNewArray();
+                            if (unlikely(js_flowbits == NULL)) {
+                                alloc_failed = true;
+                                break;
+                            }
+                        }
+                        SCJbAppendString(js_flowbits, varname);
                     }
-                    SCJbAppendString(js_traffic_label, &varname[traffic_label_prefix_len]);
-                } else {
-                    if (js_flowbits == NULL) {
-                        js_flowbits = SCJbNewArray();
-                        if (unlikely(js_flowbits == NULL))
-                            break;
-                    }
-                    SCJbAppendString(js_flowbits, varname);
                 }
             }
+            if (alloc_failed)
+                break;
         }
         gv = gv->next;
     }
@@ -1075,6 +1083,13 @@ static int LogFileTypePrepare(
         if (SCConfLogOpenGeneric(conf, json_ctx->file_ctx, DEFAULT_LOG_FILENAME, 1) < 0) {
             return -1;
         }
+        if (json_ctx->file_ctx->is_regular && SCConfNodeChildValueIsTrue(conf, "writer-thread")) {
+            if (json_ctx->file_ctx->threaded) {
+                SCLogConfig("writer-thread setting ignored for threaded output");
+            } else if (LogFileWriterStart(json_ctx->file_ctx) < 0) {
+                return -1;
+            }
+        }
     }
 #ifdef HAVE_LIBHIREDIS
     else if (log_filetype == LOGFILE_TYPE_REDIS) {
@@ -0,0 +1,451 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * IP reputation trie.
+ *
+ * A single path compressed binary trie holds hosts and netblocks of both
+ * IP versions, IPv4 mapped into ::ffff:0:0/96. Each prefix has a sorted
+ * list of (category, score) pairs, so one walk from the root answers a
+ * lookup for any category: the score of the longest prefix that has the
+ * category wins.
+ *
+ * Lookups don't lock. Updates are serialized by the trie lock and never
+ * change a node that readers can reach, other than by atomically setting
+ * a child or score list index to fully initialized data. Nodes and score
+ * lists are not freed until the trie is, so a reader can't follow an index
+ * into freed memory. Score lists replaced by an update stay allocated until
+ * then, which costs a few bytes per update.
+ */
+
+#include "suricata-common.h"
+#include "reputation-trie.h"
+#include "util-debug.h"
+#include "util-mem.h"
+
+#define SREP_TRIE_NODE_CHUNK_SIZE  (1U << SREP_TRIE_NODE_CHUNK_SHIFT)
+#define SREP_TRIE_SCORE_CHUNK_SIZE (1U << SREP_TRIE_SCORE_CHUNK_SHIFT)
+/** a score list is a count followed by at most one entry per category */
+#define SREP_TRIE_MAX_SCORES 256
+
+void SRepTrieInit(SRepTrie *trie)
+{
+    memset(trie, 0, sizeof(*trie));
+    SC_ATOMIC_INIT(trie->root);
+    SCMutexInit(&trie->lock, NULL);
+}
+
+void SRepTrieFree(SRepTrie *trie)
+{
+    if (trie->nodes != NULL) {
+        for (uint32_t i = 0; i < SREP_TRIE_MAX_CHUNKS && trie->nodes[i] != NULL; i++)
+            SCFree(trie->nodes[i]);
+        SCFree(trie->nodes);
+    }
+    if (trie->scores != NULL) {
+        for (uint32_t i = 0; i < SREP_TRIE_MAX_CHUNKS && trie->scores[i] != NULL; i++)
+            SCFree(trie->scores[i]);
+        SCFree(trie->scores);
+    }
+    SCMutexDestroy(&trie->lock);
+    memset(trie, 0, sizeof(*trie));
+}
+
+static inline SRepTrieNode *SRepTrieGetNode(const SRepTrie *trie, const uint32_t idx)
+{
+    return &trie->nodes[idx >> SREP_TRIE_NODE_CHUNK_SHIFT][idx & (SREP_TRIE_NODE_CHUNK_SIZE - 1)];
+}
+
+static inline const uint16_t *SRepTrieGetScores(const SRepTrie *trie, const uint32_t idx)
+{
+    return &trie->scores[idx >> SREP_TRIE_SCORE_CHUNK_SHIFT]
+                        [idx & (SREP_TRIE_SCORE_CHUNK_SIZE - 1)];
+}
+
+/** \internal
+ *  \brief get bit \a bit of a key, counting from the most significant bit */
+static inline int SRepTrieBit(const uint8_t *key, const uint8_t bit)
+{
+    return (key[bit / 8] >> (7 - (bit % 8))) & 1;
+}
+
+static inline bool SRepTriePrefixMatch(const uint8_t *key, const uint8_t *addr, const uint8_t bitlen)
+{
+    const uint8_t bytes = bitlen / 8;
+    if (memcmp(key, addr, bytes) != 0)
+        return false;
+    const uint8_t rem = bitlen % 8;
+    if (rem == 0)
+        return true;
+    const uint8_t mask = (uint8_t)(0xff << (8 - rem));
+    return (key[bytes] & mask) == (addr[bytes] & mask);
+}
+
+/** \internal
+ *  \brief number of leading bits \a a and \a b have in common, up to \a max */
+static uint8_t SRepTrieCommonLen(const uint8_t *a, const uint8_t *b, const uint8_t max)
+{
+    uint8_t len = 0;
+    for (int i = 0; i < 16 && len < max; i++) {
+        uint8_t x = a[i] ^ b[i];
+        if (x == 0) {
+            len += 8;
+            continue;
+        }
+        while ((x & 0x80) == 0) {
+            x <<= 1;
+            len++;
+        }
+        break;
+    }
+    return MIN(len, max);
+}
+
+static void SRepTrieMaskKey(uint8_t *key, const uint8_t bitlen)
+{
+    for (uint8_t i = 0; i < 16; i++) {
+        if (bitlen >= (i + 1) * 8)
+            continue;
+        if (bitlen <= i * 8)
+            key[i] = 0;
+        else
+            key[i] &= (uint8_t)(0xff << (8 - (bitlen % 8)));
+    }
+}
+
+void SRepTrieIPv4ToKey(const uint8_t *ipv4, uint8_t *key)
+{
+    memset(key, 0, 10);
+    key[10] = 0xff;
+    key[11] = 0xff;
+    memcpy(key + 12, ipv4, 4);
+}
+
+/** \internal
+ *  \brief get the score of \a cat from a score list
+ *  \retval score or -1 if the list has no score for the category
+ */
+static inline int8_t SRepTrieScoresGet(const uint16_t *list, const uint8_t cat)
+{
+    for (uint16_t i = 1; i <= list[0]; i++) {
+        const uint8_t c = (uint8_t)(list[i] >> 8);
+        if (c == cat)
+            return (int8_t)(list[i] & 0xff);
+        if (c > cat)
+            break;
+    }
+    return -1;
+}
+
+/**
+ *  \brief look up the score of \a cat for an address
+ *
+ *  \param addr IPv6 address, or IPv4 address mapped by SRepTrieIPv4ToKey
+ *  \retval score of the longest prefix with the category, -1 if none
+ */
+int8_t SRepTrieLookup(SRepTrie *trie, const uint8_t *addr, const uint8_t cat)
+{
+    int8_t rep = -1;
+
+    uint32_t idx = SC_ATOMIC_LOAD_EXPLICIT(trie->root, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+    while (idx != 0) {
+        SRepTrieNode *n = SRepTrieGetNode(trie, idx);
+        if (!SRepTriePrefixMatch(n->key, addr, n->bitlen))
+            break;
+        const uint32_t s = SC_ATOMIC_LOAD_EXPLICIT(n->scores, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (s != 0) {
+            const int8_t v = SRepTrieScoresGet(SRepTrieGetScores(trie, s), cat);
+            if (v >= 0)
+                rep = v;
+        }
+        if (n->bitlen == 128)
+            break;
+        if (SRepTrieBit(addr, n->bitlen))
+            idx = SC_ATOMIC_LOAD_EXPLICIT(n->right, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        else
+            idx = SC_ATOMIC_LOAD_EXPLICIT(n->left, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+    }
+    return rep;
+}
+
+int8_t SRepTrieLookupIPv4(SRepTrie *trie, const uint8_t *ipv4, const uint8_t cat)
+{
+    uint8_t key[16];
+    SRepTrieIPv4ToKey(ipv4, key);
+    return SRepTrieLookup(trie, key, cat);
+}
+
+/** \internal
+ *  \brief allocate a node, index 0 is never handed out as it means 'none'
+ *  \retval idx node index or 0 on error
+ */
+static uint32_t SRepTrieNodeAlloc(SRepTrie *trie, const uint8_t *key, const uint8_t bitlen)
+{
+    if (trie->nodes == NULL) {
+        trie->nodes = SCCalloc(SREP_TRIE_MAX_CHUNKS, sizeof(SRepTrieNode *));
+        if (trie->nodes == NULL)
+            return 0;
+        trie->memuse += SREP_TRIE_MAX_CHUNKS * sizeof(SRepTrieNode *);
+        trie->nodes_used = 1;
+    }
+
+    const uint32_t idx = trie->nodes_used;
+    const uint32_t chunk = idx >> SREP_TRIE_NODE_CHUNK_SHIFT;
+    if (chunk >= SREP_TRIE_MAX_CHUNKS)
+        return 0;
+    if (trie->nodes[chunk] == NULL) {
+        trie->nodes[chunk] = SCCalloc(SREP_TRIE_NODE_CHUNK_SIZE, sizeof(SRepTrieNode));
+        if (trie->nodes[chunk] == NULL)
+            return 0;
+        trie->memuse += SREP_TRIE_NODE_CHUNK_SIZE * sizeof(SRepTrieNode);
+    }
+    trie->nodes_used++;
+
+    SRepTrieNode *n = SRepTrieGetNode(trie, idx);
+    memcpy(n->key, key, sizeof(n->key));
+    n->bitlen = bitlen;
+    SC_ATOMIC_INIT(n->left);
+    SC_ATOMIC_INIT(n->right);
+    SC_ATOMIC_INIT(n->scores);
+    return idx;
+}
+
+/** \internal
+ *  \brief allocate a score list and fill it with \a cnt entries
+ *  \retval idx list index or 0 on error
+ */
+static uint32_t SRepTrieScoresAlloc(SRepTrie *trie, const uint16_t *entries, const uint16_t cnt)
+{
+    if (trie->scores == NULL) {
+        trie->scores = SCCalloc(SREP_TRIE_MAX_CHUNKS, sizeof(uint16_t *));
+        if (trie->scores == NULL)
+            return 0;
+        trie->memuse += SREP_TRIE_MAX_CHUNKS * sizeof(uint16_t *);
+        trie->scores_used = 1;
+    }
+
+    /* a list doesn't cross chunks, skip the rest of the chunk if needed */
+    uint32_t idx = trie->scores_used;
+    const uint32_t left = SREP_TRIE_SCORE_CHUNK_SIZE - (idx & (SREP_TRIE_SCORE_CHUNK_SIZE - 1));
+    if (left < (uint32_t)cnt + 1)
+        idx += left;
+    const uint32_t chunk = idx >> SREP_TRIE_SCORE_CHUNK_SHIFT;
+    if (chunk >= SREP_TRIE_MAX_CHUNKS)
+        return 0;
+    if (trie->scores[chunk] == NULL) {
+        trie->scores[chunk] = SCCalloc(SREP_TRIE_SCORE_CHUNK_SIZE, sizeof(uint16_t));
+        if (trie->scores[chunk] == NULL)
+            return 0;
+        trie->memuse += SREP_TRIE_SCORE_CHUNK_SIZE * sizeof(uint16_t);
+    }
+    trie->scores_used = idx + cnt + 1;
+
+    uint16_t *list = (uint16_t *)SRepTrieGetScores(trie, idx);
+    list[0] = cnt;
+    memcpy(list + 1, entries, cnt * sizeof(uint16_t));
+    return idx;
+}
+
+/** \internal
+ *  \brief new score list for \a n, with \a cat set to \a value or removed
+ *         if \a value is negative.
+ *
+ *  \param idx set to the new list index, 0 for an empty list
+ *  \retval 1 changed, 0 unchanged, -1 error
+ */
+static int SRepTrieScoresUpdate(
+        SRepTrie *trie, SRepTrieNode *n, const uint8_t cat, const int value, uint32_t *idx)
+{
+    uint16_t entries[SREP_TRIE_MAX_SCORES];
+    uint16_t cnt = 0;
+    bool changed = false;
+    bool done = value < 0;
+
+    const uint32_t old = SC_ATOMIC_GET(n->scores);
+    if (old != 0) {
+        const uint16_t *list = SRepTrieGetScores(trie, old);
+        for (uint16_t i = 1; i <= list[0]; i++) {
+            const uint8_t c = (uint8_t)(list[i] >> 8);
+            if (c == cat) {
+                if (value >= 0 && (list[i] & 0xff) == value)
+                    return 0;
+                changed = true;
+                continue;
+            }
+            if (!done && c > cat) {
+                entries[cnt++] = (uint16_t)(cat << 8 | value);
+                changed = done = true;
+            }
+            entries[cnt++] = list[i];
+        }
+    }
+    if (!done) {
+        entries[cnt++] = (uint16_t)(cat << 8 | value);
+        changed = true;
+    }
+    if (!changed)
+        return 0;
+
+    *idx = 0;
+    if (cnt > 0) {
+        *idx = SRepTrieScoresAlloc(trie, entries, cnt);
+        if (*idx == 0)
+            return -1;
+    }
+    return 1;
+}
+
+/** \internal
+ *  \brief set the child of \a parent (or the root) to \a idx */
+static void SRepTrieLink(SRepTrie *trie, const uint32_t parent, const int bit, const uint32_t idx)
+{
+    if (parent == 0) {
+        SC_ATOMIC_SET(trie->root, idx);
+    } else if (bit) {
+        SC_ATOMIC_SET(SRepTrieGetNode(trie, parent)->right, idx);
+    } else {
+        SC_ATOMIC_SET(SRepTrieGetNode(trie, parent)->left, idx);
+    }
+}
+
+static void SRepTrieSetChild(SRepTrieNode *n, const int bit, const uint32_t idx)
+{
+    if (bit) {
+        SC_ATOMIC_SET(n->right, idx);
+    } else {
+        SC_ATOMIC_SET(n->left, idx);
+    }
+}
+
+/** \internal
+ *  \brief create a node for a prefix with a single score */
+static uint32_t SRepTrieNewPrefix(SRepTrie *trie, const uint8_t *key, const uint8_t bitlen,
+        const uint8_t cat, const int value)
+{
+    const uint16_t entry = (uint16_t)(cat << 8 | value);
+    const uint32_t scores = SRepTrieScoresAlloc(trie, &entry, 1);
+    if (scores == 0)
+        return 0;
+    const uint32_t idx = SRepTrieNodeAlloc(trie, key, bitlen);
+    if (idx == 0)
+        return 0;
+    SC_ATOMIC_SET(SRepTrieGetNode(trie, idx)->scores, scores);
+    trie->prefixes++;
+    return idx;
+}
+
+static int SRepTrieSetLocked(SRepTrie *trie, const uint8_t *key, const uint8_t bitlen,
+        const uint8_t cat, const int value)
+{
+    uint32_t parent = 0;
+    int bit = 0;
+    uint32_t idx = SC_ATOMIC_GET(trie->root);
+
+    while (idx != 0) {
+        SRepTrieNode *n = SRepTrieGetNode(trie, idx);
+        const uint8_t common = SRepTrieCommonLen(key, n->key, MIN(bitlen, n->bitlen));
+
+        if (common == n->bitlen && common == bitlen) {
+            /* the prefix is in the trie */
+            uint32_t scores;
+            const uint32_t old = SC_ATOMIC_GET(n->scores);
+            const int r = SRepTrieScoresUpdate(trie, n, cat, value, &scores);
+            if (r == 1) {
+                SC_ATOMIC_SET(n->scores, scores);
+                if (old == 0)
+                    trie->prefixes++;
+                else if (scores == 0)
+                    trie->prefixes--;
+            }
+            return r;
+        }
+        if (common == n->bitlen) {
+            /* node is a shorter prefix of ours, go down */
+            parent = idx;
+            bit = SRepTrieBit(key, n->bitlen);
+            idx = bit ? SC_ATOMIC_GET(n->right) : SC_ATOMIC_GET(n->left);
+            continue;
+        }
+
+        /* our prefix has to be inserted above the node */
+        if (value < 0)
+            return 0;
+        if (common == bitlen) {
+            const uint32_t new_idx = SRepTrieNewPrefix(trie, key, bitlen, cat, value);
+            if (new_idx == 0)
+                return -1;
+            SRepTrieSetChild(SRepTrieGetNode(trie, new_idx), SRepTrieBit(n->key, bitlen), idx);
+            SRepTrieLink(trie, parent, bit, new_idx);
+            return 1;
+        }
+
+        /* prefixes diverge: add a node for the common part with the
+         * existing node and our prefix as children */
+        uint8_t glue_key[16];
+        memcpy(glue_key, key, sizeof(glue_key));
+        SRepTrieMaskKey(glue_key, common);
+        const uint32_t glue_idx = SRepTrieNodeAlloc(trie, glue_key, common);
+        if (glue_idx == 0)
+            return -1;
+        const uint32_t leaf_idx = SRepTrieNewPrefix(trie, key, bitlen, cat, value);
+        if (leaf_idx == 0)
+            return -1;
+        SRepTrieNode *glue = SRepTrieGetNode(trie, glue_idx);
+        SRepTrieSetChild(glue, SRepTrieBit(key, common), leaf_idx);
+        SRepTrieSetChild(glue, SRepTrieBit(n->key, common), idx);
+        SRepTrieLink(trie, parent, bit, glue_idx);
+        return 1;
+    }
+
+    if (value < 0)
+        return 0;
+    const uint32_t new_idx = SRepTrieNewPrefix(trie, key, bitlen, cat, value);
+    if (new_idx == 0)
+        return -1;
+    SRepTrieLink(trie, parent, bit, new_idx);
+    return 1;
+}
+
+/**
+ *  \brief set or remove the score of a category for a prefix
+ *
+ *  Safe to call while other threads look up data in the trie.
+ *
+ *  \param addr IPv6 address, or IPv4 address mapped by SRepTrieIPv4ToKey
+ *  \param bitlen prefix length, 0-128
+ *  \param value score, or -1 to remove the category from the prefix
+ *  \retval 1 trie updated
+ *  \retval 0 nothing to do
+ *  \retval -1 error, out of memory
+ */
+int SRepTrieSet(
+        SRepTrie *trie, const uint8_t *addr, const uint8_t bitlen, const uint8_t cat, const int value)
+{
+    if (bitlen > 128 || value > 0xff)
+        return -1;
+
+    uint8_t key[16];
+    memcpy(key, addr, sizeof(key));
+    SRepTrieMaskKey(key, bitlen);
+
+    SCMutexLock(&trie->lock);
+    const int r = SRepTrieSetLocked(trie, key, bitlen, cat, value);
+    SCMutexUnlock(&trie->lock);
+    return r;
+}
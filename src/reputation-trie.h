@@ -0,0 +1,67 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Path compressed binary trie holding the IP reputation of IPv4 and IPv6
+ * hosts and netblocks, with a list of category scores per prefix.
+ */
+
+#ifndef SURICATA_REPUTATION_TRIE_H
+#define SURICATA_REPUTATION_TRIE_H
+
+#include "threads.h"
+
+/** nodes and scores are allocated in chunks that never move, so that
+ *  lookups can follow node indexes while the trie is updated */
+#define SREP_TRIE_NODE_CHUNK_SHIFT  12
+#define SREP_TRIE_SCORE_CHUNK_SHIFT 16
+#define SREP_TRIE_MAX_CHUNKS        16384
+
+typedef struct SRepTrieNode_ {
+    /** prefix, bits after bitlen are 0. IPv4 is stored as ::ffff:a.b.c.d */
+    uint8_t key[16];
+    uint8_t bitlen;
+    /** child node indexes, 0 if none */
+    SC_ATOMIC_DECLARE(uint32_t, left);
+    SC_ATOMIC_DECLARE(uint32_t, right);
+    /** index of the score list, 0 if the node is not a prefix of the feed */
+    SC_ATOMIC_DECLARE(uint32_t, scores);
+} SRepTrieNode;
+
+typedef struct SRepTrie_ {
+    SC_ATOMIC_DECLARE(uint32_t, root);
+
+    /** writer side, protected by lock */
+    SCMutex lock;
+    SRepTrieNode **nodes;
+    uint32_t nodes_used;
+    uint16_t **scores;
+    uint32_t scores_used;
+    uint32_t prefixes; /**< nodes with scores */
+    uint64_t memuse;
+} SRepTrie;
+
+void SRepTrieInit(SRepTrie *trie);
+void SRepTrieFree(SRepTrie *trie);
+int SRepTrieSet(SRepTrie *trie, const uint8_t *addr, uint8_t bitlen, uint8_t cat, int value);
+int8_t SRepTrieLookup(SRepTrie *trie, const uint8_t *addr, uint8_t cat);
+int8_t SRepTrieLookupIPv4(SRepTrie *trie, const uint8_t *ipv4, uint8_t cat);
+void SRepTrieIPv4ToKey(const uint8_t *ipv4, uint8_t *key);
+
+#endif /* SURICATA_REPUTATION_TRIE_H */
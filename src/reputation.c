@@ -27,6 +27,7 @@
 
 #include "suricata-common.h"
 #include "detect.h"
+#include "detect-engine.h"
 #include "reputation.h"
 #include "threads.h"
 #include "conf.h"
@@ -39,16 +40,9 @@
 #include "util-print.h"
 #include "util-unittest.h"
 #include "util-validate.h"
-#include "util-radix4-tree.h"
-#include "util-radix6-tree.h"
-
-/** effective reputation version, atomic as the host
- *  time out code will use it to check if a host's
- *  reputation info is outdated. */
-SC_ATOMIC_DECLARE(uint32_t, srep_eversion);
-/** reputation version set to the host's reputation,
- *  this will be set to 1 before rep files are loaded,
- *  so hosts will always have a minimal value of 1 */
+
+/** reputation version set to the detect engine, this will be set
+ *  to 1 before rep files are first loaded */
 static uint32_t srep_version = 0;
 
 static uint32_t SRepIncrVersion(void)
@@ -66,70 +60,53 @@ void SRepResetVersion(void)
     srep_version = 0;
 }
 
-static uint32_t SRepGetEffectiveVersion(void)
-{
-    return SC_ATOMIC_GET(srep_eversion);
-}
-
-static void SRepCIDRFreeUserData(void *data)
-{
-    if (data != NULL)
-        SCFree(data);
-}
-
-static SCRadix4Config iprep_radix4_config = { SRepCIDRFreeUserData, NULL };
-static SCRadix6Config iprep_radix6_config = { SRepCIDRFreeUserData, NULL };
-
-static void SRepCIDRAddNetblock(SRepCIDRTree *cidr_ctx, char *ip, int cat, uint8_t value)
+/**
+ *  \brief parse an address or netblock into a trie key
+ *
+ *  \param bitlen set to the prefix length, IPv4 prefixes are mapped into
+ *                ::ffff:0:0/96
+ *  \retval 0 ok, -1 parse error
+ */
+static int SRepParsePrefix(const char *str, uint8_t *key, uint8_t *bitlen)
 {
-    SReputation *user_data = NULL;
-    if ((user_data = SCCalloc(1, sizeof(SReputation))) == NULL) {
-        FatalError("Error allocating memory. Exiting");
+    char ip[64];
+    strlcpy(ip, str, sizeof(ip));
+
+    uint8_t mask = 128;
+    char *slash = strchr(ip, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+        if (StringParseU8RangeCheck(&mask, 10, 0, slash + 1, 0, 128) <= 0)
+            return -1;
     }
 
-    user_data->version = SRepGetVersion();
-    user_data->rep[cat] = value;
-
-    if (strchr(ip, ':') != NULL) {
-        SCLogDebug("adding ipv6 host %s", ip);
-        if (!SCRadix6AddKeyIPV6String(
-                    &cidr_ctx->srep_ipv6_tree[cat], &iprep_radix6_config, ip, (void *)user_data)) {
-            SCFree(user_data);
-            if (sc_errno != SC_EEXIST)
-                SCLogWarning("failed to add ipv6 host %s", ip);
-        }
-
+    struct in_addr in;
+    if (inet_pton(AF_INET, ip, &in) == 1) {
+        if (slash == NULL)
+            mask = 32;
+        else if (mask > 32)
+            return -1;
+        SRepTrieIPv4ToKey((const uint8_t *)&in.s_addr, key);
+        *bitlen = 96 + mask;
+    } else if (inet_pton(AF_INET6, ip, key) == 1) {
+        *bitlen = mask;
     } else {
-        SCLogDebug("adding ipv4 host %s", ip);
-        if (!SCRadix4AddKeyIPV4String(
-                    &cidr_ctx->srep_ipv4_tree[cat], &iprep_radix4_config, ip, (void *)user_data)) {
-            SCFree(user_data);
-            if (sc_errno != SC_EEXIST)
-                SCLogWarning("failed to add ipv4 host %s", ip);
-        }
-    }
-}
-
-static int8_t SRepCIDRGetIPv4IPRep(SRepCIDRTree *cidr_ctx, uint8_t *ipv4_addr, uint8_t cat)
-{
-    void *user_data = NULL;
-    (void)SCRadix4TreeFindBestMatch(&cidr_ctx->srep_ipv4_tree[cat], ipv4_addr, &user_data);
-    if (user_data == NULL)
         return -1;
-
-    SReputation *r = (SReputation *)user_data;
-    return r->rep[cat];
+    }
+    return 0;
 }
 
-static int8_t SRepCIDRGetIPv6IPRep(SRepCIDRTree *cidr_ctx, uint8_t *ipv6_addr, uint8_t cat)
+static void SRepCIDRAddNetblock(SRepCIDRTree *cidr_ctx, char *ip, int cat, uint8_t value)
 {
-    void *user_data = NULL;
-    (void)SCRadix6TreeFindBestMatch(&cidr_ctx->srep_ipv6_tree[cat], ipv6_addr, &user_data);
-    if (user_data == NULL)
-        return -1;
-
-    SReputation *r = (SReputation *)user_data;
-    return r->rep[cat];
+    uint8_t key[16];
+    uint8_t bitlen;
+    if (SRepParsePrefix(ip, key, &bitlen) < 0) {
+        SCLogWarning("failed to parse netblock %s", ip);
+        return;
+    }
+    SCLogDebug("adding netblock %s", ip);
+    if (SRepTrieSet(&cidr_ctx->trie, key, bitlen, (uint8_t)cat, value) < 0)
+        SCLogWarning("failed to add netblock %s", ip);
 }
 
 int8_t SRepCIDRGetIPRepSrc(SRepCIDRTree *cidr_ctx, Packet *p, uint8_t cat, uint32_t version)
@@ -137,9 +114,9 @@ int8_t SRepCIDRGetIPRepSrc(SRepCIDRTree *cidr_ctx, Packet *p, uint8_t cat, uint3
     int8_t rep = -3;
 
     if (PacketIsIPv4(p))
-        rep = SRepCIDRGetIPv4IPRep(cidr_ctx, (uint8_t *)GET_IPV4_SRC_ADDR_PTR(p), cat);
+        rep = SRepTrieLookupIPv4(&cidr_ctx->trie, (uint8_t *)GET_IPV4_SRC_ADDR_PTR(p), cat);
     else if (PacketIsIPv6(p))
-        rep = SRepCIDRGetIPv6IPRep(cidr_ctx, (uint8_t *)GET_IPV6_SRC_ADDR(p), cat);
+        rep = SRepTrieLookup(&cidr_ctx->trie, (uint8_t *)GET_IPV6_SRC_ADDR(p), cat);
 
     return rep;
 }
@@ -149,66 +126,13 @@ int8_t SRepCIDRGetIPRepDst(SRepCIDRTree *cidr_ctx, Packet *p, uint8_t cat, uint3
     int8_t rep = -3;
 
     if (PacketIsIPv4(p))
-        rep = SRepCIDRGetIPv4IPRep(cidr_ctx, (uint8_t *)GET_IPV4_DST_ADDR_PTR(p), cat);
+        rep = SRepTrieLookupIPv4(&cidr_ctx->trie, (uint8_t *)GET_IPV4_DST_ADDR_PTR(p), cat);
     else if (PacketIsIPv6(p))
-        rep = SRepCIDRGetIPv6IPRep(cidr_ctx, (uint8_t *)GET_IPV6_DST_ADDR(p), cat);
+        rep = SRepTrieLookup(&cidr_ctx->trie, (uint8_t *)GET_IPV6_DST_ADDR(p), cat);
 
     return rep;
 }
 
-/** \brief Increment effective reputation version after
- *         a rule/reputation reload is complete. */
-void SRepReloadComplete(void)
-{
-    (void) SC_ATOMIC_ADD(srep_eversion, 1);
-    SCLogDebug("effective Reputation version %u", SRepGetEffectiveVersion());
-}
-
-void SRepFreeHostData(Host *h)
-{
-    SCFree(h->iprep);
-    h->iprep = NULL;
-    DEBUG_VALIDATE_BUG_ON(SC_ATOMIC_GET(h->use_cnt) != 1);
-    HostDecrUsecnt(h);
-}
-
-/** \brief Set effective reputation version after
- *         reputation initialization is complete. */
-static void SRepInitComplete(void)
-{
-    (void) SC_ATOMIC_SET(srep_eversion, 1);
-    SCLogDebug("effective Reputation version %u", SRepGetEffectiveVersion());
-}
-
-/** \brief Check if a Host is timed out wrt ip rep, meaning a new
- *         version is in place.
- *
- *  We clean up the old version here.
- *
- *  \param h host
- *
- *  \retval 0 not timed out
- *  \retval 1 timed out
- */
-int SRepHostTimedOut(Host *h)
-{
-    BUG_ON(h == NULL);
-
-    if (h->iprep == NULL)
-        return 1;
-
-    uint32_t eversion = SRepGetEffectiveVersion();
-    SReputation *r = h->iprep;
-    if (r->version < eversion) {
-        SCLogDebug("host %p has reputation version %u, "
-                "effective version is %u", h, r->version, eversion);
-        SRepFreeHostData(h);
-        return 1;
-    }
-
-    return 0;
-}
-
 static int SRepCatSplitLine(char *line, uint8_t *cat, char *shortname, size_t shortname_len)
 {
     size_t line_len = strlen(line);
@@ -463,48 +387,16 @@ int SRepLoadFileFromFD(SRepCIDRTree *cidr_ctx, FILE *fp)
                 SCLogDebug("%s %u %u", ipstr, cat, value);
             }
 
-            Host *h = HostGetHostFromHash(&a);
-            if (h == NULL) {
-                SCLogError("failed to get a host, increase host.memcap");
-                break;
+            /* hosts are stored as full length prefixes */
+            uint8_t key[16];
+            if (a.family == AF_INET) {
+                SRepTrieIPv4ToKey((const uint8_t *)&a.address, key);
             } else {
-                //SCLogInfo("host %p", h);
-
-                if (h->iprep == NULL) {
-                    h->iprep = SCCalloc(1, sizeof(SReputation));
-                    if (h->iprep != NULL) {
-                        HostIncrUsecnt(h);
-                    }
-                }
-                if (h->iprep != NULL) {
-                    SReputation *rep = h->iprep;
-
-                    /* if version is outdated, it's an older entry that we'll
-                     * now replace. */
-                    if (rep->version != SRepGetVersion()) {
-                        memset(rep, 0x00, sizeof(SReputation));
-                    }
-
-                    rep->version = SRepGetVersion();
-                    rep->rep[cat] = value;
-
-                    SCLogDebug("host %p iprep %p setting cat %u to value %u",
-                        h, h->iprep, cat, value);
-#ifdef DEBUG
-                    if (SCLogDebugEnabled()) {
-                        int i;
-                        for (i = 0; i < SREP_MAX_CATS; i++) {
-                            if (rep->rep[i] == 0)
-                                continue;
-
-                            SCLogDebug("--> host %p iprep %p cat %d to value %u",
-                                    h, h->iprep, i, rep->rep[i]);
-                        }
-                    }
-#endif
-                }
-
-                HostRelease(h);
+                memcpy(key, &a.address, sizeof(key));
+            }
+            if (SRepTrieSet(&cidr_ctx->trie, key, 128, cat, value) < 0) {
+                SCLogError("failed to add reputation data, out of memory");
+                break;
             }
         }
     }
@@ -573,16 +465,11 @@ int SRepInit(DetectEngineCtx *de_ctx)
     de_ctx->srepCIDR_ctx = (SRepCIDRTree *)SCCalloc(1, sizeof(SRepCIDRTree));
     if (de_ctx->srepCIDR_ctx == NULL)
         exit(EXIT_FAILURE);
-
-    for (int i = 0; i < SREP_MAX_CATS; i++) {
-        de_ctx->srepCIDR_ctx->srep_ipv4_tree[i] = SCRadix4TreeInitialize();
-        de_ctx->srepCIDR_ctx->srep_ipv6_tree[i] = SCRadix6TreeInitialize();
-    }
+    SRepTrieInit(&de_ctx->srepCIDR_ctx->trie);
 
     SRepCIDRTree *cidr_ctx = de_ctx->srepCIDR_ctx;
 
     if (SRepGetVersion() == 0) {
-        SC_ATOMIC_INIT(srep_eversion);
         init = 1;
     }
 
@@ -636,28 +523,79 @@ int SRepInit(DetectEngineCtx *de_ctx)
         }
     }
 
-    /* Set effective rep version.
-     * On live reload we will handle this after de_ctx has been swapped */
-    if (init) {
-        SRepInitComplete();
-    }
-
-    HostPrintStats();
+    SCLogConfig("IP reputation: %u prefixes using %" PRIu64 " bytes", cidr_ctx->trie.prefixes,
+            cidr_ctx->trie.memuse);
     return 0;
 }
 
 void SRepDestroy(DetectEngineCtx *de_ctx)
 {
     if (de_ctx->srepCIDR_ctx != NULL) {
-        for (int i = 0; i < SREP_MAX_CATS; i++) {
-            SCRadix4TreeRelease(&de_ctx->srepCIDR_ctx->srep_ipv4_tree[i], &iprep_radix4_config);
-            SCRadix6TreeRelease(&de_ctx->srepCIDR_ctx->srep_ipv6_tree[i], &iprep_radix6_config);
-        }
+        SRepTrieFree(&de_ctx->srepCIDR_ctx->trie);
         SCFree(de_ctx->srepCIDR_ctx);
         de_ctx->srepCIDR_ctx = NULL;
     }
 }
 
+struct SRepUpdateCtx {
+    uint8_t key[16];
+    uint8_t bitlen;
+    uint8_t cat;
+    int value;
+    int result;
+};
+
+static void SRepUpdateEngine(DetectEngineCtx *de_ctx, void *data)
+{
+    struct SRepUpdateCtx *ctx = data;
+    if (de_ctx->srepCIDR_ctx == NULL || ctx->result < 0)
+        return;
+
+    int r = SRepTrieSet(&de_ctx->srepCIDR_ctx->trie, ctx->key, ctx->bitlen, ctx->cat, ctx->value);
+    if (r < 0)
+        ctx->result = SREP_UPDATE_NO_MEM;
+    else
+        ctx->result += r;
+}
+
+/**
+ *  \brief set or remove the reputation of a host or netblock in the
+ *         loaded detect engines
+ *
+ *  Updates are visible to the detection threads right away, but are lost
+ *  on the next rule reload: they need to go into the reputation files as
+ *  well to be permanent.
+ *
+ *  \param ip address or netblock
+ *  \param category category shortname
+ *  \param value reputation value, or -1 to remove it
+ *  \retval r number of engines changed, or a negative SREP_UPDATE_* error
+ */
+int SRepUpdate(const char *ip, const char *category, int value)
+{
+    struct SRepUpdateCtx ctx = { .value = value };
+
+    if (value < -1 || value > SREP_MAX_VAL)
+        return SREP_UPDATE_BAD_VALUE;
+    if (SRepParsePrefix(ip, ctx.key, &ctx.bitlen) < 0)
+        return SREP_UPDATE_BAD_IP;
+
+    bool found = false;
+    for (uint8_t cat = 0; cat < SREP_MAX_CATS; cat++) {
+        if (strlen(srep_cat_table[cat]) > 0 && strcmp(srep_cat_table[cat], category) == 0) {
+            ctx.cat = cat;
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+        return SREP_UPDATE_BAD_CAT;
+
+    DetectEngineForEach(SRepUpdateEngine, &ctx);
+    SCLogDebug("%s %s/%u: %d", ip, category, ctx.cat, ctx.result);
+    return ctx.result;
+}
+
 #ifdef UNITTESTS
 #include "tests/reputation.c"
 #endif
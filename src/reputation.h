@@ -31,27 +31,18 @@ uint8_t SCSRepCatGetByShortname(const char *shortname);
 #ifndef SURICATA_BINDGEN_H
 
 #include "host.h"
-#include "util-radix4-tree.h"
-#include "util-radix6-tree.h"
+#include "reputation-trie.h"
 
 #define SREP_MAX_CATS 60
 #define SREP_MAX_VAL 127
 
+/** reputation of hosts and netblocks of a detect engine */
 typedef struct SRepCIDRTree_ {
-    SCRadix4Tree srep_ipv4_tree[SREP_MAX_CATS];
-    SCRadix6Tree srep_ipv6_tree[SREP_MAX_CATS];
+    SRepTrie trie;
 } SRepCIDRTree;
 
-typedef struct SReputation_ {
-    uint32_t version;
-    uint8_t rep[SREP_MAX_CATS];
-} SReputation;
-
-void SRepFreeHostData(Host *h);
 int SRepInit(struct DetectEngineCtx_ *de_ctx);
 void SRepDestroy(struct DetectEngineCtx_ *de_ctx);
-void SRepReloadComplete(void);
-int SRepHostTimedOut(Host *);
 
 int8_t SRepCIDRGetIPRepSrc(SRepCIDRTree *cidr_ctx, Packet *p, uint8_t cat, uint32_t version);
 int8_t SRepCIDRGetIPRepDst(SRepCIDRTree *cidr_ctx, Packet *p, uint8_t cat, uint32_t version);
@@ -59,6 +50,12 @@ void SRepResetVersion(void);
 int SRepLoadCatFileFromFD(FILE *fp);
 int SRepLoadFileFromFD(SRepCIDRTree *cidr_ctx, FILE *fp);
 
+#define SREP_UPDATE_BAD_IP    -1
+#define SREP_UPDATE_BAD_CAT   -2
+#define SREP_UPDATE_BAD_VALUE -3
+#define SREP_UPDATE_NO_MEM    -4
+int SRepUpdate(const char *ip, const char *category, int value);
+
 void SCReputationRegisterTests(void);
 
 #endif // SURICATA_BINDGEN_H
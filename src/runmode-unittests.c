@@ -38,7 +38,9 @@
 #include "detect-engine-dcepayload.h"
 #include "detect-engine-state.h"
 #include "detect-engine-tag.h"
+#include "detect-engine-threshold.h"
 #include "detect-fast-pattern.h"
+#include "datasets.h"
 #include "flow.h"
 #include "flow-timeout.h"
 #include "flow-manager.h"
@@ -55,6 +57,7 @@
 #include "stream-tcp.h"
 
 #include "app-layer-detect-proto.h"
+#include "app-layer-detect-proto-cache.h"
 #include "app-layer-parser.h"
 #include "app-layer.h"
 #include "app-layer-htp.h"
@@ -91,6 +94,10 @@
 #include "util-byte.h"
 #include "util-proto-name.h"
 #include "util-macset.h"
+#include "util-bloom.h"
+#include "util-countmin.h"
+#include "util-timewheel.h"
+#include "util-logopenfile.h"
 #include "util-flow-rate.h"
 #include "util-memrchr.h"
 
@@ -170,6 +177,7 @@ static void RegisterUnittests(void)
     DecodeMPLSRegisterTests();
     DecodeNSHRegisterTests();
     AppLayerProtoDetectUnittestsRegister();
+    AppLayerProtoCacheRegisterTests();
     SCConfRegisterTests();
     SCConfYamlRegisterTests();
     TmqhFlowRegisterTests();
@@ -199,6 +207,8 @@ static void RegisterUnittests(void)
     MemcmpRegisterTests();
     DetectEngineRegisterTests();
     SCLogRegisterTests();
+    LogFileRegisterTests();
+    DatasetsRegisterTests();
     MagicRegisterTests();
     UtilMiscRegisterTests();
     ThreadingAffinityRegisterTests();
@@ -206,11 +216,15 @@ static void RegisterUnittests(void)
     DetectProtoTests();
     DetectPortTests();
     DetectEngineAlertRegisterTests();
+    ThresholdRegisterTests();
     SCAtomicRegisterTests();
     MemrchrRegisterTests();
     AppLayerUnittestsRegister();
     StreamingBufferRegisterTests();
     MacSetRegisterTests();
+    BloomFilterRegisterTests();
+    CountMinSketchRegisterTests();
+    TimeWheelRegisterTests();
     FlowRateRegisterTests();
 #ifdef OS_WIN32
     Win32SyscallRegisterTests();
@@ -56,6 +56,7 @@
 
 #include "datasets.h"
 #include "datasets-context-json.h"
+#include "reputation.h"
 #include "runmode-unix-socket.h"
 
 int unix_socket_mode_is_running = 0;
@@ -752,6 +753,11 @@ TmEcode UnixSocketDatasetClear(json_t *cmd, json_t *answer, void *data)
         return TM_ECODE_FAILED;
     }
 
+    if (set->compiled != NULL) {
+        json_object_set_new(answer, "message", json_string("dataset is read-only"));
+        return TM_ECODE_FAILED;
+    }
+
     THashCleanup(set->hash);
 
     json_object_set_new(answer, "message", json_string("dataset cleared"));
@@ -807,6 +813,122 @@ TmEcode UnixSocketDatasetLookup(json_t *cmd, json_t *answer, void *data)
     }
 }
 
+/**
+ * \brief Command to add, remove or replace many items of a dataset at once
+ *
+ * \param cmd the content of command Arguments as a json_t object
+ * \param answer the json_t object that has to be used to answer
+ * \param data pointer to data defining the context here a PcapCommand::
+ */
+TmEcode UnixSocketDatasetBulk(json_t *cmd, json_t *answer, void *data)
+{
+    /* 1 get dataset name */
+    json_t *narg = json_object_get(cmd, "setname");
+    if (!json_is_string(narg)) {
+        json_object_set_new(answer, "message", json_string("setname is not a string"));
+        return TM_ECODE_FAILED;
+    }
+    const char *set_name = json_string_value(narg);
+
+    /* 2 get the data type */
+    json_t *targ = json_object_get(cmd, "settype");
+    if (!json_is_string(targ)) {
+        json_object_set_new(answer, "message", json_string("settype is not a string"));
+        return TM_ECODE_FAILED;
+    }
+    const char *type = json_string_value(targ);
+
+    /* 3 get the mode, add by default */
+    enum DatasetBulkMode mode = DATASET_BULK_ADD;
+    json_t *marg = json_object_get(cmd, "mode");
+    if (marg != NULL) {
+        if (!json_is_string(marg)) {
+            json_object_set_new(answer, "message", json_string("mode is not a string"));
+            return TM_ECODE_FAILED;
+        }
+        const char *m = json_string_value(marg);
+        if (strcmp(m, "add") == 0) {
+            mode = DATASET_BULK_ADD;
+        } else if (strcmp(m, "remove") == 0) {
+            mode = DATASET_BULK_REMOVE;
+        } else if (strcmp(m, "replace") == 0) {
+            mode = DATASET_BULK_REPLACE;
+        } else {
+            json_object_set_new(answer, "message", json_string("unknown mode"));
+            return TM_ECODE_FAILED;
+        }
+    }
+
+    /* 4 get the data: a file or the values */
+    json_t *farg = json_object_get(cmd, "datafile");
+    json_t *varg = json_object_get(cmd, "datavalues");
+    if ((farg == NULL) == (varg == NULL)) {
+        json_object_set_new(
+                answer, "message", json_string("one of datafile or datavalues is required"));
+        return TM_ECODE_FAILED;
+    }
+    if ((farg != NULL && !json_is_string(farg)) || (varg != NULL && !json_is_string(varg))) {
+        json_object_set_new(
+                answer, "message", json_string("datafile/datavalues is not a string"));
+        return TM_ECODE_FAILED;
+    }
+
+    SCLogDebug("dataset-bulk: %s type %s mode %d", set_name, type, mode);
+
+    enum DatasetTypes t = DatasetGetTypeFromString(type);
+    if (t == DATASET_TYPE_NOTSET) {
+        json_object_set_new(answer, "message", json_string("unknown settype"));
+        return TM_ECODE_FAILED;
+    }
+
+    Dataset *set = DatasetFind(set_name, t);
+    if (set == NULL) {
+        json_object_set_new(answer, "message", json_string("set not found or wrong type"));
+        return TM_ECODE_FAILED;
+    }
+
+    if (set->compiled != NULL) {
+        json_object_set_new(answer, "message", json_string("dataset is read-only"));
+        return TM_ECODE_FAILED;
+    }
+
+    DatasetBulk *bulk = DatasetBulkStart(set, mode);
+    if (bulk == NULL) {
+        json_object_set_new(answer, "message", json_string("failed to start bulk update"));
+        return TM_ECODE_FAILED;
+    }
+
+    uint32_t failed;
+    if (farg != NULL) {
+        failed = DatasetBulkApplyFile(bulk, json_string_value(farg));
+    } else {
+        failed = DatasetBulkApplyValues(bulk, json_string_value(varg));
+    }
+    DatasetBulkStats stats;
+    DatasetBulkFinish(bulk, failed == 0, &stats);
+
+    if (failed != 0) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "bulk update failed at line %u, %u items added", failed,
+                stats.added);
+        json_object_set_new(answer, "message", json_string(msg));
+        return TM_ECODE_FAILED;
+    }
+
+    json_t *jdata = json_object();
+    if (jdata == NULL) {
+        json_object_set_new(
+                answer, "message", json_string("internal error at json object creation"));
+        return TM_ECODE_FAILED;
+    }
+    json_object_set_new(jdata, "added", json_integer(stats.added));
+    json_object_set_new(jdata, "removed", json_integer(stats.removed));
+    json_object_set_new(jdata, "unchanged", json_integer(stats.unchanged));
+    json_object_set_new(jdata, "invalid", json_integer(stats.invalid));
+    json_object_set_new(answer, "message", jdata);
+    return TM_ECODE_OK;
+}
+
 /**
  * \brief Command to add data to a datajson
  *
@@ -1508,10 +1630,8 @@ TmEcode UnixSocketHostbitList(json_t *cmd, json_t* answer, void *data_unused)
         return TM_ECODE_FAILED;
     }
 
-    XBit *iter = NULL;
-    while (use < 256 && HostBitList(host, &iter) == 1) {
-        bits[use].id = iter->idx;
-        bits[use].expire = iter->expire;
+    uint32_t iter = 0;
+    while (use < 256 && HostBitList(host, &iter, &bits[use].id, &bits[use].expire) == 1) {
         use++;
     }
     HostRelease(host);
@@ -1551,6 +1671,94 @@ TmEcode UnixSocketHostbitList(json_t *cmd, json_t* answer, void *data_unused)
     return TM_ECODE_OK;
 }
 
+static TmEcode IPRepUpdate(json_t *answer, const char *ip, const char *category, int value)
+{
+    int r = SRepUpdate(ip, category, value);
+    switch (r) {
+        case SREP_UPDATE_BAD_IP:
+            json_object_set_new(answer, "message", json_string("invalid address or netblock"));
+            return TM_ECODE_FAILED;
+        case SREP_UPDATE_BAD_CAT:
+            json_object_set_new(answer, "message", json_string("unknown category"));
+            return TM_ECODE_FAILED;
+        case SREP_UPDATE_BAD_VALUE:
+            json_object_set_new(answer, "message", json_string("value out of range"));
+            return TM_ECODE_FAILED;
+        case SREP_UPDATE_NO_MEM:
+            json_object_set_new(answer, "message", json_string("failed to update reputation"));
+            return TM_ECODE_FAILED;
+        case 0:
+            json_object_set_new(answer, "message", json_string("reputation unchanged"));
+            return TM_ECODE_OK;
+        default:
+            json_object_set_new(answer, "message", json_string("reputation updated"));
+            return TM_ECODE_OK;
+    }
+}
+
+/**
+ * \brief Command to set the reputation of a host or netblock
+ *
+ * \param cmd the content of command Arguments as a json_t object
+ * \param answer the json_t object that has to be used to answer
+ */
+TmEcode UnixSocketIPRepAdd(json_t *cmd, json_t *answer, void *data)
+{
+    json_t *jarg = json_object_get(cmd, "ip");
+    if (!json_is_string(jarg)) {
+        json_object_set_new(answer, "message", json_string("ip is not a string"));
+        return TM_ECODE_FAILED;
+    }
+    const char *ip = json_string_value(jarg);
+
+    jarg = json_object_get(cmd, "category");
+    if (!json_is_string(jarg)) {
+        json_object_set_new(answer, "message", json_string("category is not a string"));
+        return TM_ECODE_FAILED;
+    }
+    const char *category = json_string_value(jarg);
+
+    jarg = json_object_get(cmd, "value");
+    if (!json_is_integer(jarg)) {
+        json_object_set_new(answer, "message", json_string("value is not an integer"));
+        return TM_ECODE_FAILED;
+    }
+    json_int_t value = json_integer_value(jarg);
+    if (value < 0 || value > SREP_MAX_VAL) {
+        json_object_set_new(answer, "message", json_string("value out of range"));
+        return TM_ECODE_FAILED;
+    }
+
+    SCLogDebug("iprep-add: %s %s %d", ip, category, (int)value);
+    return IPRepUpdate(answer, ip, category, (int)value);
+}
+
+/**
+ * \brief Command to remove the reputation of a host or netblock
+ *
+ * \param cmd the content of command Arguments as a json_t object
+ * \param answer the json_t object that has to be used to answer
+ */
+TmEcode UnixSocketIPRepRemove(json_t *cmd, json_t *answer, void *data)
+{
+    json_t *jarg = json_object_get(cmd, "ip");
+    if (!json_is_string(jarg)) {
+        json_object_set_new(answer, "message", json_string("ip is not a string"));
+        return TM_ECODE_FAILED;
+    }
+    const char *ip = json_string_value(jarg);
+
+    jarg = json_object_get(cmd, "category");
+    if (!json_is_string(jarg)) {
+        json_object_set_new(answer, "message", json_string("category is not a string"));
+        return TM_ECODE_FAILED;
+    }
+    const char *category = json_string_value(jarg);
+
+    SCLogDebug("iprep-remove: %s %s", ip, category);
+    return IPRepUpdate(answer, ip, category, -1);
+}
+
 static void MemcapBuildValue(uint64_t val, char *str, uint32_t str_len)
 {
     if ((val / (1024 * 1024 * 1024)) != 0) {
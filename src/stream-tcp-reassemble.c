@@ -1598,6 +1598,31 @@ void StreamReassembleRawUpdateProgress(TcpSession *ssn, Packet *p, const uint64_
     SCLogDebug("stream raw progress now %"PRIu64, STREAM_RAW_PROGRESS(stream));
 }
 
+/** \brief get the absolute stream offsets of the packet's data
+ *
+ *  In inline mode the raw stream data passed to the callbacks is a chunk
+ *  around the packet. Data of the chunk outside of the packet was passed
+ *  to the callbacks for earlier packets as well.
+ *
+ *  \retval true packet data is part of the raw stream
+ *  \retval false not inline, packet not added to the stream or packet
+ *                starts before the stream data we still have
+ */
+bool StreamReassembleRawPacketRange(
+        const TcpSession *ssn, const Packet *p, uint64_t *leftedge, uint64_t *rightedge)
+{
+    if (!StreamTcpInlineMode() || p->payload_len == 0 || (p->flags & PKT_STREAM_ADD) == 0)
+        return false;
+
+    const TcpStream *stream = PKT_IS_TOSERVER(p) ? &ssn->client : &ssn->server;
+    const TCPHdr *tcph = PacketGetTCP(p);
+    if (SEQ_LT(TCP_GET_RAW_SEQ(tcph), stream->base_seq))
+        return false;
+    *leftedge = STREAM_BASE_OFFSET(stream) + (TCP_GET_RAW_SEQ(tcph) - stream->base_seq);
+    *rightedge = *leftedge + p->payload_len;
+    return true;
+}
+
 /** \internal
   * \brief get a buffer around the current packet and run the callback on it
   *
@@ -828,6 +828,14 @@ void StreamTcpInitConfig(bool quiet)
     if (!quiet)
         SCLogConfig("stream.reassembly.raw: %s", enable_raw ? "enabled" : "disabled");
 
+    int raw_mpm_incremental = 0;
+    if (SCConfGetBool("stream.reassembly.raw-mpm-incremental", &raw_mpm_incremental) == 1) {
+        stream_config.raw_mpm_incremental = raw_mpm_incremental;
+    }
+    if (!quiet)
+        SCLogConfig("stream.reassembly.raw-mpm-incremental: %s",
+                raw_mpm_incremental ? "enabled" : "disabled");
+
     /* default to true. Not many ppl (correctly) set up host-os policies, so be permissive. */
     stream_config.liberal_timestamps = true;
     int liberal_timestamps = 0;
@@ -76,6 +76,8 @@ typedef struct TcpStreamCnf_ {
 
     uint16_t reassembly_toserver_chunk_size;
     uint16_t reassembly_toclient_chunk_size;
+    /** inline: stream mpm only scans the packet's data, not the whole chunk */
+    bool raw_mpm_incremental;
 
     enum ExceptionPolicy ssn_memcap_policy;
     enum ExceptionPolicy reassembly_memcap_policy;
@@ -152,6 +154,8 @@ int StreamReassembleRaw(TcpSession *ssn, const Packet *p,
         StreamReassembleRawFunc Callback, void *cb_data,
         uint64_t *progress_out, bool respect_inspect_depth);
 void StreamReassembleRawUpdateProgress(TcpSession *ssn, Packet *p, const uint64_t progress);
+bool StreamReassembleRawPacketRange(
+        const TcpSession *ssn, const Packet *p, uint64_t *leftedge, uint64_t *rightedge);
 
 void StreamTcpDetectLogFlush(ThreadVars *tv, StreamTcpThread *stt, Flow *f, Packet *p, PacketQueueNoLock *pq);
 
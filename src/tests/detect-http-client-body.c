@@ -825,6 +825,85 @@ libhtp:\n\
     return RunTest(steps, sig, yaml);
 }
 
+static const char body_window_yaml[] = "\
+%YAML 1.1\n\
+---\n\
+libhtp:\n\
+\n\
+  default-config:\n\
+    personality: IDS\n\
+    request-body-limit: 0\n\
+    response-body-limit: 0\n\
+\n\
+    request-body-inspect-window: 16\n\
+    response-body-inspect-window: 16\n\
+    request-body-minimal-inspect-size: 0\n\
+    response-body-minimal-inspect-size: 0\n\
+";
+
+/** \test pattern spanning 2 chunks is found by the prefilter, which only
+ *        rescans the end of the previous chunk */
+static int DetectEngineHttpClientBodyTest32(void)
+{
+    struct TestSteps steps[] = {
+        {   (const uint8_t *)"GET /index.html HTTP/1.1\r\n"
+            "Host: www.openinfosecfoundation.org\r\n"
+            "Content-Length: 20\r\n"
+            "\r\n"
+            "aaaaaaaaXY",
+            0, STREAM_TOSERVER, 0 },
+        {   (const uint8_t *)"ZWaaaaaaaa",
+            0, STREAM_TOSERVER, 1 },
+        {   NULL, 0, 0, 0 },
+    };
+
+    const char *sig = "alert http any any -> any any (http.request_body; content:\"XYZW\"; sid:1;)";
+    return RunTest(steps, sig, body_window_yaml);
+}
+
+/** \test fast pattern in a chunk the prefilter won't scan again, rest of
+ *        the rule in the next chunk */
+static int DetectEngineHttpClientBodyTest33(void)
+{
+    struct TestSteps steps[] = {
+        {   (const uint8_t *)"GET /index.html HTTP/1.1\r\n"
+            "Host: www.openinfosecfoundation.org\r\n"
+            "Content-Length: 32\r\n"
+            "\r\n"
+            "aaaaaaaaaaaaaaaaXYZWbbbbbbbb",
+            0, STREAM_TOSERVER, 0 },
+        {   (const uint8_t *)"done",
+            0, STREAM_TOSERVER, 1 },
+        {   NULL, 0, 0, 0 },
+    };
+
+    const char *sig = "alert http any any -> any any (http.request_body; content:\"XYZW\"; "
+                      "fast_pattern; content:\"done\"; distance:0; sid:1;)";
+    return RunTest(steps, sig, body_window_yaml);
+}
+
+/** \test fast pattern with offset in the second chunk: the offset is from
+ *        the start of the buffer, so the prefilter has to scan all of it */
+static int DetectEngineHttpClientBodyTest34(void)
+{
+    struct TestSteps steps[] = {
+        {   (const uint8_t *)"GET /index.html HTTP/1.1\r\n"
+            "Host: www.openinfosecfoundation.org\r\n"
+            "Content-Length: 28\r\n"
+            "\r\n"
+            "aaaaaaaaaaaaaaaa",
+            0, STREAM_TOSERVER, 0 },
+        /* buffer starts at body offset 12, so XYZW is at offset 4 */
+        {   (const uint8_t *)"XYZWbbbbbbbb",
+            0, STREAM_TOSERVER, 1 },
+        {   NULL, 0, 0, 0 },
+    };
+
+    const char *sig = "alert http any any -> any any (http.request_body; content:\"XYZW\"; "
+                      "offset:4; sid:1;)";
+    return RunTest(steps, sig, body_window_yaml);
+}
+
 /**
  * \test Test that a signature containing a http_client_body is correctly parsed
  *       and the keyword is registered.
@@ -2996,6 +3075,9 @@ void DetectHttpClientBodyRegisterTests(void)
                    DetectEngineHttpClientBodyTest30);
     UtRegisterTest("DetectEngineHttpClientBodyTest31",
                    DetectEngineHttpClientBodyTest31);
+    UtRegisterTest("DetectEngineHttpClientBodyTest32", DetectEngineHttpClientBodyTest32);
+    UtRegisterTest("DetectEngineHttpClientBodyTest33", DetectEngineHttpClientBodyTest33);
+    UtRegisterTest("DetectEngineHttpClientBodyTest34", DetectEngineHttpClientBodyTest34);
 }
 
 #endif
@@ -27,6 +27,7 @@
 #include "stream-tcp-reassemble.h"
 #include "stream-tcp.h"
 #include "util-unittest-helper.h"
+#include "util-fmemopen.h"
 
 #define TEST_INIT                                                                                  \
     DetectEngineCtx *de_ctx = DetectEngineCtxInit();                                               \
@@ -169,6 +170,83 @@ static int SRepTest08(void)
     PASS;
 }
 
+/** \test hosts and nested netblocks, looked up per category */
+static int SRepTest09(void)
+{
+    TEST_INIT_WITH_PACKET("10.1.2.3");
+    (void)a;
+    (void)cat;
+    (void)value;
+
+    const char *buffer = "10.0.0.0/8,1,10\n"
+                         "10.1.0.0/16,2,20\n"
+                         "10.1.2.3,1,30\n"
+                         "::ffff:10.1.2.4,3,40\n";
+    FILE *fd = SCFmemopen((void *)buffer, strlen(buffer), "r");
+    FAIL_IF_NULL(fd);
+    FAIL_IF(SRepLoadFileFromFD(de_ctx->srepCIDR_ctx, fd) != 0);
+    fclose(fd);
+
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 1, 0) != 30);
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 2, 0) != 20);
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 3, 0) != -1);
+
+    /* IPv4 mapped IPv6 addresses share the IPv4 entries */
+    p->src.addr_data32[0] = UTHSetIPv4Address("10.1.2.4");
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 1, 0) != 10);
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 3, 0) != 40);
+
+    p->src.addr_data32[0] = UTHSetIPv4Address("11.1.2.3");
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 1, 0) != -1);
+
+    TEST_CLEANUP_WITH_PACKET;
+    PASS;
+}
+
+/** \test updates of a loaded trie */
+static int SRepTest10(void)
+{
+    TEST_INIT_WITH_PACKET("192.168.1.1");
+    (void)a;
+    (void)cat;
+    (void)value;
+    SRepTrie *trie = &de_ctx->srepCIDR_ctx->trie;
+
+    uint8_t key[16];
+    uint8_t bitlen;
+    FAIL_IF(SRepParsePrefix("192.168.0.0/16", key, &bitlen) != 0);
+    FAIL_IF(bitlen != 112);
+    FAIL_IF(SRepTrieSet(trie, key, bitlen, 1, 50) != 1);
+    FAIL_IF(SRepTrieSet(trie, key, bitlen, 1, 50) != 0);
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 1, 0) != 50);
+
+    FAIL_IF(SRepParsePrefix("192.168.1.1", key, &bitlen) != 0);
+    FAIL_IF(SRepTrieSet(trie, key, bitlen, 1, 60) != 1);
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 1, 0) != 60);
+
+    /* removing the host exposes the netblock again */
+    FAIL_IF(SRepTrieSet(trie, key, bitlen, 1, -1) != 1);
+    FAIL_IF(SRepTrieSet(trie, key, bitlen, 1, -1) != 0);
+    FAIL_IF(SRepCIDRGetIPRepSrc(de_ctx->srepCIDR_ctx, p, 1, 0) != 50);
+    FAIL_IF(trie->prefixes != 1);
+
+    FAIL_IF(SRepParsePrefix("192.168.0.0/33", key, &bitlen) == 0);
+    FAIL_IF(SRepParsePrefix("2001:db8::/129", key, &bitlen) == 0);
+    FAIL_IF(SRepParsePrefix("foo", key, &bitlen) == 0);
+
+    TEST_CLEANUP_WITH_PACKET;
+    PASS;
+}
+
+/** \test input validation of live updates */
+static int SRepTest11(void)
+{
+    FAIL_IF(SRepUpdate("foo", "BadHosts", 10) != SREP_UPDATE_BAD_IP);
+    FAIL_IF(SRepUpdate("10.0.0.1", "NoSuchCategory", 10) != SREP_UPDATE_BAD_CAT);
+    FAIL_IF(SRepUpdate("10.0.0.1", "BadHosts", SREP_MAX_VAL + 1) != SREP_UPDATE_BAD_VALUE);
+    PASS;
+}
+
 /** Register the following unittests for the Reputation module */
 void SCReputationRegisterTests(void)
 {
@@ -180,4 +258,7 @@ void SCReputationRegisterTests(void)
     UtRegisterTest("SRepTest06", SRepTest06);
     UtRegisterTest("SRepTest07", SRepTest07);
     UtRegisterTest("SRepTest08", SRepTest08);
+    UtRegisterTest("SRepTest09", SRepTest09);
+    UtRegisterTest("SRepTest10", SRepTest10);
+    UtRegisterTest("SRepTest11", SRepTest11);
 }
@@ -189,6 +189,38 @@ static int StreamTcpReassembleRawTest08 (void)
     RAWREASSEMBLY_END;
 }
 
+/** \test offsets of the packet's data in the stream */
+static int StreamTcpReassembleRawTest09(void)
+{
+    RAWREASSEMBLY_START(1);
+    RAWREASSEMBLY_STEP(2, "AAA", 3, "AAA", 3);
+    RAWREASSEMBLY_STEP(5, "BBB", 3, "AAABBB", 6);
+
+    p = PacketGetFromAlloc();
+    FAIL_IF_NULL(p);
+    p->flowflags = FLOW_PKT_TOSERVER;
+    TCPHdr tcphdr;
+    memset(&tcphdr, 0, sizeof(tcphdr));
+    UTHSetTCPHdr(p, &tcphdr);
+    tcphdr.th_seq = htonl(8);
+    tcphdr.th_ack = htonl(10);
+    p->payload_len = 3;
+    FAIL_IF(StreamTcpUTAddPayload(&tv, ra_ctx, &ssn, stream, 8, (uint8_t *)"CCC", 3) != 0);
+
+    uint64_t le = 0, re = 0;
+    FAIL_IF(StreamReassembleRawPacketRange(&ssn, p, &le, &re));
+    p->flags |= PKT_STREAM_ADD;
+    FAIL_IF_NOT(StreamReassembleRawPacketRange(&ssn, p, &le, &re));
+    FAIL_IF(le != 6);
+    FAIL_IF(re != 9);
+    FAIL_IF(!(TestReassembleRawValidate(&ssn, p, (uint8_t *)"AAABBBCCC", 9)));
+    /* packet starting before the base of the stream */
+    tcphdr.th_seq = htonl(stream->base_seq - 1);
+    FAIL_IF(StreamReassembleRawPacketRange(&ssn, p, &le, &re));
+    PacketFree(p);
+    RAWREASSEMBLY_END;
+}
+
 static void StreamTcpReassembleRawRegisterTests(void)
 {
     UtRegisterTest("StreamTcpReassembleRawTest01",
@@ -207,4 +239,5 @@ static void StreamTcpReassembleRawRegisterTests(void)
                    StreamTcpReassembleRawTest07);
     UtRegisterTest("StreamTcpReassembleRawTest08",
                    StreamTcpReassembleRawTest08);
+    UtRegisterTest("StreamTcpReassembleRawTest09", StreamTcpReassembleRawTest09);
 }
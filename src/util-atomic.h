@@ -160,6 +160,11 @@
 #define SC_ATOMIC_SET(name, val)    \
     atomic_store(&(name ## _sc_atomic__), (val))
 
+/**
+ *  \brief memory fence with the given memory order
+ */
+#define SC_ATOMIC_THREAD_FENCE(order) atomic_thread_fence((order))
+
 #else
 
 #define SC_ATOMIC_MEMORY_ORDER_RELAXED
@@ -388,6 +393,8 @@
         ;                                                       \
         })
 
+#define SC_ATOMIC_THREAD_FENCE(order) __sync_synchronize()
+
 #endif /* no c11 atomics */
 
 void SCAtomicRegisterTests(void);
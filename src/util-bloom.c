@@ -0,0 +1,129 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Blocked bloom filter.
+ *
+ * Each key maps to one 512 bit block, so a test touches a single cache
+ * line. Bits are set with atomic operations, so keys can be added while
+ * other threads test the filter. Keys can't be removed.
+ */
+
+#include "suricata-common.h"
+#include "util-bloom.h"
+#include "util-debug.h"
+#include "util-mem.h"
+#include "util-unittest.h"
+
+/* 2^24 blocks of 64 bytes: 1 GiB */
+#define BLOOM_FILTER_MAX_BLOCKS (1U << 24)
+#define BLOOM_FILTER_MAX_K      16
+
+/**
+ *  \brief create a filter sized for \a entries keys
+ *
+ *  \param entries expected number of keys
+ *  \param fp_rate target false positive rate, between 0 and 1
+ *  \retval bf filter or NULL on error
+ */
+BloomFilter *BloomFilterInit(uint32_t entries, double fp_rate)
+{
+    if (entries == 0 || !(fp_rate > 0.0 && fp_rate < 1.0))
+        return NULL;
+
+    /* optimal bits per key is -ln(p) / ln(2)^2, with ln(1/p) / ln(2) bits set per key */
+    const double bits = (double)entries * -log(fp_rate) / (M_LN2 * M_LN2);
+    uint32_t k = (uint32_t)(-log(fp_rate) / M_LN2 + 0.5);
+    k = MAX(1, MIN(k, BLOOM_FILTER_MAX_K));
+
+    uint64_t nblocks = 1;
+    while ((double)nblocks * BLOOM_FILTER_BLOCK_BITS < bits && nblocks < BLOOM_FILTER_MAX_BLOCKS)
+        nblocks <<= 1;
+
+    BloomFilter *bf = SCCalloc(1, sizeof(*bf));
+    if (bf == NULL)
+        return NULL;
+    const size_t size = nblocks * BLOOM_FILTER_BLOCK_WORDS * sizeof(BloomFilterWord);
+    bf->words = SCMallocAligned(size, CLS);
+    if (bf->words == NULL) {
+        SCFree(bf);
+        return NULL;
+    }
+    memset(bf->words, 0, size);
+    bf->nblocks = (uint32_t)nblocks;
+    bf->k = k;
+
+    SCLogDebug("bloom filter for %u entries at %f: %u blocks (%" PRIuMAX " bytes), k %u", entries,
+            fp_rate, bf->nblocks, (uintmax_t)size, bf->k);
+    return bf;
+}
+
+void BloomFilterFree(BloomFilter *bf)
+{
+    if (bf == NULL)
+        return;
+    SCFreeAligned(bf->words);
+    SCFree(bf);
+}
+
+#ifdef UNITTESTS
+#include "util-hash-lookup3.h"
+
+static int BloomFilterTest01(void)
+{
+    BloomFilter *bf = BloomFilterInit(1000, 0.01);
+    FAIL_IF_NULL(bf);
+    FAIL_IF(bf->k != 7);
+    FAIL_IF(bf->nblocks != 32);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        BloomFilterAdd(bf, hashword(&i, 1, 1), hashword(&i, 1, 2));
+    }
+    /* no false negatives */
+    for (uint32_t i = 0; i < 1000; i++) {
+        FAIL_IF_NOT(BloomFilterTest(bf, hashword(&i, 1, 1), hashword(&i, 1, 2)));
+    }
+    /* false positives at roughly the requested rate */
+    uint32_t fp = 0;
+    for (uint32_t i = 1000; i < 11000; i++) {
+        if (BloomFilterTest(bf, hashword(&i, 1, 1), hashword(&i, 1, 2)))
+            fp++;
+    }
+    FAIL_IF(fp > 300);
+
+    BloomFilterFree(bf);
+    PASS;
+}
+
+static int BloomFilterTest02(void)
+{
+    FAIL_IF_NOT_NULL(BloomFilterInit(0, 0.01));
+    FAIL_IF_NOT_NULL(BloomFilterInit(1000, 0.0));
+    FAIL_IF_NOT_NULL(BloomFilterInit(1000, 1.0));
+    PASS;
+}
+#endif /* UNITTESTS */
+
+void BloomFilterRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("BloomFilterTest01", BloomFilterTest01);
+    UtRegisterTest("BloomFilterTest02", BloomFilterTest02);
+#endif
+}
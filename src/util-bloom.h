@@ -0,0 +1,90 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Blocked bloom filter: all bits of a key are in a single cache line.
+ */
+
+#ifndef SURICATA_UTIL_BLOOM_H
+#define SURICATA_UTIL_BLOOM_H
+
+#define BLOOM_FILTER_BLOCK_WORDS 8
+#define BLOOM_FILTER_BLOCK_BITS  (BLOOM_FILTER_BLOCK_WORDS * 64)
+
+typedef struct BloomFilterWord_ {
+    SC_ATOMIC_DECLARE(uint64_t, bits);
+} BloomFilterWord;
+
+typedef struct BloomFilter_ {
+    BloomFilterWord *words; /**< nblocks * BLOOM_FILTER_BLOCK_WORDS words */
+    uint32_t nblocks;       /**< power of 2 */
+    uint32_t k;             /**< bits set per key */
+} BloomFilter;
+
+BloomFilter *BloomFilterInit(uint32_t entries, double fp_rate);
+void BloomFilterFree(BloomFilter *bf);
+
+/** \internal
+ *  \brief get the block and the bit step for a key from its 2 hashes */
+static inline BloomFilterWord *BloomFilterBlock(
+        const BloomFilter *bf, const uint32_t h1, const uint32_t h2, uint32_t *step)
+{
+    *step = ((h2 >> 17) | (h2 << 15)) | 1;
+    return &bf->words[(h1 & (bf->nblocks - 1)) * BLOOM_FILTER_BLOCK_WORDS];
+}
+
+/**
+ *  \brief add a key to the filter
+ *
+ *  \param h1 first hash of the key
+ *  \param h2 second, independent, hash of the key
+ */
+static inline void BloomFilterAdd(BloomFilter *bf, const uint32_t h1, const uint32_t h2)
+{
+    uint32_t step;
+    BloomFilterWord *block = BloomFilterBlock(bf, h1, h2, &step);
+    for (uint32_t i = 0; i < bf->k; i++) {
+        const uint32_t bit = (h2 + i * step) % BLOOM_FILTER_BLOCK_BITS;
+        (void)SC_ATOMIC_OR(block[bit / 64].bits, (1ULL << (bit % 64)));
+    }
+}
+
+/**
+ *  \brief test if a key may be in the filter
+ *
+ *  \retval false key was never added
+ *  \retval true key was probably added
+ */
+static inline bool BloomFilterTest(const BloomFilter *bf, const uint32_t h1, const uint32_t h2)
+{
+    uint32_t step;
+    BloomFilterWord *block = BloomFilterBlock(bf, h1, h2, &step);
+    for (uint32_t i = 0; i < bf->k; i++) {
+        const uint32_t bit = (h2 + i * step) % BLOOM_FILTER_BLOCK_BITS;
+        const uint64_t word =
+                SC_ATOMIC_LOAD_EXPLICIT(block[bit / 64].bits, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+        if ((word & (1ULL << (bit % 64))) == 0)
+            return false;
+    }
+    return true;
+}
+
+void BloomFilterRegisterTests(void);
+
+#endif /* SURICATA_UTIL_BLOOM_H */
@@ -0,0 +1,238 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Count-min sketch with conservative update.
+ *
+ * A key maps to one counter in each of the depth rows. Its count is the
+ * lowest of those counters, and an update only increments the counters
+ * that are at that lowest value, which keeps the overestimation caused by
+ * other keys sharing counters small. Counters are atomic, so the sketch
+ * can be updated by multiple threads without locking.
+ */
+
+#include "suricata-common.h"
+#include "util-countmin.h"
+#include "util-debug.h"
+#include "util-mem.h"
+#include "util-unittest.h"
+
+/**
+ *  \brief create a sketch
+ *
+ *  \param width counters per row, rounded up to a power of 2
+ *  \param depth number of rows
+ *  \retval cms sketch or NULL on error
+ */
+CountMinSketch *CountMinSketchInit(uint32_t width, uint32_t depth)
+{
+    if (width == 0 || width > (1U << 28) || depth == 0 || depth > COUNTMIN_MAX_DEPTH)
+        return NULL;
+
+    uint32_t w = 1;
+    while (w < width)
+        w <<= 1;
+
+    CountMinSketch *cms = SCCalloc(1, sizeof(*cms));
+    if (cms == NULL)
+        return NULL;
+    const size_t size = (size_t)w * depth * sizeof(CountMinCounter);
+    cms->counters = SCMallocAligned(size, CLS);
+    if (cms->counters == NULL) {
+        SCFree(cms);
+        return NULL;
+    }
+    memset(cms->counters, 0, size);
+    cms->width = w;
+    cms->depth = depth;
+
+    SCLogDebug("count-min sketch %u x %u (%" PRIuMAX " bytes)", cms->depth, cms->width,
+            (uintmax_t)size);
+    return cms;
+}
+
+void CountMinSketchFree(CountMinSketch *cms)
+{
+    if (cms == NULL)
+        return;
+    SCFreeAligned(cms->counters);
+    SCFree(cms);
+}
+
+/** \brief set all counters to 0 */
+void CountMinSketchReset(CountMinSketch *cms)
+{
+    for (uint32_t i = 0; i < cms->width * cms->depth; i++) {
+        SC_ATOMIC_SET(cms->counters[i].cnt, 0);
+    }
+}
+
+/** \internal
+ *  \brief get the counter of a key in \a row from its 2 hashes */
+static inline CountMinCounter *CountMinSketchCounter(
+        const CountMinSketch *cms, const uint32_t row, const uint32_t h1, const uint32_t h2)
+{
+    const uint32_t col = (h1 + row * (h2 | 1)) & (cms->width - 1);
+    return &cms->counters[row * cms->width + col];
+}
+
+/**
+ *  \brief count a key
+ *
+ *  Each counter is raised to the lowest counter value + 1. The update is
+ *  only done once none of the counters changed since they were read: the
+ *  counters at the lowest value are always raised, so a concurrent update
+ *  that read the same value fails its exchange and starts over with the new
+ *  values. That way no update is lost and the count is never too low.
+ *
+ *  \param h1 first hash of the key
+ *  \param h2 second, independent, hash of the key
+ *  \retval cnt estimated count of the key, including this update
+ */
+uint32_t CountMinSketchAdd(CountMinSketch *cms, const uint32_t h1, const uint32_t h2)
+{
+    CountMinCounter *c[COUNTMIN_MAX_DEPTH];
+    for (uint32_t i = 0; i < cms->depth; i++) {
+        c[i] = CountMinSketchCounter(cms, i, h1, h2);
+    }
+
+    while (1) {
+        uint32_t v[COUNTMIN_MAX_DEPTH];
+        uint32_t min = UINT32_MAX;
+        for (uint32_t i = 0; i < cms->depth; i++) {
+            v[i] = SC_ATOMIC_GET(c[i]->cnt);
+            min = MIN(min, v[i]);
+        }
+        if (min == UINT32_MAX)
+            return min;
+
+        bool changed = false;
+        for (uint32_t i = 0; i < cms->depth; i++) {
+            uint32_t expected = v[i];
+            if (!SC_ATOMIC_CAS(&c[i]->cnt, expected, MAX(v[i], min + 1))) {
+                changed = true;
+                break;
+            }
+        }
+        if (!changed)
+            return min + 1;
+    }
+}
+
+/**
+ *  \brief get the estimated count of a key
+ */
+uint32_t CountMinSketchEstimate(const CountMinSketch *cms, const uint32_t h1, const uint32_t h2)
+{
+    uint32_t min = UINT32_MAX;
+    for (uint32_t i = 0; i < cms->depth; i++) {
+        CountMinCounter *c = CountMinSketchCounter(cms, i, h1, h2);
+        const uint32_t v = SC_ATOMIC_LOAD_EXPLICIT(c->cnt, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+        min = MIN(min, v);
+    }
+    return min;
+}
+
+#ifdef UNITTESTS
+#include "util-hash-lookup3.h"
+
+static int CountMinSketchTest01(void)
+{
+    CountMinSketch *cms = CountMinSketchInit(1000, 4);
+    FAIL_IF_NULL(cms);
+    FAIL_IF(cms->width != 1024);
+
+    /* key i is counted i times */
+    for (uint32_t i = 0; i < 200; i++) {
+        for (uint32_t n = 1; n <= i; n++) {
+            uint32_t cnt = CountMinSketchAdd(cms, hashword(&i, 1, 1), hashword(&i, 1, 2));
+            FAIL_IF(cnt < n);
+        }
+    }
+    uint32_t exact = 0;
+    for (uint32_t i = 0; i < 200; i++) {
+        uint32_t cnt = CountMinSketchEstimate(cms, hashword(&i, 1, 1), hashword(&i, 1, 2));
+        FAIL_IF(cnt < i);
+        if (cnt == i)
+            exact++;
+    }
+    /* 200 keys in 1024 wide rows: nearly all are exact */
+    FAIL_IF(exact < 190);
+
+    CountMinSketchReset(cms);
+    uint32_t i = 100;
+    FAIL_IF(CountMinSketchEstimate(cms, hashword(&i, 1, 1), hashword(&i, 1, 2)) != 0);
+
+    CountMinSketchFree(cms);
+    PASS;
+}
+
+static int CountMinSketchTest02(void)
+{
+    FAIL_IF_NOT_NULL(CountMinSketchInit(0, 4));
+    FAIL_IF_NOT_NULL(CountMinSketchInit(1024, 0));
+    FAIL_IF_NOT_NULL(CountMinSketchInit(1024, COUNTMIN_MAX_DEPTH + 1));
+    PASS;
+}
+
+#define COUNTMIN_TEST_THREADS 4
+#define COUNTMIN_TEST_ADDS    50000
+
+static void *CountMinSketchTestThread(void *arg)
+{
+    CountMinSketch *cms = arg;
+    for (uint32_t n = 0; n < COUNTMIN_TEST_ADDS; n++) {
+        uint32_t key = n % 8;
+        (void)CountMinSketchAdd(cms, hashword(&key, 1, 1), hashword(&key, 1, 2));
+    }
+    return NULL;
+}
+
+/** \test concurrent updates of the same keys are all counted */
+static int CountMinSketchTest03(void)
+{
+    CountMinSketch *cms = CountMinSketchInit(1024, 4);
+    FAIL_IF_NULL(cms);
+
+    pthread_t threads[COUNTMIN_TEST_THREADS];
+    for (int i = 0; i < COUNTMIN_TEST_THREADS; i++) {
+        FAIL_IF(pthread_create(&threads[i], NULL, CountMinSketchTestThread, cms) != 0);
+    }
+    for (int i = 0; i < COUNTMIN_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (uint32_t key = 0; key < 8; key++) {
+        uint32_t cnt = CountMinSketchEstimate(cms, hashword(&key, 1, 1), hashword(&key, 1, 2));
+        FAIL_IF(cnt < COUNTMIN_TEST_THREADS * COUNTMIN_TEST_ADDS / 8);
+    }
+
+    CountMinSketchFree(cms);
+    PASS;
+}
+#endif /* UNITTESTS */
+
+void CountMinSketchRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("CountMinSketchTest01", CountMinSketchTest01);
+    UtRegisterTest("CountMinSketchTest02", CountMinSketchTest02);
+    UtRegisterTest("CountMinSketchTest03", CountMinSketchTest03);
+#endif
+}
@@ -0,0 +1,48 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Count-min sketch: approximate counters for a large number of keys in
+ * fixed memory. Estimates are never lower than the real count.
+ */
+
+#ifndef SURICATA_UTIL_COUNTMIN_H
+#define SURICATA_UTIL_COUNTMIN_H
+
+#define COUNTMIN_MAX_DEPTH 8
+
+typedef struct CountMinCounter_ {
+    SC_ATOMIC_DECLARE(uint32_t, cnt);
+} CountMinCounter;
+
+typedef struct CountMinSketch_ {
+    CountMinCounter *counters; /**< depth rows of width counters */
+    uint32_t width;            /**< power of 2 */
+    uint32_t depth;
+} CountMinSketch;
+
+CountMinSketch *CountMinSketchInit(uint32_t width, uint32_t depth);
+void CountMinSketchFree(CountMinSketch *cms);
+void CountMinSketchReset(CountMinSketch *cms);
+uint32_t CountMinSketchAdd(CountMinSketch *cms, const uint32_t h1, const uint32_t h2);
+uint32_t CountMinSketchEstimate(const CountMinSketch *cms, const uint32_t h1, const uint32_t h2);
+
+void CountMinSketchRegisterTests(void);
+
+#endif /* SURICATA_UTIL_COUNTMIN_H */
@@ -279,6 +279,160 @@ static int SCLogFileWrite(const char *buffer, int buffer_len, LogFileCtx *log_ct
     return ret;
 }
 
+/* initial and maximum size of the writer thread queue */
+#define LOGFILE_WRITER_QUEUE_SIZE (64 * 1024)
+#define LOGFILE_WRITER_QUEUE_MAX  (8 * 1024 * 1024)
+
+/**
+ * \brief Queue a record for the writer thread.
+ *
+ * The packet thread only copies the record into the queue. If the queue is
+ * full, it waits for the writer thread to take it, so records are not lost.
+ */
+static int SCLogFileWriteQueued(const char *buffer, int buffer_len, LogFileCtx *log_ctx)
+{
+    LogFileWriter *w = log_ctx->writer;
+    const uint32_t len = (uint32_t)buffer_len;
+
+    SCMutexLock(&w->mutex);
+    while (MEMBUFFER_SIZE(w->queue) - MEMBUFFER_OFFSET(w->queue) <= len) {
+        const bool empty = MEMBUFFER_OFFSET(w->queue) == 0;
+        if ((empty || MEMBUFFER_OFFSET(w->queue) + len < LOGFILE_WRITER_QUEUE_MAX) &&
+                MemBufferExpand(&w->queue, len) == 0)
+            break;
+        if (empty) {
+            SCMutexUnlock(&w->mutex);
+            /* can't wait for space if there is nothing to write */
+            OutputWriteLock(&log_ctx->fp_mutex);
+            if (!log_ctx->output_errors) {
+                SCLogError("%s: out of memory queueing a record of %u bytes, dropping it",
+                        log_ctx->filename, len);
+            }
+            log_ctx->output_errors++;
+            SCMutexUnlock(&log_ctx->fp_mutex);
+            return 0;
+        }
+        SCCondWait(&w->cond_space, &w->mutex);
+    }
+    MemBufferWriteRaw(w->queue, (const uint8_t *)buffer, len);
+    SCCondSignal(&w->cond);
+    SCMutexUnlock(&w->mutex);
+    return 0;
+}
+
+/**
+ * \brief Writer thread: write the queued records in batches.
+ *
+ * Takes all records queued so far and writes them with a single write. On
+ * shutdown the queue is drained before the thread exits.
+ */
+static void *LogFileWriterThread(void *arg)
+{
+    LogFileCtx *log_ctx = arg;
+    LogFileWriter *w = log_ctx->writer;
+
+    SCSetThreadName("LogWriter");
+
+    SCMutexLock(&w->mutex);
+    while (1) {
+        while (MEMBUFFER_OFFSET(w->queue) == 0 && !w->stop) {
+            SCCondWait(&w->cond, &w->mutex);
+        }
+        if (MEMBUFFER_OFFSET(w->queue) == 0)
+            break;
+
+        MemBuffer *batch = w->queue;
+        w->queue = w->batch;
+        w->batch = batch;
+        SCCondBroadcast(&w->cond_space);
+        SCMutexUnlock(&w->mutex);
+
+        OutputWriteLock(&log_ctx->fp_mutex);
+        SCLogFileWriteNoLock(
+                (const char *)MEMBUFFER_BUFFER(batch), (int)MEMBUFFER_OFFSET(batch), log_ctx);
+        SCMutexUnlock(&log_ctx->fp_mutex);
+        MemBufferReset(batch);
+
+        SCMutexLock(&w->mutex);
+    }
+    SCMutexUnlock(&w->mutex);
+    return NULL;
+}
+
+static void LogFileWriterFree(LogFileWriter *w)
+{
+    if (w->queue != NULL)
+        MemBufferFree(w->queue);
+    if (w->batch != NULL)
+        MemBufferFree(w->batch);
+    SCFree(w);
+}
+
+/**
+ * \brief Start a writer thread for a regular log file
+ *
+ * From then on the packet threads queue their records and the writer thread
+ * writes them to the file.
+ *
+ * This is a plain thread, not a management thread: management threads are
+ * stopped before the packet threads, while the writer has to keep taking
+ * records until the last packet thread is done. Its lifetime is that of the
+ * log file, it's stopped by LogFileFreeCtx once the queue is drained.
+ */
+int LogFileWriterStart(LogFileCtx *log_ctx)
+{
+    DEBUG_VALIDATE_BUG_ON(!log_ctx->is_regular || log_ctx->threaded);
+
+    LogFileWriter *w = SCCalloc(1, sizeof(*w));
+    if (w == NULL)
+        return -1;
+    w->queue = MemBufferCreateNew(LOGFILE_WRITER_QUEUE_SIZE);
+    w->batch = MemBufferCreateNew(LOGFILE_WRITER_QUEUE_SIZE);
+    if (w->queue == NULL || w->batch == NULL) {
+        LogFileWriterFree(w);
+        return -1;
+    }
+    SCMutexInit(&w->mutex, NULL);
+    SCCondInit(&w->cond, NULL);
+    SCCondInit(&w->cond_space, NULL);
+
+    log_ctx->writer = w;
+    int rc = pthread_create(&w->thread, NULL, LogFileWriterThread, log_ctx);
+    if (rc != 0) {
+        SCLogError("unable to create writer thread for %s: %s", log_ctx->filename, strerror(rc));
+        log_ctx->writer = NULL;
+        SCCondDestroy(&w->cond_space);
+        SCCondDestroy(&w->cond);
+        SCMutexDestroy(&w->mutex);
+        LogFileWriterFree(w);
+        return -1;
+    }
+    log_ctx->Write = SCLogFileWriteQueued;
+    SCLogConfig("%s: writing from a dedicated thread", log_ctx->filename);
+    return 0;
+}
+
+/**
+ * \brief Stop the writer thread after it wrote all queued records
+ */
+static void LogFileWriterStop(LogFileCtx *log_ctx)
+{
+    LogFileWriter *w = log_ctx->writer;
+
+    SCMutexLock(&w->mutex);
+    w->stop = true;
+    SCCondSignal(&w->cond);
+    SCMutexUnlock(&w->mutex);
+    pthread_join(w->thread, NULL);
+
+    log_ctx->Write = SCLogFileWrite;
+    log_ctx->writer = NULL;
+    SCCondDestroy(&w->cond_space);
+    SCCondDestroy(&w->cond);
+    SCMutexDestroy(&w->mutex);
+    LogFileWriterFree(w);
+}
+
 /** \brief generate filename based on pattern
  *  \param pattern pattern to use
  *  \retval char* on success
@@ -924,6 +1078,9 @@ int LogFileFreeCtx(LogFileCtx *lf_ctx)
         }
         SCFree(lf_ctx->threads);
     } else {
+        if (lf_ctx->writer != NULL) {
+            LogFileWriterStop(lf_ctx);
+        }
         if (lf_ctx->type != LOGFILE_TYPE_FILETYPE) {
             if (lf_ctx->fp != NULL) {
                 lf_ctx->Close(lf_ctx);
@@ -998,3 +1155,85 @@ int LogFileWrite(LogFileCtx *file_ctx, MemBuffer *buffer)
 
     return 0;
 }
+
+#ifdef UNITTESTS
+#include "util-unittest.h"
+
+#define LOGFILE_TEST_THREADS 4
+#define LOGFILE_TEST_RECORDS 20000
+
+struct LogFileWriterTestCtx {
+    LogFileCtx *lf;
+    int id;
+};
+
+static void *LogFileWriterTestThread(void *arg)
+{
+    struct LogFileWriterTestCtx *ctx = arg;
+    for (int i = 0; i < LOGFILE_TEST_RECORDS; i++) {
+        char buf[32];
+        int len = snprintf(buf, sizeof(buf), "%d %d\n", ctx->id, i);
+        ctx->lf->Write(buf, len, ctx->lf);
+    }
+    return NULL;
+}
+
+/** \test records queued by several threads are all written, in order per
+ *        thread, by the time the log file is freed */
+static int LogFileWriterTest01(void)
+{
+    char path[] = "/tmp/suricata-logwriter-XXXXXX";
+    int fd = mkstemp(path);
+    FAIL_IF(fd < 0);
+    close(fd);
+
+    SCConfCreateContextBackup();
+    SCConfInit();
+    FAIL_IF_NOT(SCConfSetFinal("logwriter.filename", path));
+    SCConfNode *conf = SCConfGetNode("logwriter");
+    FAIL_IF_NULL(conf);
+
+    LogFileCtx *lf = LogFileNewCtx();
+    FAIL_IF_NULL(lf);
+    FAIL_IF(SCConfLogOpenGeneric(conf, lf, "logwriter.log", 0) != 0);
+    FAIL_IF(LogFileWriterStart(lf) != 0);
+
+    pthread_t threads[LOGFILE_TEST_THREADS];
+    struct LogFileWriterTestCtx ctx[LOGFILE_TEST_THREADS];
+    for (int i = 0; i < LOGFILE_TEST_THREADS; i++) {
+        ctx[i].lf = lf;
+        ctx[i].id = i;
+        FAIL_IF(pthread_create(&threads[i], NULL, LogFileWriterTestThread, &ctx[i]) != 0);
+    }
+    for (int i = 0; i < LOGFILE_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    LogFileFreeCtx(lf);
+
+    int next[LOGFILE_TEST_THREADS] = { 0 };
+    FILE *fp = fopen(path, "r");
+    FAIL_IF_NULL(fp);
+    char line[32];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        int id, i;
+        FAIL_IF(sscanf(line, "%d %d", &id, &i) != 2);
+        FAIL_IF(id < 0 || id >= LOGFILE_TEST_THREADS);
+        FAIL_IF(i != next[id]);
+        next[id]++;
+    }
+    fclose(fp);
+    for (int i = 0; i < LOGFILE_TEST_THREADS; i++) {
+        FAIL_IF(next[i] != LOGFILE_TEST_RECORDS);
+    }
+
+    unlink(path);
+    SCConfDeInit();
+    SCConfRestoreContextBackup();
+    PASS;
+}
+
+void LogFileRegisterTests(void)
+{
+    UtRegisterTest("LogFileWriterTest01", LogFileWriterTest01);
+}
+#endif /* UNITTESTS */
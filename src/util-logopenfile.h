@@ -62,6 +62,17 @@ typedef struct LogThreadedFileCtx_ {
     char *append;
 } LogThreadedFileCtx;
 
+/** records queued by the packet threads for the writer thread of a log file */
+typedef struct LogFileWriter_ {
+    SCMutex mutex;
+    SCCondT cond;       /**< signaled when records are queued or on shutdown */
+    SCCondT cond_space; /**< signaled when the writer took the queue */
+    MemBuffer *queue;   /**< records added by the packet threads */
+    MemBuffer *batch;   /**< records being written by the writer thread */
+    pthread_t thread;
+    bool stop;
+} LogFileWriter;
+
 typedef struct LogFileTypeCtx_ {
     SCEveFileType *filetype;
     void *init_data;
@@ -94,6 +105,9 @@ typedef struct LogFileCtx_ {
      * record cannot be written to the file in one call */
     SCMutex fp_mutex;
 
+    /** Writer thread, when writes are moved out of the packet threads */
+    LogFileWriter *writer;
+
     /** When threaded, track of the parent and thread id */
     bool threaded;
     struct LogFileCtx_ *parent;
@@ -176,6 +190,7 @@ typedef struct LogFileCtx_ {
 
 LogFileCtx *LogFileNewCtx(void);
 int LogFileFreeCtx(LogFileCtx *);
+int LogFileWriterStart(LogFileCtx *log_ctx);
 int LogFileWrite(LogFileCtx *file_ctx, MemBuffer *buffer);
 void LogFileFlush(LogFileCtx *file_ctx);
 
@@ -184,4 +199,8 @@ int SCConfLogOpenGeneric(SCConfNode *conf, LogFileCtx *, const char *, int);
 int SCConfLogReopen(LogFileCtx *);
 bool SCLogOpenThreadedFile(const char *log_path, const char *append, LogFileCtx *parent_ctx);
 
+#ifdef UNITTESTS
+void LogFileRegisterTests(void);
+#endif
+
 #endif /* SURICATA_UTIL_LOGOPENFILE_H */
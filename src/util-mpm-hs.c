@@ -327,6 +327,9 @@ static int SCHSAddPattern(MpmCtx *mpm_ctx, const uint8_t *pat, uint16_t patlen,
             }
         }
 
+        if (offset || depth)
+            mpm_ctx->flags |= MPMCTX_FLAGS_OFFSET_DEPTH;
+
         if (mpm_ctx->maxlen < patlen)
             mpm_ctx->maxlen = patlen;
 
@@ -513,6 +513,9 @@ int MpmAddPattern(MpmCtx *mpm_ctx, const uint8_t *pat, uint16_t patlen, uint16_t
             }
         }
 
+        if (offset || depth)
+            mpm_ctx->flags |= MPMCTX_FLAGS_OFFSET_DEPTH;
+
         if (mpm_ctx->maxlen < patlen)
             mpm_ctx->maxlen = patlen;
 
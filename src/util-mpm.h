@@ -87,6 +87,8 @@ typedef struct MpmPattern_ {
 #define MPMCTX_FLAGS_GLOBAL     BIT_U8(0)
 #define MPMCTX_FLAGS_NODEPTH    BIT_U8(1)
 #define MPMCTX_FLAGS_CACHE_TO_DISK BIT_U8(2)
+/** at least one pattern has an offset or depth */
+#define MPMCTX_FLAGS_OFFSET_DEPTH  BIT_U8(3)
 
 typedef struct MpmConfig_ {
     const char *cache_dir_path;
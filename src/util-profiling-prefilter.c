@@ -42,6 +42,8 @@ typedef struct SCProfilePrefilterData_ {
     uint64_t bytes_called; /**< number of times total_bytes was updated. Differs from `called` as a
                               prefilter engine may skip mpm if the smallest pattern is bigger than
                               the buffer to inspect. */
+    uint64_t total_candidates; /**< rule candidates added by the engine */
+    uint64_t max_candidates;
     const char *name;
 } SCProfilePrefilterData;
 
@@ -99,9 +101,10 @@ static void DoDump(SCProfilePrefilterDetectCtx *rules_ctx, FILE *fp, const char
     fprintf(fp, "  ----------------------------------------------"
             "------------------------------------------------------"
             "----------------------------\n");
-    fprintf(fp, "  %-32s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s\n", "Prefilter",
-            "Ticks", "Called", "Max Ticks", "Avg", "Bytes", "Called", "Max Bytes", "Avg Bytes",
-            "Ticks/Byte");
+    fprintf(fp,
+            "  %-32s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s\n",
+            "Prefilter", "Ticks", "Called", "Max Ticks", "Avg", "Bytes", "Called", "Max Bytes",
+            "Avg Bytes", "Ticks/Byte", "Candidates", "Avg Cands", "Max Cands");
     fprintf(fp, "  -------------------------------- "
                 "--------------- "
                 "--------------- "
@@ -112,6 +115,9 @@ static void DoDump(SCProfilePrefilterDetectCtx *rules_ctx, FILE *fp, const char
                 "--------------- "
                 "--------------- "
                 "--------------- "
+                "--------------- "
+                "--------------- "
+                "--------------- "
                 "\n");
     for (i = 0; i < (int)rules_ctx->size; i++) {
         SCProfilePrefilterData *d = &rules_ctx->data[i];
@@ -131,12 +137,20 @@ static void DoDump(SCProfilePrefilterDetectCtx *rules_ctx, FILE *fp, const char
         if (ticks && d->total_bytes) {
             ticks_per_byte = (double)(ticks / d->total_bytes);
         }
+        /* candidate yield: how many rules the engine selects per call. The
+         * lower, the more selective the engine is. */
+        double avgcands = 0;
+        if (d->total_candidates && d->called) {
+            avgcands = (double)d->total_candidates / (double)d->called;
+        }
 
         fprintf(fp,
                 "  %-32s %-15" PRIu64 " %-15" PRIu64 " %-15" PRIu64 " %-15.2f %-15" PRIu64
-                " %-15" PRIu64 " %-15" PRIu64 " %-15.2f %-15.2f\n",
+                " %-15" PRIu64 " %-15" PRIu64 " %-15.2f %-15.2f %-15" PRIu64 " %-15.2f %-15" PRIu64
+                "\n",
                 d->name, ticks, d->called, d->max, avgticks, d->total_bytes, d->bytes_called,
-                d->max_bytes, avgbytes, ticks_per_byte);
+                d->max_bytes, avgbytes, ticks_per_byte, d->total_candidates, avgcands,
+                d->max_candidates);
     }
 }
 
@@ -189,10 +203,12 @@ SCProfilingPrefilterDump(DetectEngineCtx *de_ctx)
  *
  * \param id The ID of this counter.
  * \param ticks Number of CPU ticks for this rule.
- * \param match Did the rule match?
+ * \param bytes Number of bytes inspected.
+ * \param bytes_called Number of buffers inspected.
+ * \param candidates Number of rule candidates the engine added.
  */
 void SCProfilingPrefilterUpdateCounter(DetectEngineThreadCtx *det_ctx, int id, uint64_t ticks,
-        uint64_t bytes, uint64_t bytes_called)
+        uint64_t bytes, uint64_t bytes_called, uint32_t candidates)
 {
     if (det_ctx != NULL && det_ctx->prefilter_perf_data != NULL &&
             id < (int)det_ctx->de_ctx->prefilter_id)
@@ -208,6 +224,10 @@ void SCProfilingPrefilterUpdateCounter(DetectEngineThreadCtx *det_ctx, int id, u
         if (bytes > p->max_bytes)
             p->max_bytes = bytes;
         p->total_bytes += bytes;
+
+        if (candidates > p->max_candidates)
+            p->max_candidates = candidates;
+        p->total_candidates += candidates;
     }
 }
 
@@ -275,6 +295,12 @@ static void SCProfilingPrefilterThreadMerge(DetectEngineCtx *de_ctx, DetectEngin
                     det_ctx->prefilter_perf_data[i].max_bytes;
         de_ctx->profile_prefilter_ctx->data[i].bytes_called +=
                 det_ctx->prefilter_perf_data[i].bytes_called;
+        de_ctx->profile_prefilter_ctx->data[i].total_candidates +=
+                det_ctx->prefilter_perf_data[i].total_candidates;
+        if (det_ctx->prefilter_perf_data[i].max_candidates >
+                de_ctx->profile_prefilter_ctx->data[i].max_candidates)
+            de_ctx->profile_prefilter_ctx->data[i].max_candidates =
+                    det_ctx->prefilter_perf_data[i].max_candidates;
     }
 }
 
@@ -260,6 +260,7 @@ extern thread_local int profiling_prefilter_entered;
 #define PREFILTER_PROFILING_START(det_ctx)                                                         \
     (det_ctx)->prefilter_bytes = 0;                                                                \
     (det_ctx)->prefilter_bytes_called = 0;                                                         \
+    (det_ctx)->prefilter_rule_id_cnt = (det_ctx)->pmq.rule_id_array_cnt;                           \
     uint64_t profile_prefilter_start_ = 0;                                                         \
     uint64_t profile_prefilter_end_ = 0;                                                           \
     if (profiling_prefilter_enabled) {                                                             \
@@ -279,7 +280,8 @@ extern thread_local int profiling_prefilter_entered;
         if (profile_prefilter_end_ > profile_prefilter_start_)                                     \
             SCProfilingPrefilterUpdateCounter((ctx), (profile_id),                                 \
                     (profile_prefilter_end_ - profile_prefilter_start_), (ctx)->prefilter_bytes,   \
-                    (ctx)->prefilter_bytes_called);                                                \
+                    (ctx)->prefilter_bytes_called,                                                 \
+                    (ctx)->pmq.rule_id_array_cnt - (ctx)->prefilter_rule_id_cnt);                  \
         profiling_prefilter_entered--;                                                             \
     }
 
@@ -299,7 +301,7 @@ void SCProfilingPrefilterGlobalInit(void);
 void SCProfilingPrefilterDestroyCtx(DetectEngineCtx *);
 void SCProfilingPrefilterInitCounters(DetectEngineCtx *);
 void SCProfilingPrefilterUpdateCounter(DetectEngineThreadCtx *det_ctx, int id, uint64_t ticks,
-        uint64_t bytes, uint64_t bytes_called);
+        uint64_t bytes, uint64_t bytes_called, uint32_t candidates);
 void SCProfilingPrefilterThreadSetup(struct SCProfilePrefilterDetectCtx_ *, DetectEngineThreadCtx *);
 void SCProfilingPrefilterThreadCleanup(DetectEngineThreadCtx *);
 
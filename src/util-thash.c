@@ -44,6 +44,24 @@ void THashDataMoveToSpare(THashTableContext *ctx, THashData *h)
     (void) SC_ATOMIC_SUB(ctx->counter, 1);
 }
 
+/** \internal
+ *  \brief mark the start of a change to the list of a locked row
+ *
+ *  Together with THashRowWriteEnd this forms the writer side of a seqlock,
+ *  so that THashLookupCopyFromHash can detect concurrent changes.
+ */
+static inline void THashRowWriteBegin(THashHashRow *hb)
+{
+    (void)SC_ATOMIC_ADD(hb->seq, 1);
+    SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_RELEASE);
+}
+
+static inline void THashRowWriteEnd(THashHashRow *hb)
+{
+    SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_RELEASE);
+    (void)SC_ATOMIC_ADD(hb->seq, 1);
+}
+
 static THashDataQueue *THashDataQueueInit (THashDataQueue *q)
 {
     if (q != NULL) {
@@ -207,7 +225,10 @@ static void THashDataFree(THashTableContext *ctx, THashData *h)
 
 #define THASH_DEFAULT_HASHSIZE 4096
 #define THASH_DEFAULT_MEMCAP 16777216
-#define THASH_DEFAULT_PREALLOC 1000
+
+/* limits for lockless lookups before falling back to locking the row */
+#define THASH_OPTIMISTIC_TRIES     4
+#define THASH_OPTIMISTIC_MAX_STEPS 64
 
 #define GET_VAR(prefix,name) \
     snprintf(varname, sizeof(varname), "%s.%s", (prefix), (name))
@@ -274,6 +295,7 @@ static int THashInitConfig(THashTableContext *ctx, const char *cnf_prefix)
     uint32_t i = 0;
     for (i = 0; i < ctx->config.hash_size; i++) {
         HRLOCK_INIT(&ctx->array[i]);
+        SC_ATOMIC_INIT(ctx->array[i].seq);
     }
     (void)SC_ATOMIC_ADD(ctx->memuse, (ctx->config.hash_size * sizeof(THashHashRow)));
 
@@ -304,6 +326,20 @@ THashTableContext *THashInit(const char *cnf_prefix, uint32_t data_size,
         uint32_t (*DataHash)(uint32_t, void *), bool (*DataCompare)(void *, void *),
         bool (*DataExpired)(void *, SCTime_t), uint32_t (*DataSize)(void *), bool reset_memcap,
         uint64_t memcap, uint32_t hashsize)
+{
+    return THashInitWithPrealloc(cnf_prefix, data_size, DataSet, DataFree, DataHash, DataCompare,
+            DataExpired, DataSize, reset_memcap, memcap, hashsize, THASH_DEFAULT_PREALLOC);
+}
+
+/** \brief initialize a hash table that preallocates \a prealloc entries
+ *
+ *  For users that split their memcap over multiple tables. The "prealloc"
+ *  setting under \a cnf_prefix still overrides it. */
+THashTableContext *THashInitWithPrealloc(const char *cnf_prefix, uint32_t data_size,
+        int (*DataSet)(void *, void *), void (*DataFree)(void *),
+        uint32_t (*DataHash)(uint32_t, void *), bool (*DataCompare)(void *, void *),
+        bool (*DataExpired)(void *, SCTime_t), uint32_t (*DataSize)(void *), bool reset_memcap,
+        uint64_t memcap, uint32_t hashsize, uint32_t prealloc)
 {
     THashTableContext *ctx = SCCalloc(1, sizeof(*ctx));
     BUG_ON(!ctx);
@@ -326,7 +362,7 @@ THashTableContext *THashInit(const char *cnf_prefix, uint32_t data_size,
     } else {
         SC_ATOMIC_SET(ctx->config.memcap, reset_memcap ? UINT64_MAX : THASH_DEFAULT_MEMCAP);
     }
-    ctx->config.prealloc = THASH_DEFAULT_PREALLOC;
+    ctx->config.prealloc = prealloc;
 
     SC_ATOMIC_INIT(ctx->counter);
     SC_ATOMIC_INIT(ctx->memuse);
@@ -415,6 +451,33 @@ int THashWalk(THashTableContext *ctx, THashFormatFunc FormatterFunc, THashOutput
     return 0;
 }
 
+/** \internal
+ *  \brief unlink locked data from its locked row, free it and move it to
+ *         the spare queue. The data lock is released. */
+static void THashRowRemoveData(THashTableContext *ctx, THashHashRow *hb, THashData *h)
+{
+    THashRowWriteBegin(hb);
+    if (h->prev != NULL)
+        h->prev->next = h->next;
+    if (h->next != NULL)
+        h->next->prev = h->prev;
+    if (hb->head == h)
+        hb->head = h->next;
+    if (hb->tail == h)
+        hb->tail = h->prev;
+    h->next = NULL;
+    h->prev = NULL;
+    THashRowWriteEnd(hb);
+    if (ctx->config.DataSize) {
+        uint32_t data_size = ctx->config.DataSize(h->data);
+        if (data_size > 0)
+            (void)SC_ATOMIC_SUB(ctx->memuse, (uint64_t)data_size);
+    }
+    ctx->config.DataFree(h->data);
+    THashDataUnlock(h);
+    THashDataMoveToSpare(ctx, h);
+}
+
 /** \brief expire data from the hash
  *  Walk the hash table and remove data that is exprired according to the
  *  DataExpired callback.
@@ -440,26 +503,8 @@ uint32_t THashExpire(THashTableContext *ctx, const SCTime_t ts)
             DEBUG_VALIDATE_BUG_ON(SC_ATOMIC_GET(h->use_cnt) > (uint32_t)INT_MAX);
             /* only consider items with no references to it */
             if (SC_ATOMIC_GET(h->use_cnt) == 0 && ctx->config.DataExpired(h->data, ts)) {
-                /* remove from the hash */
-                if (h->prev != NULL)
-                    h->prev->next = h->next;
-                if (h->next != NULL)
-                    h->next->prev = h->prev;
-                if (hb->head == h)
-                    hb->head = h->next;
-                if (hb->tail == h)
-                    hb->tail = h->prev;
-                h->next = NULL;
-                h->prev = NULL;
                 SCLogDebug("timeout: removing data %p", h);
-                if (ctx->config.DataSize) {
-                    uint32_t data_size = ctx->config.DataSize(h->data);
-                    if (data_size > 0)
-                        (void)SC_ATOMIC_SUB(ctx->memuse, (uint64_t)data_size);
-                }
-                ctx->config.DataFree(h->data);
-                THashDataUnlock(h);
-                THashDataMoveToSpare(ctx, h);
+                THashRowRemoveData(ctx, hb, h);
                 cnt++;
             } else {
                 THashDataUnlock(h);
@@ -473,6 +518,77 @@ uint32_t THashExpire(THashTableContext *ctx, const SCTime_t ts)
     return cnt;
 }
 
+/** \brief expire the data of a single row
+ *
+ *  Like THashExpire, but only for \a row. The row is locked while the
+ *  \a Remaining callback is called for each data that stays in the row,
+ *  including data that is still referenced, so that the caller can find
+ *  out when the row needs to be checked again.
+ *
+ *  \param row row index, see THashGetRow
+ *  \retval cnt number of items expired
+ */
+uint32_t THashExpireRow(THashTableContext *ctx, const uint32_t row, const SCTime_t ts,
+        void (*Remaining)(void *data, void *arg), void *arg)
+{
+    uint32_t cnt = 0;
+
+    if (ctx->array == NULL || row >= ctx->config.hash_size)
+        return 0;
+
+    THashHashRow *hb = &ctx->array[row];
+    HRLOCK_LOCK(hb);
+    THashData *h = hb->head;
+    while (h) {
+        THashData *next = h->next;
+        THashDataLock(h);
+        if (SC_ATOMIC_GET(h->use_cnt) == 0 && ctx->config.DataExpired(h->data, ts)) {
+            THashRowRemoveData(ctx, hb, h);
+            cnt++;
+        } else {
+            Remaining(h->data, arg);
+            THashDataUnlock(h);
+        }
+        h = next;
+    }
+    HRLOCK_UNLOCK(hb);
+    return cnt;
+}
+
+/** \brief remove data from the hash
+ *  Walk the hash table and remove data for which the \a Remove callback
+ *  returns true. Data that is still referenced is skipped.
+ *  \retval cnt number of items removed
+ */
+uint32_t THashRemoveIf(THashTableContext *ctx, bool (*Remove)(void *data, void *arg), void *arg)
+{
+    uint32_t cnt = 0;
+
+    if (ctx->array == NULL)
+        return 0;
+
+    for (uint32_t i = 0; i < ctx->config.hash_size; i++) {
+        THashHashRow *hb = &ctx->array[i];
+        HRLOCK_LOCK(hb);
+        THashData *h = hb->head;
+        while (h) {
+            THashData *next = h->next;
+            THashDataLock(h);
+            if (SC_ATOMIC_GET(h->use_cnt) == 0 && Remove(h->data, arg)) {
+                THashRowRemoveData(ctx, hb, h);
+                cnt++;
+            } else {
+                THashDataUnlock(h);
+            }
+            h = next;
+        }
+        HRLOCK_UNLOCK(hb);
+    }
+
+    SCLogDebug("%u entries removed", cnt);
+    return cnt;
+}
+
 /** \brief Cleanup the thash engine
  *
  * Cleanup the thash engine from tag and threshold.
@@ -495,6 +611,7 @@ void THashCleanup(THashTableContext *ctx)
             } else {
                 THashData *n = h->next;
                 /* remove from the hash */
+                THashRowWriteBegin(hb);
                 if (h->prev != NULL)
                     h->prev->next = h->next;
                 if (h->next != NULL)
@@ -505,6 +622,7 @@ void THashCleanup(THashTableContext *ctx)
                     hb->tail = h->prev;
                 h->next = NULL;
                 h->prev = NULL;
+                THashRowWriteEnd(hb);
                 if (ctx->config.DataSize) {
                     uint32_t data_size = ctx->config.DataSize(h->data);
                     if (data_size > 0)
@@ -534,6 +652,12 @@ static uint32_t THashGetKey(const THashConfig *cnf, void *data)
     return key;
 }
 
+/** \brief get the index of the row \a data is stored in */
+uint32_t THashGetRow(const THashTableContext *ctx, void *data)
+{
+    return THashGetKey(&ctx->config, data);
+}
+
 static inline int THashCompare(const THashConfig *cnf, void *a, void *b)
 {
     if (cnf->DataCompare(a, b))
@@ -635,8 +759,10 @@ THashGetFromHash (THashTableContext *ctx, void *data)
         }
 
         /* data is locked */
+        THashRowWriteBegin(hb);
         hb->head = h;
         hb->tail = h;
+        THashRowWriteEnd(hb);
 
         /* initialize and return */
         (void) THashIncrUsecnt(h);
@@ -659,16 +785,18 @@ THashGetFromHash (THashTableContext *ctx, void *data)
             h = h->next;
 
             if (h == NULL) {
-                h = ph->next = THashDataGetNew(ctx, data);
+                h = THashDataGetNew(ctx, data);
                 if (h == NULL) {
                     HRLOCK_UNLOCK(hb);
                     return res;
                 }
-                hb->tail = h;
-
                 /* data is locked */
 
+                THashRowWriteBegin(hb);
+                ph->next = h;
+                hb->tail = h;
                 h->prev = ph;
+                THashRowWriteEnd(hb);
 
                 /* initialize and return */
                 (void) THashIncrUsecnt(h);
@@ -682,6 +810,7 @@ THashGetFromHash (THashTableContext *ctx, void *data)
             if (THashCompare(&ctx->config, h->data, data) != 0) {
                 /* we found our data, lets put it on top of the
                  * hash list -- this rewards active data */
+                THashRowWriteBegin(hb);
                 if (h->next) {
                     h->next->prev = h->prev;
                 }
@@ -696,6 +825,7 @@ THashGetFromHash (THashTableContext *ctx, void *data)
                 h->prev = NULL;
                 hb->head->prev = h;
                 hb->head = h;
+                THashRowWriteEnd(hb);
 
                 /* found our data, lock & return */
                 SCMutexLock(&h->m);
@@ -755,6 +885,7 @@ THashData *THashLookupFromHash (THashTableContext *ctx, void *data)
             if (THashCompare(&ctx->config, h->data, data) != 0) {
                 /* we found our data, lets put it on top of the
                  * hash list -- this rewards active data */
+                THashRowWriteBegin(hb);
                 if (h->next) {
                     h->next->prev = h->prev;
                 }
@@ -769,6 +900,7 @@ THashData *THashLookupFromHash (THashTableContext *ctx, void *data)
                 h->prev = NULL;
                 hb->head->prev = h;
                 hb->head = h;
+                THashRowWriteEnd(hb);
 
                 /* found our data, lock & return */
                 SCMutexLock(&h->m);
@@ -786,6 +918,80 @@ THashData *THashLookupFromHash (THashTableContext *ctx, void *data)
     return h;
 }
 
+/** \internal
+ *  \brief walk a row without holding its lock
+ *
+ *  Reader side of the row seqlock: the walk is only trusted if the row's
+ *  sequence was even and unchanged over the whole walk. Data is never freed
+ *  while the hash exists (see THashRemoveFromHash), so following stale
+ *  pointers is harmless.
+ *
+ *  \retval 1 found, 0 not found, -1 unable to get a stable read
+ */
+static int THashLookupCopyOptimistic(
+        THashTableContext *ctx, THashHashRow *hb, void *data, void *copy)
+{
+    for (int tries = 0; tries < THASH_OPTIMISTIC_TRIES; tries++) {
+        const uint32_t seq = SC_ATOMIC_LOAD_EXPLICIT(hb->seq, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (seq & 1)
+            continue;
+
+        int found = 0;
+        uint32_t steps = 0;
+        for (THashData *h = hb->head; h != NULL && steps < THASH_OPTIMISTIC_MAX_STEPS;
+                h = h->next, steps++) {
+            if (THashCompare(&ctx->config, h->data, data)) {
+                memcpy(copy, h->data, ctx->config.data_size);
+                found = 1;
+                break;
+            }
+        }
+
+        SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (SC_ATOMIC_LOAD_EXPLICIT(hb->seq, SC_ATOMIC_MEMORY_ORDER_RELAXED) == seq &&
+                steps < THASH_OPTIMISTIC_MAX_STEPS)
+            return found;
+    }
+    return -1;
+}
+
+/** \brief look up data in the hash and copy it out
+ *
+ *  Unlike THashLookupFromHash this doesn't lock, reference or move the
+ *  found data, so it is much cheaper for pure membership tests. If the
+ *  hash was set up with \a optimistic_reads the row isn't locked either.
+ *
+ *  \param data data to look up
+ *  \param copy buffer of config.data_size bytes the found data is copied
+ *               into. Pointers in the copy are not safe to dereference.
+ *
+ *  \retval 1 found
+ *  \retval 0 not found
+ */
+int THashLookupCopyFromHash(THashTableContext *ctx, void *data, void *copy)
+{
+    uint32_t key = THashGetKey(&ctx->config, data);
+    THashHashRow *hb = &ctx->array[key];
+
+    if (ctx->config.optimistic_reads) {
+        int r = THashLookupCopyOptimistic(ctx, hb, data, copy);
+        if (r >= 0)
+            return r;
+    }
+
+    int found = 0;
+    HRLOCK_LOCK(hb);
+    for (THashData *h = hb->head; h != NULL; h = h->next) {
+        if (THashCompare(&ctx->config, h->data, data)) {
+            memcpy(copy, h->data, ctx->config.data_size);
+            found = 1;
+            break;
+        }
+    }
+    HRLOCK_UNLOCK(hb);
+    return found;
+}
+
 /** \internal
  *  \brief Get data from the hash directly.
  *
@@ -831,6 +1037,7 @@ static THashData *THashGetUsed(THashTableContext *ctx, uint32_t data_size)
         }
 
         /* remove from the hash */
+        THashRowWriteBegin(hb);
         if (h->prev != NULL)
             h->prev->next = h->next;
         if (h->next != NULL)
@@ -842,6 +1049,7 @@ static THashData *THashGetUsed(THashTableContext *ctx, uint32_t data_size)
 
         h->next = NULL;
         h->prev = NULL;
+        THashRowWriteEnd(hb);
         HRLOCK_UNLOCK(hb);
 
         if (h->data != NULL) {
@@ -892,6 +1100,7 @@ int THashRemoveFromHash (THashTableContext *ctx, void *data)
         }
 
         /* remove from the hash */
+        THashRowWriteBegin(hb);
         if (h->prev != NULL)
             h->prev->next = h->next;
         if (h->next != NULL)
@@ -903,9 +1112,22 @@ int THashRemoveFromHash (THashTableContext *ctx, void *data)
 
         h->next = NULL;
         h->prev = NULL;
+        THashRowWriteEnd(hb);
         SCMutexUnlock(&h->m);
         HRLOCK_UNLOCK(hb);
-        THashDataFree(ctx, h);
+        if (ctx->config.optimistic_reads) {
+            /* lockless readers may still be looking at the data, so it
+             * can't be freed. Recycle it like expired data instead. */
+            if (ctx->config.DataSize) {
+                uint32_t data_size = ctx->config.DataSize(h->data);
+                if (data_size > 0)
+                    (void)SC_ATOMIC_SUB(ctx->memuse, (uint64_t)data_size);
+            }
+            ctx->config.DataFree(h->data);
+            THashDataMoveToSpare(ctx, h);
+        } else {
+            THashDataFree(ctx, h);
+        }
         SCLogDebug("found and removed");
         return 1;
     }
@@ -97,6 +97,9 @@ typedef struct THashData_ {
 
 typedef struct THashHashRow_ {
     HRLOCK_TYPE lock;
+    /** sequence counter, odd while the row's list is being modified. Used
+     *  by THashLookupCopyFromHash to read the row without taking the lock. */
+    SC_ATOMIC_DECLARE(uint32_t, seq);
     THashData *head;
     THashData *tail;
 } __attribute__((aligned(CLS))) THashHashRow;
@@ -134,6 +137,10 @@ typedef struct THashDataConfig_ {
     bool (*DataCompare)(void *, void *);
     bool (*DataExpired)(void *, SCTime_t ts);
     uint32_t (*DataSize)(void *);
+    /** lookups through THashLookupCopyFromHash don't lock the row. Only safe
+     *  if the data is self contained (no pointers) and never modified while
+     *  it is in the hash. */
+    bool optimistic_reads;
 } THashConfig;
 
 #define THASH_DATA_SIZE(ctx) (sizeof(THashData) + (ctx)->config.data_size)
@@ -170,11 +177,19 @@ typedef struct THashTableContext_ {
 #define THashDecrUsecnt(h) \
     (void)SC_ATOMIC_SUB((h)->use_cnt, 1)
 
+/** entries a table preallocates by default */
+#define THASH_DEFAULT_PREALLOC 1000
+
 THashTableContext *THashInit(const char *cnf_prefix, uint32_t data_size,
         int (*DataSet)(void *dst, void *src), void (*DataFree)(void *),
         uint32_t (*DataHash)(uint32_t, void *), bool (*DataCompare)(void *, void *),
         bool (*DataExpired)(void *, SCTime_t), uint32_t (*DataSize)(void *), bool reset_memcap,
         uint64_t memcap, uint32_t hashsize);
+THashTableContext *THashInitWithPrealloc(const char *cnf_prefix, uint32_t data_size,
+        int (*DataSet)(void *dst, void *src), void (*DataFree)(void *),
+        uint32_t (*DataHash)(uint32_t, void *), bool (*DataCompare)(void *, void *),
+        bool (*DataExpired)(void *, SCTime_t), uint32_t (*DataSize)(void *), bool reset_memcap,
+        uint64_t memcap, uint32_t hashsize, uint32_t prealloc);
 
 void THashShutdown(THashTableContext *ctx);
 
@@ -195,6 +210,7 @@ struct THashDataGetResult {
 
 struct THashDataGetResult THashGetFromHash (THashTableContext *ctx, void *data);
 THashData *THashLookupFromHash (THashTableContext *ctx, void *data);
+int THashLookupCopyFromHash(THashTableContext *ctx, void *data, void *copy);
 THashDataQueue *THashDataQueueNew(void);
 void THashCleanup(THashTableContext *ctx);
 int THashWalk(THashTableContext *, THashFormatFunc, THashOutputFunc, void *);
@@ -202,5 +218,10 @@ int THashRemoveFromHash (THashTableContext *ctx, void *data);
 void THashConsolidateMemcap(THashTableContext *ctx);
 void THashDataMoveToSpare(THashTableContext *ctx, THashData *h);
 uint32_t THashExpire(THashTableContext *ctx, const SCTime_t ts);
+uint32_t THashRemoveIf(
+        THashTableContext *ctx, bool (*Remove)(void *data, void *arg), void *arg);
+uint32_t THashGetRow(const THashTableContext *ctx, void *data);
+uint32_t THashExpireRow(THashTableContext *ctx, const uint32_t row, const SCTime_t ts,
+        void (*Remaining)(void *data, void *arg), void *arg);
 
 #endif /* SURICATA_THASH_H */
@@ -0,0 +1,372 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Hierarchical timing wheel.
+ *
+ * Items are an id and an expiry time in seconds. Level 0 has a slot for
+ * each of the next 256 seconds, levels 1 and 2 have 64 slots each covering
+ * 256 and 16384 seconds. When the wheel reaches the start of a slot of a
+ * higher level, its items are moved down. Items further in the future than
+ * the span of the wheel are parked in the last slot and moved down again
+ * when it comes up.
+ *
+ * Advancing the wheel only touches the slots that became due, so the cost
+ * is proportional to the number of expiring items, not the number of items
+ * in the wheel.
+ */
+
+#include "suricata-common.h"
+#include "util-timewheel.h"
+#include "util-debug.h"
+#include "util-mem.h"
+#include "util-unittest.h"
+
+#define TIMEWHEEL_L0_MASK ((1U << TIMEWHEEL_L0_BITS) - 1)
+#define TIMEWHEEL_LN_MASK ((1U << TIMEWHEEL_LN_BITS) - 1)
+
+void TimeWheelInit(TimeWheel *tw)
+{
+    memset(tw, 0, sizeof(*tw));
+    SCMutexInit(&tw->lock, NULL);
+}
+
+static void TimeWheelSlotFree(TimeWheelSlot *s)
+{
+    SCFree(s->items);
+    memset(s, 0, sizeof(*s));
+}
+
+void TimeWheelFree(TimeWheel *tw)
+{
+    for (uint32_t i = 0; i < ARRAY_SIZE(tw->l0); i++) {
+        TimeWheelSlotFree(&tw->l0[i]);
+    }
+    for (uint32_t l = 0; l < TIMEWHEEL_LEVELS - 1; l++) {
+        for (uint32_t i = 0; i < ARRAY_SIZE(tw->ln[l]); i++) {
+            TimeWheelSlotFree(&tw->ln[l][i]);
+        }
+    }
+    tw->cnt = 0;
+    SCMutexDestroy(&tw->lock);
+}
+
+static int TimeWheelSlotAppend(TimeWheelSlot *s, const TimeWheelItem *item)
+{
+    if (s->cnt == s->size) {
+        const uint32_t size = s->size ? s->size * 2 : 16;
+        TimeWheelItem *items = SCRealloc(s->items, size * sizeof(*items));
+        if (items == NULL)
+            return -1;
+        s->items = items;
+        s->size = size;
+    }
+    s->items[s->cnt++] = *item;
+    return 0;
+}
+
+/** \internal
+ *  \brief put an item in the slot for its expiry time, relative to the
+ *         current time of the wheel. Wheel lock must be held. */
+static int TimeWheelInsert(TimeWheel *tw, const TimeWheelItem *item)
+{
+    /* items that are already due go in the current slot */
+    uint32_t expire = MAX(item->expire, tw->now);
+    if (expire - tw->now >= TIMEWHEEL_SPAN)
+        expire = tw->now + TIMEWHEEL_SPAN - 1;
+    const uint32_t delta = expire - tw->now;
+
+    TimeWheelSlot *s;
+    if (delta < (1U << TIMEWHEEL_L0_BITS)) {
+        s = &tw->l0[expire & TIMEWHEEL_L0_MASK];
+    } else if (delta < (1U << (TIMEWHEEL_L0_BITS + TIMEWHEEL_LN_BITS))) {
+        s = &tw->ln[0][(expire >> TIMEWHEEL_L0_BITS) & TIMEWHEEL_LN_MASK];
+    } else {
+        s = &tw->ln[1][(expire >> (TIMEWHEEL_L0_BITS + TIMEWHEEL_LN_BITS)) & TIMEWHEEL_LN_MASK];
+    }
+    return TimeWheelSlotAppend(s, item);
+}
+
+/**
+ *  \brief add an item to the wheel
+ *
+ *  \param id caller defined id of the item
+ *  \param expire time in seconds the item is due
+ *  \retval 0 ok, -1 out of memory
+ */
+int TimeWheelAdd(TimeWheel *tw, uint32_t id, uint32_t expire)
+{
+    const TimeWheelItem item = { .id = id, .expire = expire };
+
+    SCMutexLock(&tw->lock);
+    /* until the wheel is first advanced, start at the earliest item. Moving
+     * the start back can only make items come up early, never late. */
+    if (!tw->init && (tw->cnt == 0 || expire < tw->now))
+        tw->now = expire;
+    int r = TimeWheelInsert(tw, &item);
+    if (r == 0)
+        tw->cnt++;
+    SCMutexUnlock(&tw->lock);
+    return r;
+}
+
+/** \internal
+ *  \brief move the items of the higher level slots that start at the
+ *         current time down the wheel. Wheel lock must be held.
+ *
+ *  Items that can't be moved down because we're out of memory are taken
+ *  out of the wheel and left in \a early, to be handed out before they
+ *  are due.
+ *
+ *  \retval cnt number of items left in \a early */
+static uint32_t TimeWheelCascade(TimeWheel *tw, TimeWheelSlot early[TIMEWHEEL_LEVELS - 1])
+{
+    uint32_t cnt = 0;
+    for (uint32_t l = TIMEWHEEL_LEVELS - 1; l > 0; l--) {
+        const uint32_t shift = TIMEWHEEL_L0_BITS + (l - 1) * TIMEWHEEL_LN_BITS;
+        if ((tw->now & ((1U << shift) - 1)) != 0)
+            continue;
+
+        TimeWheelSlot *s = &tw->ln[l - 1][(tw->now >> shift) & TIMEWHEEL_LN_MASK];
+        TimeWheelSlot moved = *s;
+        memset(s, 0, sizeof(*s));
+        uint32_t failed = 0;
+        for (uint32_t i = 0; i < moved.cnt; i++) {
+            if (TimeWheelInsert(tw, &moved.items[i]) != 0) {
+                SCLogDebug("out of memory, handing out item %u early", moved.items[i].id);
+                moved.items[failed++] = moved.items[i];
+            }
+        }
+        tw->cnt -= failed;
+        cnt += failed;
+        if (failed != 0) {
+            moved.cnt = failed;
+            early[l - 1] = moved;
+        } else {
+            SCFree(moved.items);
+        }
+    }
+    return cnt;
+}
+
+static uint32_t TimeWheelRunSlot(TimeWheelSlot *s, TimeWheelExpireFunc Expire, void *arg)
+{
+    for (uint32_t i = 0; i < s->cnt; i++) {
+        Expire(s->items[i].id, s->items[i].expire, arg);
+    }
+    const uint32_t cnt = s->cnt;
+    TimeWheelSlotFree(s);
+    return cnt;
+}
+
+/** \internal
+ *  \brief hand out all items, used when the wheel falls behind by more than
+ *         its span. Called and returns with the wheel lock held. */
+static uint32_t TimeWheelFlush(TimeWheel *tw, uint32_t now, TimeWheelExpireFunc Expire, void *arg)
+{
+    TimeWheelSlot *all = SCCalloc(ARRAY_SIZE(tw->l0) + ARRAY_SIZE(tw->ln[0]) * (TIMEWHEEL_LEVELS - 1),
+            sizeof(*all));
+    if (all == NULL)
+        return 0;
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < ARRAY_SIZE(tw->l0); i++) {
+        all[n++] = tw->l0[i];
+        memset(&tw->l0[i], 0, sizeof(tw->l0[i]));
+    }
+    for (uint32_t l = 0; l < TIMEWHEEL_LEVELS - 1; l++) {
+        for (uint32_t i = 0; i < ARRAY_SIZE(tw->ln[l]); i++) {
+            all[n++] = tw->ln[l][i];
+            memset(&tw->ln[l][i], 0, sizeof(tw->ln[l][i]));
+        }
+    }
+    tw->cnt = 0;
+    tw->now = now + 1;
+    SCMutexUnlock(&tw->lock);
+
+    uint32_t cnt = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        cnt += TimeWheelRunSlot(&all[i], Expire, arg);
+    }
+    SCFree(all);
+
+    SCMutexLock(&tw->lock);
+    return cnt;
+}
+
+/**
+ *  \brief move the wheel to \a now, handing out all items due up to
+ *         and including \a now
+ *
+ *  The \a Expire callback is called without the wheel lock held, so it
+ *  can add items again.
+ *
+ *  \retval cnt number of items handed out
+ */
+uint32_t TimeWheelAdvance(TimeWheel *tw, uint32_t now, TimeWheelExpireFunc Expire, void *arg)
+{
+    uint32_t cnt = 0;
+
+    SCMutexLock(&tw->lock);
+    if (!tw->init) {
+        tw->init = true;
+        if (tw->cnt == 0)
+            tw->now = now;
+    }
+    while (tw->now <= now) {
+        if (tw->cnt == 0) {
+            tw->now = now + 1;
+            break;
+        }
+        if (now - tw->now >= TIMEWHEEL_SPAN) {
+            cnt += TimeWheelFlush(tw, now, Expire, arg);
+            continue;
+        }
+
+        TimeWheelSlot early[TIMEWHEEL_LEVELS - 1];
+        memset(early, 0, sizeof(early));
+        if (TimeWheelCascade(tw, early) != 0) {
+            SCMutexUnlock(&tw->lock);
+            for (uint32_t l = 0; l < TIMEWHEEL_LEVELS - 1; l++) {
+                cnt += TimeWheelRunSlot(&early[l], Expire, arg);
+            }
+            SCMutexLock(&tw->lock);
+        }
+
+        TimeWheelSlot *s = &tw->l0[tw->now & TIMEWHEEL_L0_MASK];
+        tw->now++;
+        if (s->cnt == 0)
+            continue;
+
+        TimeWheelSlot due = *s;
+        memset(s, 0, sizeof(*s));
+        tw->cnt -= due.cnt;
+        SCMutexUnlock(&tw->lock);
+        cnt += TimeWheelRunSlot(&due, Expire, arg);
+        SCMutexLock(&tw->lock);
+    }
+    SCMutexUnlock(&tw->lock);
+    return cnt;
+}
+
+#ifdef UNITTESTS
+struct TimeWheelTestCtx {
+    uint32_t now;
+    uint32_t cnt;
+    uint32_t early;
+    uint32_t late;
+    uint32_t last_id;
+};
+
+static void TimeWheelTestExpire(uint32_t id, uint32_t expire, void *arg)
+{
+    struct TimeWheelTestCtx *ctx = arg;
+    ctx->cnt++;
+    ctx->last_id = id;
+    if (expire > ctx->now)
+        ctx->early++;
+    else if (expire < ctx->now)
+        ctx->late++;
+}
+
+/** \test items come up at their expiry time, on all levels */
+static int TimeWheelTest01(void)
+{
+    TimeWheel tw;
+    TimeWheelInit(&tw);
+    struct TimeWheelTestCtx ctx = { 0 };
+
+    const uint32_t start = 1000000;
+    FAIL_IF(TimeWheelAdvance(&tw, start, TimeWheelTestExpire, &ctx) != 0);
+    /* level 0, 1 and 2 */
+    FAIL_IF(TimeWheelAdd(&tw, 1, start + 10) != 0);
+    FAIL_IF(TimeWheelAdd(&tw, 2, start + 1000) != 0);
+    FAIL_IF(TimeWheelAdd(&tw, 3, start + 100000) != 0);
+    /* already due */
+    FAIL_IF(TimeWheelAdd(&tw, 4, start - 5) != 0);
+
+    for (ctx.now = start + 1; ctx.now <= start + 100000; ctx.now++) {
+        uint32_t cnt = TimeWheelAdvance(&tw, ctx.now, TimeWheelTestExpire, &ctx);
+        if (ctx.now == start + 1) {
+            FAIL_IF(cnt != 1 || ctx.last_id != 4);
+            ctx.late = 0;
+        } else if (ctx.now == start + 10) {
+            FAIL_IF(cnt != 1 || ctx.last_id != 1);
+        } else if (ctx.now == start + 1000) {
+            FAIL_IF(cnt != 1 || ctx.last_id != 2);
+        } else if (ctx.now == start + 100000) {
+            FAIL_IF(cnt != 1 || ctx.last_id != 3);
+        } else {
+            FAIL_IF(cnt != 0);
+        }
+    }
+    FAIL_IF(ctx.cnt != 4);
+    FAIL_IF(ctx.early != 0);
+    FAIL_IF(ctx.late != 0);
+    FAIL_IF(tw.cnt != 0);
+
+    TimeWheelFree(&tw);
+    PASS;
+}
+
+/** \test items beyond the span and skipping ahead */
+static int TimeWheelTest02(void)
+{
+    TimeWheel tw;
+    TimeWheelInit(&tw);
+    struct TimeWheelTestCtx ctx = { 0 };
+
+    const uint32_t start = 1000000;
+    /* before the first advance the wheel starts at the earliest item */
+    FAIL_IF(TimeWheelAdd(&tw, 1, start + 20) != 0);
+    FAIL_IF(TimeWheelAdd(&tw, 2, start + 10) != 0);
+    FAIL_IF(TimeWheelAdd(&tw, 3, start + 2 * TIMEWHEEL_SPAN) != 0);
+
+    ctx.now = start + 10;
+    FAIL_IF(TimeWheelAdvance(&tw, ctx.now, TimeWheelTestExpire, &ctx) != 1);
+    FAIL_IF(ctx.last_id != 2);
+    ctx.now = start + 20;
+    FAIL_IF(TimeWheelAdvance(&tw, ctx.now, TimeWheelTestExpire, &ctx) != 1);
+    FAIL_IF(ctx.last_id != 1);
+
+    /* far behind: the remaining item is handed out early */
+    ctx.now = start + TIMEWHEEL_SPAN + 100;
+    FAIL_IF(TimeWheelAdvance(&tw, ctx.now, TimeWheelTestExpire, &ctx) != 1);
+    FAIL_IF(ctx.last_id != 3);
+    FAIL_IF(ctx.early != 1);
+    FAIL_IF(tw.cnt != 0);
+
+    /* time going back is ignored */
+    FAIL_IF(TimeWheelAdd(&tw, 4, start) != 0);
+    FAIL_IF(TimeWheelAdvance(&tw, start, TimeWheelTestExpire, &ctx) != 0);
+    FAIL_IF(TimeWheelAdvance(&tw, ctx.now + 1, TimeWheelTestExpire, &ctx) != 1);
+    FAIL_IF(ctx.last_id != 4);
+
+    TimeWheelFree(&tw);
+    PASS;
+}
+#endif /* UNITTESTS */
+
+void TimeWheelRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("TimeWheelTest01", TimeWheelTest01);
+    UtRegisterTest("TimeWheelTest02", TimeWheelTest02);
+#endif
+}
@@ -0,0 +1,68 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Hierarchical timing wheel with a resolution of one second.
+ */
+
+#ifndef SURICATA_UTIL_TIMEWHEEL_H
+#define SURICATA_UTIL_TIMEWHEEL_H
+
+#include "threads.h"
+
+/* level 0 has a slot per second, each slot of the next levels covers
+ * all slots of the level below */
+#define TIMEWHEEL_L0_BITS 8
+#define TIMEWHEEL_LN_BITS 6
+#define TIMEWHEEL_LEVELS  3
+#define TIMEWHEEL_SPAN    (1U << (TIMEWHEEL_L0_BITS + 2 * TIMEWHEEL_LN_BITS))
+
+typedef struct TimeWheelItem_ {
+    uint32_t id;
+    uint32_t expire; /**< in seconds */
+} TimeWheelItem;
+
+typedef struct TimeWheelSlot_ {
+    TimeWheelItem *items;
+    uint32_t cnt;
+    uint32_t size;
+} TimeWheelSlot;
+
+typedef struct TimeWheel_ {
+    SCMutex lock;
+    bool init;
+    uint32_t now; /**< next second to process */
+    uint32_t cnt; /**< items in all slots */
+    TimeWheelSlot l0[1 << TIMEWHEEL_L0_BITS];
+    TimeWheelSlot ln[TIMEWHEEL_LEVELS - 1][1 << TIMEWHEEL_LN_BITS];
+} TimeWheel;
+
+/** callback for due items. May be called before \a expire if the wheel
+ *  had to skip ahead or ran out of memory, the item needs to be added
+ *  again in that case. */
+typedef void (*TimeWheelExpireFunc)(uint32_t id, uint32_t expire, void *arg);
+
+void TimeWheelInit(TimeWheel *tw);
+void TimeWheelFree(TimeWheel *tw);
+int TimeWheelAdd(TimeWheel *tw, uint32_t id, uint32_t expire);
+uint32_t TimeWheelAdvance(TimeWheel *tw, uint32_t now, TimeWheelExpireFunc Expire, void *arg);
+
+void TimeWheelRegisterTests(void);
+
+#endif /* SURICATA_UTIL_TIMEWHEEL_H */
@@ -45,6 +45,100 @@ void XBitFree(XBit *fb)
     SCFree(fb);
 }
 
+/** \brief find a bit in the array
+ *  \retval pos position of the bit or -1 if it is not set */
+int XBitArrayFind(const XBitArray *xa, const uint32_t idx)
+{
+    if (xa == NULL)
+        return -1;
+    for (uint32_t i = 0; i < xa->cnt; i++) {
+        if (xa->idx[i] == idx)
+            return (int)i;
+    }
+    return -1;
+}
+
+/** \internal
+ *  \brief (re)allocate the array for \a size bits */
+static XBitArray *XBitArrayResize(XBitArray *xa, const uint32_t size)
+{
+    const size_t len = sizeof(XBitArray) + size * (sizeof(SCTime_t) + sizeof(uint32_t));
+    XBitArray *nxa = SCRealloc(xa, len);
+    if (nxa == NULL)
+        return NULL;
+    if (xa == NULL) {
+        nxa->cnt = 0;
+        SCTIME_INIT(nxa->max_expire);
+    } else if (nxa->cnt > 0) {
+        /* the idx array follows the expire array, so it moves when the
+         * array grows */
+        memmove((uint8_t *)&nxa->expire[size], (uint8_t *)&nxa->expire[nxa->size],
+                nxa->cnt * sizeof(uint32_t));
+    }
+    nxa->size = size;
+    nxa->idx = (uint32_t *)&nxa->expire[size];
+    return nxa;
+}
+
+/** \brief add a bit that is not in the array yet
+ *
+ *  \param xa pointer to the array, may point to NULL. Updated if the array
+ *             had to be (re)allocated.
+ *  \retval pos position of the new bit or -1 on allocation failure */
+int XBitArrayAdd(XBitArray **xa, const uint32_t idx, const SCTime_t expire)
+{
+    XBitArray *a = *xa;
+    if (a == NULL || a->cnt == a->size) {
+        a = XBitArrayResize(a, a ? a->size * 2 : 4);
+        if (a == NULL)
+            return -1;
+        *xa = a;
+    }
+    const uint32_t pos = a->cnt++;
+    a->idx[pos] = idx;
+    a->expire[pos] = expire;
+    if (SCTIME_CMP_GT(expire, a->max_expire))
+        a->max_expire = expire;
+    return (int)pos;
+}
+
+/** \brief remove the bit at \a pos
+ *
+ *  The last bit takes its place. The array is freed and \a xa set to NULL
+ *  when its last bit is removed. */
+void XBitArrayRemove(XBitArray **xa, const uint32_t pos)
+{
+    XBitArray *a = *xa;
+    DEBUG_VALIDATE_BUG_ON(pos >= a->cnt);
+    if (--a->cnt == 0) {
+        SCFree(a);
+        *xa = NULL;
+        return;
+    }
+    a->idx[pos] = a->idx[a->cnt];
+    a->expire[pos] = a->expire[a->cnt];
+
+    SCTIME_INIT(a->max_expire);
+    for (uint32_t i = 0; i < a->cnt; i++) {
+        if (SCTIME_CMP_GT(a->expire[i], a->max_expire))
+            a->max_expire = a->expire[i];
+    }
+}
+
+void XBitArrayFree(XBitArray *xa)
+{
+    SCFree(xa);
+}
+
+/** \retval true all bits expired at \a ts
+ *  \retval false array still has active (non-expired) bits */
+bool XBitArrayTimedout(const XBitArray *xa, const SCTime_t ts)
+{
+    if (xa == NULL)
+        return true;
+    return !SCTIME_CMP_GT(xa->max_expire, ts);
+}
+
 void SCGenericVarFree(GenericVar *gv)
 {
     if (gv == NULL)
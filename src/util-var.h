@@ -67,6 +67,22 @@ typedef struct XBit_ {
 } XBit;
 
 void XBitFree(XBit *);
+
+/** host and ippair xbits: the name idx and expire time of each set bit,
+ *  stored as 2 arrays in a single allocation. */
+typedef struct XBitArray_ {
+    uint32_t cnt;
+    uint32_t size;
+    SCTime_t max_expire; /**< latest expire time of all bits */
+    uint32_t *idx;       /**< name idx of each bit */
+    SCTime_t expire[];
+} XBitArray;
+
+int XBitArrayFind(const XBitArray *xa, const uint32_t idx);
+int XBitArrayAdd(XBitArray **xa, const uint32_t idx, const SCTime_t expire);
+void XBitArrayRemove(XBitArray **xa, const uint32_t pos);
+void XBitArrayFree(XBitArray *xa);
+bool XBitArrayTimedout(const XBitArray *xa, const SCTime_t ts);
 #endif
 
 // A list of variables we try to resolve while parsing configuration file.